@@ -0,0 +1,283 @@
+#include <types.h>
+#include <arch/arch.h>
+#include <arch/cpu.h>
+#include <block/blkdev.h>
+#include <boot/init.h>
+#include <drivers/block/virtio_blk.h>
+#include <drivers/pci/pci.h>
+#include <drivers/virtio/virtio.h>
+#include <drivers/virtio/virtqueue.h>
+#include <lib/printk.h>
+#include <lib/spinlock.h>
+#include <lib/string.h>
+#include <lib/util.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+
+#define VIRTIO_BLK_QUEUE_SIZE 128
+
+/* The header and status descriptors that surround each request's data segments */
+#define VIRTIO_BLK_EXTRA_DESCS 2
+
+/* Per-slot DMA state: the request header and status byte the device reads and writes */
+struct virtio_blk_cmd
+{
+    struct virtio_blk_req_hdr hdr;
+    u8 status;
+    u16 next_free;
+    struct blk_request *req;
+};
+
+struct virtio_blk_queue
+{
+    struct virtqueue vq;
+    struct virtio_blk_cmd *cmds;
+    u16 free_cmd;
+    bool pending;   /* chains added since the last doorbell */
+};
+
+struct virtio_blk
+{
+    struct blk_device blk;
+    struct virtio_device vdev;
+    char name[8];
+    u16 queue_count;
+    struct virtio_blk_queue queues[VIRTIO_BLK_MAX_QUEUES];
+};
+
+static struct virtio_blk virtio_blk_devices[VIRTIO_BLK_MAX_DEVICES];
+static size_t virtio_blk_count;
+
+static int virtio_blk_submit(struct blk_device *dev, struct blk_request *req);
+static void virtio_blk_commit(struct blk_device *dev);
+static size_t virtio_blk_poll(struct blk_device *dev);
+
+static const struct blk_device_ops virtio_blk_ops =
+{
+    .submit = virtio_blk_submit,
+    .commit = virtio_blk_commit,
+    .poll = virtio_blk_poll,
+};
+
+static inline struct virtio_blk_queue *virtio_blk_local_queue(struct virtio_blk *vblk)
+{
+    return &vblk->queues[cpu_index() % vblk->queue_count];
+}
+
+static int virtio_blk_submit(struct blk_device *dev, struct blk_request *req)
+{
+    struct virtio_blk *vblk = dev->driver_data;
+    struct virtio_blk_queue *queue = virtio_blk_local_queue(vblk);
+    struct virtq_buf bufs[BLK_MAX_SEGMENTS + VIRTIO_BLK_EXTRA_DESCS];
+    struct virtio_blk_cmd *cmd;
+    u16 count = 0;
+    u16 index;
+
+    if (req->segment_count > BLK_MAX_SEGMENTS)
+        return -1;
+
+    spin_lock(&queue->vq.lock);
+
+    if (queue->free_cmd == VIRTIO_BLK_QUEUE_SIZE || queue->vq.num_free < req->segment_count + VIRTIO_BLK_EXTRA_DESCS)
+    {
+        spin_unlock(&queue->vq.lock);
+        return -1;
+    }
+
+    cmd = &queue->cmds[queue->free_cmd];
+    queue->free_cmd = cmd->next_free;
+
+    cmd->req = req;
+    cmd->status = 0xFF;
+    cmd->hdr.reserved = 0;
+    cmd->hdr.sector = req->sector;
+    cmd->hdr.type = req->op == BLK_OP__READ ? VIRTIO_BLK_T__IN :
+                    req->op == BLK_OP__WRITE ? VIRTIO_BLK_T__OUT : VIRTIO_BLK_T__FLUSH;
+
+    bufs[count].addr = &cmd->hdr;
+    bufs[count].len = sizeof(cmd->hdr);
+    bufs[count++].device_writable = false;
+    for (index = 0; index < req->segment_count; index++)
+    {
+        bufs[count].addr = req->segments[index].buf;
+        bufs[count].len = req->segments[index].length;
+        bufs[count++].device_writable = req->op == BLK_OP__READ;
+    }
+    bufs[count].addr = &cmd->status;
+    bufs[count].len = 1;
+    bufs[count++].device_writable = true;
+
+    virtqueue_add(&queue->vq, bufs, count, cmd);
+    queue->pending = true;
+
+    spin_unlock(&queue->vq.lock);
+
+    return 0;
+}
+
+/* One doorbell per queue for everything added since the last commit, skipped if the device is still consuming */
+static void virtio_blk_commit(struct blk_device *dev)
+{
+    struct virtio_blk *vblk = dev->driver_data;
+    u16 index;
+
+    for (index = 0; index < vblk->queue_count; index++)
+    {
+        struct virtio_blk_queue *queue = &vblk->queues[index];
+        bool notify = false;
+
+        /* Another CPU's submit sets the flag under the lock: read it there too */
+        spin_lock(&queue->vq.lock);
+        if (queue->pending)
+        {
+            queue->pending = false;
+            notify = virtqueue_kick_prepare(&queue->vq);
+        }
+        spin_unlock(&queue->vq.lock);
+
+        if (notify)
+            virtqueue_notify(&queue->vq);
+    }
+
+    return;
+}
+
+static size_t virtio_blk_poll(struct blk_device *dev)
+{
+    struct virtio_blk *vblk = dev->driver_data;
+    size_t completed = 0;
+    u16 index;
+
+    for (index = 0; index < vblk->queue_count; index++)
+    {
+        struct virtio_blk_queue *queue = &vblk->queues[index];
+
+        while (virtqueue_has_used(&queue->vq))
+        {
+            struct virtio_blk_cmd *cmd;
+            struct blk_request *req;
+
+            spin_lock(&queue->vq.lock);
+            cmd = virtqueue_get_buf(&queue->vq, NULL);
+            if (cmd == NULL)
+            {
+                spin_unlock(&queue->vq.lock);
+                break;
+            }
+            req = cmd->req;
+            req->status = cmd->status == VIRTIO_BLK_S__OK ? BLK_STATUS__OK :
+                          cmd->status == VIRTIO_BLK_S__UNSUPP ? BLK_STATUS__UNSUPPORTED : BLK_STATUS__IO_ERROR;
+            cmd->next_free = queue->free_cmd;
+            queue->free_cmd = (u16)(cmd - queue->cmds);
+            spin_unlock(&queue->vq.lock);
+
+            /* Called unlocked so end_io() can resubmit */
+            blk_end_request(req);
+            completed++;
+        }
+    }
+
+    return completed;
+}
+
+static int __init virtio_blk_setup_queue(struct virtio_blk *vblk, u16 index)
+{
+    struct virtio_blk_queue *queue = &vblk->queues[index];
+    size_t cmds_size = VIRTIO_BLK_QUEUE_SIZE * sizeof(struct virtio_blk_cmd);
+    uintptr_t cmds;
+    u16 slot;
+
+    if (virtio_setup_queue(&vblk->vdev, &queue->vq, index, VIRTIO_BLK_QUEUE_SIZE))
+        return -1;
+
+    cmds = frame_alloc_contig(ALIGN_UP(cmds_size, PAGE_SIZE) / PAGE_SIZE);
+    if (cmds == 0)
+        return -1;
+
+    queue->cmds = phys_to_virt(cmds);
+    memset(queue->cmds, 0, cmds_size);
+    for (slot = 0; slot < VIRTIO_BLK_QUEUE_SIZE; slot++)
+        queue->cmds[slot].next_free = slot + 1;
+    queue->free_cmd = 0;
+    queue->pending = false;
+
+    return 0;
+}
+
+static int __init virtio_blk_probe(struct pci_device *pci)
+{
+    struct virtio_blk *vblk;
+    u16 queues = 1;
+    u16 index;
+
+    if (virtio_blk_count == VIRTIO_BLK_MAX_DEVICES)
+        return -1;
+
+    vblk = &virtio_blk_devices[virtio_blk_count];
+
+    if (virtio_pci_init(&vblk->vdev, pci) || vblk->vdev.device_cfg == NULL)
+        return -1;
+
+    if (virtio_negotiate(&vblk->vdev, VIRTIO_F__RING_EVENT_IDX | VIRTIO_BLK_F__BLK_SIZE |
+                                      VIRTIO_BLK_F__FLUSH | VIRTIO_BLK_F__MQ | VIRTIO_BLK_F__SEG_MAX))
+    {
+        virtio_fail(&vblk->vdev);
+        return -1;
+    }
+
+    /* One queue per CPU when the device offers enough of them */
+    if (virtio_has_feature(&vblk->vdev, VIRTIO_BLK_F__MQ))
+        queues = virtio_config_read16(&vblk->vdev, VIRTIO_BLK_CONFIG__NUM_QUEUES);
+    queues = MIN(MIN(queues, (u16)VIRTIO_BLK_MAX_QUEUES), (u16)NR_CPUS);
+    queues = MIN(queues, virtio_queue_count(&vblk->vdev));
+    if (queues == 0)
+        queues = 1;
+
+    for (index = 0; index < queues; index++)
+    {
+        if (virtio_blk_setup_queue(vblk, index))
+        {
+            virtio_fail(&vblk->vdev);
+            return -1;
+        }
+    }
+    vblk->queue_count = queues;
+
+    snprintk(vblk->name, sizeof(vblk->name), "vd%c", (char)('a' + virtio_blk_count));
+    vblk->blk.name = vblk->name;
+    vblk->blk.sector_count = virtio_config_read64(&vblk->vdev, VIRTIO_BLK_CONFIG__CAPACITY);
+    vblk->blk.block_size = virtio_has_feature(&vblk->vdev, VIRTIO_BLK_F__BLK_SIZE) ?
+                           virtio_config_read32(&vblk->vdev, VIRTIO_BLK_CONFIG__BLK_SIZE) : BLK_SECTOR_SIZE;
+    vblk->blk.queue_count = queues;
+    /* Requests in flight per queue: single-segment ones, so larger requests fit fewer */
+    vblk->blk.queue_depth = vblk->queues[0].vq.size / (1 + VIRTIO_BLK_EXTRA_DESCS);
+    vblk->blk.ops = &virtio_blk_ops;
+    vblk->blk.driver_data = vblk;
+
+    virtio_driver_ok(&vblk->vdev);
+
+    virtio_blk_count++;
+
+    return blk_register(&vblk->blk);
+}
+
+int __init virtio_blk_init(void)
+{
+    static const u16 device_ids[] =
+    {
+        VIRTIO_PCI_DEVICE_ID__MODERN + VIRTIO_DEVICE_TYPE__BLOCK,
+        VIRTIO_PCI_DEVICE_ID__TRANSITIONAL_BLOCK,
+    };
+    size_t index;
+
+    for (index = 0; index < ARRAY_SIZE(device_ids); index++)
+    {
+        struct pci_device *pci = NULL;
+
+        while ((pci = pci_find_device(VIRTIO_PCI_VENDOR_ID, device_ids[index], pci)))
+            if (virtio_blk_probe(pci))
+                printk("virtio-blk: %02x:%02x.%u: probe failed\n", pci->bus, pci->slot, pci->function);
+    }
+
+    return 0;
+}
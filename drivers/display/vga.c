@@ -50,12 +50,38 @@ static inline void vga_putentryat(char c, u8 color, size_t x, size_t y)
     return;
 }
 
+static inline void vga_scroll(void)
+{
+    size_t index;
+
+    for (index = 0; index < (vga.height - 1) * vga.width; index++)
+        vga.buffer[index] = vga.buffer[index + vga.width];
+
+    for (; index < vga.height * vga.width; index++)
+        vga.buffer[index] = vga_entry(' ', vga.color);
+
+    return;
+}
+
 static inline void vga_putchar(char c)
 {
-    vga_putentryat(c, vga.color, vga.cursor.x, vga.cursor.y);
+    if (c != '\n')
+    {
+        vga_putentryat(c, vga.color, vga.cursor.x, vga.cursor.y);
+        vga.cursor.x++;
+    }
 
-    vga.cursor.x = vga.cursor.x < vga.width ? vga.cursor.x + 1U : 0U;
-    vga.cursor.y = vga.cursor.x != 0 ? vga.cursor.y : (vga.cursor.y < vga.height ? vga.cursor.y + 1U : 0U);
+    if (c == '\n' || vga.cursor.x >= vga.width)
+    {
+        vga.cursor.x = 0U;
+        vga.cursor.y++;
+    }
+
+    if (vga.cursor.y >= vga.height)
+    {
+        vga_scroll();
+        vga.cursor.y = vga.height - 1;
+    }
 
     return;
 }
@@ -64,7 +90,7 @@ int vga_write(const char *str, size_t str_length)
 {
     size_t counter = 0;
 
-    for (; counter <= str_length && str[counter] != '\0'; counter++)
+    for (; counter < str_length && str[counter] != '\0'; counter++)
         vga_putchar(str[counter]);
 
     return counter;
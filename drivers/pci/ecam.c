@@ -0,0 +1,113 @@
+#include <types.h>
+#include <acpi/acpi.h>
+#include <acpi/tables.h>
+#include <arch/io.h>
+#include <boot/init.h>
+#include <drivers/pci/pci.h>
+#include <lib/printk.h>
+#include <mm/mmu.h>
+
+#define PCI_ECAM_MAX_REGIONS    4
+
+/* Each function gets 4KB of configuration space, each bus 1MB */
+#define PCI_ECAM_BUS_SHIFT      20
+#define PCI_ECAM_SLOT_SHIFT     15
+#define PCI_ECAM_FUNCTION_SHIFT 12
+
+struct pci_ecam_region
+{
+    volatile u8 *base;
+    u16 segment;
+    u8 start_bus;
+    u8 end_bus;
+};
+
+static struct pci_ecam_region pci_ecam_regions[PCI_ECAM_MAX_REGIONS];
+static size_t pci_ecam_regions_count;
+
+static volatile u8 *pci_ecam_address(u16 segment, u8 bus, u8 slot, u8 function, u16 offset)
+{
+    size_t index;
+
+    for (index = 0; index < pci_ecam_regions_count; index++)
+    {
+        const struct pci_ecam_region *region = &pci_ecam_regions[index];
+
+        if (region->segment == segment && bus >= region->start_bus && bus <= region->end_bus)
+            return region->base + ((uintptr_t)(bus - region->start_bus) << PCI_ECAM_BUS_SHIFT |
+                                   (uintptr_t)slot << PCI_ECAM_SLOT_SHIFT |
+                                   (uintptr_t)function << PCI_ECAM_FUNCTION_SHIFT | (offset & 0xFFC));
+    }
+
+    return NULL;
+}
+
+/* Buses outside every region read as absent, like an empty slot */
+static u32 pci_ecam_read32(u16 segment, u8 bus, u8 slot, u8 function, u16 offset)
+{
+    volatile u8 *address = pci_ecam_address(segment, bus, slot, function, offset);
+
+    return address != NULL ? mmio_read32(address) : 0xFFFFFFFFU;
+}
+
+static void pci_ecam_write32(u16 segment, u8 bus, u8 slot, u8 function, u16 offset, u32 value)
+{
+    volatile u8 *address = pci_ecam_address(segment, bus, slot, function, offset);
+
+    if (address != NULL)
+        mmio_write32(address, value);
+
+    return;
+}
+
+static const struct pci_config_ops pci_ecam_ops =
+{
+    .read32 = pci_ecam_read32,
+    .write32 = pci_ecam_write32,
+};
+
+int __init pci_ecam_init(void)
+{
+    const struct acpi_mcfg *mcfg = (const struct acpi_mcfg *)acpi_find_table(ACPI_SIGNATURE__MCFG, 0);
+    size_t count;
+    size_t index;
+
+    if (mcfg == NULL)
+        return -1;
+
+    count = (mcfg->header.length - sizeof(struct acpi_mcfg)) / sizeof(struct acpi_mcfg_allocation);
+
+    for (index = 0; index < count && pci_ecam_regions_count < PCI_ECAM_MAX_REGIONS; index++)
+    {
+        const struct acpi_mcfg_allocation *allocation = &mcfg->allocations[index];
+        struct pci_ecam_region *region = &pci_ecam_regions[pci_ecam_regions_count];
+        size_t size;
+        u64 base;
+
+        if (allocation->end_bus < allocation->start_bus)
+            continue;
+
+        /* The base address corresponds to bus 0 even when the range starts higher */
+        size = (size_t)(allocation->end_bus - allocation->start_bus + 1) << PCI_ECAM_BUS_SHIFT;
+        base = allocation->base_address + ((u64)allocation->start_bus << PCI_ECAM_BUS_SHIFT);
+
+        region->base = mmu_map_io(base, size);
+        if (region->base == NULL)
+            continue;
+
+        region->segment = allocation->segment;
+        region->start_bus = allocation->start_bus;
+        region->end_bus = allocation->end_bus;
+        pci_ecam_regions_count++;
+
+        printk("pci: ecam segment %u buses %u-%u at %llx\n", region->segment, region->start_bus,
+               region->end_bus, (unsigned long long)base);
+    }
+
+    if (pci_ecam_regions_count == 0)
+        return -1;
+
+    pci_set_config_ops(&pci_ecam_ops);
+
+    return 0;
+}
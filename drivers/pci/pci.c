@@ -0,0 +1,227 @@
+#include <types.h>
+#include <arch/io.h>
+#include <boot/init.h>
+#include <drivers/pci/pci.h>
+#include <lib/printk.h>
+
+#define PCI_PORT_ADDRESS    0xCF8
+#define PCI_PORT_DATA       0xCFC
+
+#define PCI_MAX_BUSES       256
+#define PCI_MAX_SLOTS       32
+#define PCI_MAX_FUNCTIONS   8
+
+static u32 pci_port_read32(u16 segment, u8 bus, u8 slot, u8 function, u16 offset);
+static void pci_port_write32(u16 segment, u8 bus, u8 slot, u8 function, u16 offset, u32 value);
+
+static const struct pci_config_ops pci_port_ops =
+{
+    .read32 = pci_port_read32,
+    .write32 = pci_port_write32,
+};
+
+static const struct pci_config_ops *pci_ops = &pci_port_ops;
+static struct pci_device pci_devices[PCI_MAX_DEVICES];
+static size_t pci_devices_count;
+
+static inline u32 pci_port_address(u8 bus, u8 slot, u8 function, u16 offset)
+{
+    return (u32)1 << 31 | (u32)bus << 16 | (u32)slot << 11 | (u32)function << 8 | (offset & 0xFC);
+}
+
+static u32 pci_port_read32(u16 segment, u8 bus, u8 slot, u8 function, u16 offset)
+{
+    (void)segment;
+
+    outl(PCI_PORT_ADDRESS, pci_port_address(bus, slot, function, offset));
+
+    return inl(PCI_PORT_DATA);
+}
+
+static void pci_port_write32(u16 segment, u8 bus, u8 slot, u8 function, u16 offset, u32 value)
+{
+    (void)segment;
+
+    outl(PCI_PORT_ADDRESS, pci_port_address(bus, slot, function, offset));
+    outl(PCI_PORT_DATA, value);
+
+    return;
+}
+
+void pci_set_config_ops(const struct pci_config_ops *ops)
+{
+    pci_ops = ops;
+
+    return;
+}
+
+u32 pci_read32(const struct pci_device *dev, u16 offset)
+{
+    return pci_ops->read32(dev->segment, dev->bus, dev->slot, dev->function, offset);
+}
+
+u16 pci_read16(const struct pci_device *dev, u16 offset)
+{
+    return (u16)(pci_read32(dev, offset & ~3) >> ((offset & 2) * 8));
+}
+
+u8 pci_read8(const struct pci_device *dev, u16 offset)
+{
+    return (u8)(pci_read32(dev, offset & ~3) >> ((offset & 3) * 8));
+}
+
+void pci_write32(const struct pci_device *dev, u16 offset, u32 value)
+{
+    pci_ops->write32(dev->segment, dev->bus, dev->slot, dev->function, offset, value);
+
+    return;
+}
+
+void pci_write16(const struct pci_device *dev, u16 offset, u16 value)
+{
+    u32 shift = (offset & 2) * 8;
+    u32 dword = pci_read32(dev, offset & ~3);
+
+    dword = (dword & ~((u32)0xFFFF << shift)) | ((u32)value << shift);
+    pci_write32(dev, offset & ~3, dword);
+
+    return;
+}
+
+u8 pci_find_capability(const struct pci_device *dev, u8 cap_id, u8 from)
+{
+    u8 offset;
+    int guard;
+
+    if (!(pci_read16(dev, PCI_CONFIG__STATUS) & PCI_STATUS__CAPABILITIES))
+        return 0;
+
+    offset = from ? pci_read8(dev, from + 1) : pci_read8(dev, PCI_CONFIG__CAPABILITIES);
+
+    /* The list lives in the first 256 bytes, so 48 hops bound a malformed loop */
+    for (guard = 0; offset && guard < 48; guard++)
+    {
+        offset &= 0xFC;
+        if (pci_read8(dev, offset) == cap_id)
+            return offset;
+        offset = pci_read8(dev, offset + 1);
+    }
+
+    return 0;
+}
+
+void pci_enable(const struct pci_device *dev, u16 command)
+{
+    pci_write16(dev, PCI_CONFIG__COMMAND, pci_read16(dev, PCI_CONFIG__COMMAND) | command);
+
+    return;
+}
+
+static void __init pci_read_bars(struct pci_device *dev)
+{
+    int count = (dev->header_type & PCI_HEADER_TYPE__MASK) == 0 ? PCI_MAX_BARS : 2;
+    int index;
+
+    for (index = 0; index < count; index++)
+    {
+        u32 bar = pci_read32(dev, PCI_CONFIG__BAR0 + index * 4);
+
+        if (bar & 1)
+        {
+            dev->bar_is_io[index] = true;
+            dev->bars[index] = bar & ~(u32)3;
+        }
+        else if (((bar >> 1) & 3) == 2 && index + 1 < count)
+        {
+            dev->bars[index] = (bar & ~(u32)0xF) | ((u64)pci_read32(dev, PCI_CONFIG__BAR0 + (index + 1) * 4) << 32);
+            index++;
+        }
+        else
+        {
+            dev->bars[index] = bar & ~(u32)0xF;
+        }
+    }
+
+    return;
+}
+
+static void __init pci_probe_function(u8 bus, u8 slot, u8 function)
+{
+    struct pci_device *dev;
+    u32 id = pci_ops->read32(0, bus, slot, function, PCI_CONFIG__VENDOR_ID);
+    u32 class_word;
+
+    if ((u16)id == PCI_VENDOR__NONE || pci_devices_count == PCI_MAX_DEVICES)
+        return;
+
+    dev = &pci_devices[pci_devices_count++];
+    dev->segment = 0;
+    dev->bus = bus;
+    dev->slot = slot;
+    dev->function = function;
+    dev->vendor_id = (u16)id;
+    dev->device_id = (u16)(id >> 16);
+
+    class_word = pci_read32(dev, PCI_CONFIG__REVISION_ID);
+    dev->revision = (u8)class_word;
+    dev->prog_if = (u8)(class_word >> 8);
+    dev->subclass = (u8)(class_word >> 16);
+    dev->class_code = (u8)(class_word >> 24);
+    dev->header_type = pci_read8(dev, PCI_CONFIG__HEADER_TYPE);
+
+    pci_read_bars(dev);
+
+    return;
+}
+
+int __init pci_init(void)
+{
+    u32 bus;
+    u8 slot;
+    u8 function;
+
+    pci_devices_count = 0;
+
+    for (bus = 0; bus < PCI_MAX_BUSES; bus++)
+    {
+        for (slot = 0; slot < PCI_MAX_SLOTS; slot++)
+        {
+            u32 header = pci_ops->read32(0, (u8)bus, slot, 0, PCI_CONFIG__VENDOR_ID);
+            u8 functions;
+
+            if ((u16)header == PCI_VENDOR__NONE)
+                continue;
+
+            header = pci_ops->read32(0, (u8)bus, slot, 0, PCI_CONFIG__HEADER_TYPE & ~3);
+            functions = (header >> 16) & PCI_HEADER_TYPE__MULTIFUNCTION ? PCI_MAX_FUNCTIONS : 1;
+
+            for (function = 0; function < functions; function++)
+                pci_probe_function((u8)bus, slot, function);
+        }
+    }
+
+    printk("pci: %zu functions\n", pci_devices_count);
+
+    return 0;
+}
+
+size_t pci_device_count(void)
+{
+    return pci_devices_count;
+}
+
+struct pci_device *pci_device_get(size_t index)
+{
+    return index < pci_devices_count ? &pci_devices[index] : NULL;
+}
+
+struct pci_device *pci_find_device(u16 vendor_id, u16 device_id, struct pci_device *from)
+{
+    size_t index = from ? (size_t)(from - pci_devices) + 1 : 0;
+
+    for (; index < pci_devices_count; index++)
+        if (pci_devices[index].vendor_id == vendor_id && pci_devices[index].device_id == device_id)
+            return &pci_devices[index];
+
+    return NULL;
+}
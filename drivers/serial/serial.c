@@ -0,0 +1,54 @@
+#include <types.h>
+#include <arch/cpu.h>
+#include <arch/io.h>
+#include <drivers/serial/serial.h>
+
+#define SERIAL_REG__DATA            0
+#define SERIAL_REG__INTERRUPT       1
+#define SERIAL_REG__FIFO            2
+#define SERIAL_REG__LINE_CONTROL    3
+#define SERIAL_REG__MODEM_CONTROL   4
+#define SERIAL_REG__LINE_STATUS     5
+#define SERIAL_REG__SCRATCH         7
+
+#define SERIAL_LINE_CONTROL__8N1    0x03
+#define SERIAL_LINE_CONTROL__DLAB   0x80
+#define SERIAL_FIFO__ENABLE_CLEAR   0x07
+#define SERIAL_MODEM_CONTROL__READY 0x03    /* DTR | RTS */
+#define SERIAL_LINE_STATUS__THRE    0x20
+
+/* 115200 baud: the divisor of the 1.8432MHz UART clock is 1 */
+#define SERIAL_DIVISOR              1
+
+int serial_init(u16 port)
+{
+    /* Scratch register round trip: nothing decodes the port on machines without the UART */
+    outb(port + SERIAL_REG__SCRATCH, 0x5A);
+    if (inb(port + SERIAL_REG__SCRATCH) != 0x5A)
+        return -1;
+
+    outb(port + SERIAL_REG__INTERRUPT, 0);
+    outb(port + SERIAL_REG__LINE_CONTROL, SERIAL_LINE_CONTROL__DLAB);
+    outb(port + SERIAL_REG__DATA, SERIAL_DIVISOR & 0xFF);
+    outb(port + SERIAL_REG__INTERRUPT, SERIAL_DIVISOR >> 8);
+    outb(port + SERIAL_REG__LINE_CONTROL, SERIAL_LINE_CONTROL__8N1);
+    outb(port + SERIAL_REG__FIFO, SERIAL_FIFO__ENABLE_CLEAR);
+    outb(port + SERIAL_REG__MODEM_CONTROL, SERIAL_MODEM_CONTROL__READY);
+
+    return 0;
+}
+
+void serial_write(u16 port, const void *data, size_t length)
+{
+    const u8 *bytes = data;
+    size_t index;
+
+    for (index = 0; index < length; index++)
+    {
+        while (!(inb(port + SERIAL_REG__LINE_STATUS) & SERIAL_LINE_STATUS__THRE))
+            cpu_relax();
+        outb(port + SERIAL_REG__DATA, bytes[index]);
+    }
+
+    return;
+}
@@ -0,0 +1,191 @@
+#include <types.h>
+#include <arch/cpu.h>
+#include <arch/io.h>
+#include <drivers/pci/pci.h>
+#include <drivers/virtio/virtio.h>
+#include <drivers/virtio/virtqueue.h>
+#include <lib/util.h>
+#include <mm/mmu.h>
+
+/* struct virtio_pci_cap field offsets inside the vendor capability */
+#define VIRTIO_PCI_CAP__CFG_TYPE                ((u16)3)
+#define VIRTIO_PCI_CAP__BAR                     ((u16)4)
+#define VIRTIO_PCI_CAP__OFFSET                  ((u16)8)
+#define VIRTIO_PCI_CAP__LENGTH                  ((u16)12)
+#define VIRTIO_PCI_CAP__NOTIFY_OFF_MULTIPLIER   ((u16)16)
+
+static void *virtio_pci_map_cap(struct pci_device *pci, u8 cap)
+{
+    u8 bar = pci_read8(pci, cap + VIRTIO_PCI_CAP__BAR);
+    u32 offset = pci_read32(pci, cap + VIRTIO_PCI_CAP__OFFSET);
+    u32 length = pci_read32(pci, cap + VIRTIO_PCI_CAP__LENGTH);
+
+    if (bar >= PCI_MAX_BARS || pci->bar_is_io[bar] || pci->bars[bar] == 0)
+        return NULL;
+
+    return mmu_map_io(pci->bars[bar] + offset, length);
+}
+
+int virtio_pci_init(struct virtio_device *vdev, struct pci_device *pci)
+{
+    u8 cap;
+
+    vdev->pci = pci;
+    vdev->common = NULL;
+    vdev->notify_base = NULL;
+    vdev->isr = NULL;
+    vdev->device_cfg = NULL;
+    vdev->features = 0;
+
+    /* The first capability of each type is the preferred one */
+    for (cap = pci_find_capability(pci, PCI_CAP__VENDOR, 0); cap; cap = pci_find_capability(pci, PCI_CAP__VENDOR, cap))
+    {
+        switch (pci_read8(pci, cap + VIRTIO_PCI_CAP__CFG_TYPE))
+        {
+            case VIRTIO_PCI_CAP__COMMON_CFG:
+                if (vdev->common == NULL)
+                    vdev->common = virtio_pci_map_cap(pci, cap);
+                break;
+            case VIRTIO_PCI_CAP__NOTIFY_CFG:
+                if (vdev->notify_base == NULL)
+                {
+                    vdev->notify_base = virtio_pci_map_cap(pci, cap);
+                    vdev->notify_off_multiplier = pci_read32(pci, cap + VIRTIO_PCI_CAP__NOTIFY_OFF_MULTIPLIER);
+                }
+                break;
+            case VIRTIO_PCI_CAP__ISR_CFG:
+                if (vdev->isr == NULL)
+                    vdev->isr = virtio_pci_map_cap(pci, cap);
+                break;
+            case VIRTIO_PCI_CAP__DEVICE_CFG:
+                if (vdev->device_cfg == NULL)
+                    vdev->device_cfg = virtio_pci_map_cap(pci, cap);
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (vdev->common == NULL || vdev->notify_base == NULL)
+        return -1;
+
+    pci_enable(pci, PCI_COMMAND__MEMORY | PCI_COMMAND__BUS_MASTER);
+
+    mmio_write8(&vdev->common->device_status, 0);
+    while (mmio_read8(&vdev->common->device_status) != 0)
+        cpu_relax();
+
+    mmio_write8(&vdev->common->device_status, VIRTIO_STATUS__ACKNOWLEDGE);
+    mmio_write8(&vdev->common->device_status, VIRTIO_STATUS__ACKNOWLEDGE | VIRTIO_STATUS__DRIVER);
+
+    return 0;
+}
+
+int virtio_negotiate(struct virtio_device *vdev, u64 wanted)
+{
+    volatile struct virtio_pci_common_cfg *common = vdev->common;
+    u64 offered;
+
+    mmio_write32(&common->device_feature_select, 0);
+    offered = mmio_read32(&common->device_feature);
+    mmio_write32(&common->device_feature_select, 1);
+    offered |= (u64)mmio_read32(&common->device_feature) << 32;
+
+    vdev->features = offered & (wanted | VIRTIO_F__VERSION_1);
+    if (!virtio_has_feature(vdev, VIRTIO_F__VERSION_1))
+        return -1;
+
+    mmio_write32(&common->driver_feature_select, 0);
+    mmio_write32(&common->driver_feature, (u32)vdev->features);
+    mmio_write32(&common->driver_feature_select, 1);
+    mmio_write32(&common->driver_feature, (u32)(vdev->features >> 32));
+
+    mmio_write8(&common->device_status, mmio_read8(&common->device_status) | VIRTIO_STATUS__FEATURES_OK);
+    if (!(mmio_read8(&common->device_status) & VIRTIO_STATUS__FEATURES_OK))
+        return -1;
+
+    return 0;
+}
+
+u16 virtio_queue_count(struct virtio_device *vdev)
+{
+    return mmio_read16(&vdev->common->num_queues);
+}
+
+int virtio_setup_queue(struct virtio_device *vdev, struct virtqueue *vq, u16 index, u16 max_size)
+{
+    volatile struct virtio_pci_common_cfg *common = vdev->common;
+    u16 size;
+
+    mmio_write16(&common->queue_select, index);
+    size = mmio_read16(&common->queue_size);
+    if (size == 0)
+        return -1;
+
+    /* Round down to a power of two no larger than what the device and caller allow */
+    size = MIN(size, max_size);
+    while (size & (size - 1))
+        size &= size - 1;
+
+    if (virtqueue_init(vq, index, size, virtio_has_feature(vdev, VIRTIO_F__RING_EVENT_IDX)))
+        return -1;
+
+    mmio_write16(&common->queue_size, size);
+    mmio_write16(&common->queue_msix_vector, VIRTIO_MSI__NO_VECTOR);
+    mmio_write64(&common->queue_desc, virt_to_phys((const void *)vq->desc));
+    mmio_write64(&common->queue_driver, virt_to_phys((const void *)vq->avail));
+    mmio_write64(&common->queue_device, virt_to_phys((const void *)vq->used));
+
+    vq->notify = (volatile u16 *)(vdev->notify_base +
+                                  (u32)mmio_read16(&common->queue_notify_off) * vdev->notify_off_multiplier);
+
+    mmio_write16(&common->queue_enable, 1);
+
+    return 0;
+}
+
+void virtio_driver_ok(struct virtio_device *vdev)
+{
+    mmio_write8(&vdev->common->device_status,
+                mmio_read8(&vdev->common->device_status) | VIRTIO_STATUS__DRIVER_OK);
+
+    return;
+}
+
+void virtio_fail(struct virtio_device *vdev)
+{
+    mmio_write8(&vdev->common->device_status,
+                mmio_read8(&vdev->common->device_status) | VIRTIO_STATUS__FAILED);
+
+    return;
+}
+
+u8 virtio_config_read8(struct virtio_device *vdev, u32 offset)
+{
+    return mmio_read8(vdev->device_cfg + offset);
+}
+
+u16 virtio_config_read16(struct virtio_device *vdev, u32 offset)
+{
+    return mmio_read16(vdev->device_cfg + offset);
+}
+
+u32 virtio_config_read32(struct virtio_device *vdev, u32 offset)
+{
+    return mmio_read32(vdev->device_cfg + offset);
+}
+
+u64 virtio_config_read64(struct virtio_device *vdev, u32 offset)
+{
+    u8 generation;
+    u64 value;
+
+    /* A 64-bit field is read as two accesses; retry if the device changed it in between */
+    do
+    {
+        generation = mmio_read8(&vdev->common->config_generation);
+        value = mmio_read64(vdev->device_cfg + offset);
+    } while (generation != mmio_read8(&vdev->common->config_generation));
+
+    return value;
+}
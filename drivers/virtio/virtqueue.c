@@ -0,0 +1,197 @@
+#include <types.h>
+#include <arch/arch.h>
+#include <arch/cpu.h>
+#include <arch/io.h>
+#include <drivers/virtio/virtqueue.h>
+#include <lib/spinlock.h>
+#include <lib/string.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+
+/*
+ * Ring memory, three frames for up to 256 entries:
+ *   frame 0: descriptor table (16 bytes per entry)
+ *   frame 1: available ring at offset 0, used ring at offset VIRTQ_USED_OFFSET
+ *   frame 2: per-descriptor cookies
+ */
+#define VIRTQ_FRAMES        3
+#define VIRTQ_USED_OFFSET   1024
+
+static inline volatile u16 *virtq_used_event(struct virtqueue *vq)
+{
+    return &vq->avail->ring[vq->size];
+}
+
+static inline volatile u16 *virtq_avail_event(struct virtqueue *vq)
+{
+    return (volatile u16 *)&vq->used->ring[vq->size];
+}
+
+/* True when 'event' lies in the window of indices (old, new] just published (spec 2.7.10) */
+static inline bool virtq_need_event(u16 event, u16 new_idx, u16 old_idx)
+{
+    return (u16)(new_idx - event - 1) < (u16)(new_idx - old_idx);
+}
+
+int virtqueue_init(struct virtqueue *vq, u16 index, u16 size, bool event_idx)
+{
+    uintptr_t frames;
+    u8 *base;
+    u16 entry;
+
+    if (size == 0 || size > VIRTQ_MAX_SIZE || (size & (size - 1)))
+        return -1;
+
+    frames = frame_alloc_contig(VIRTQ_FRAMES);
+    if (frames == 0)
+        return -1;
+
+    base = phys_to_virt(frames);
+    memset(base, 0, VIRTQ_FRAMES * PAGE_SIZE);
+
+    vq->index = index;
+    vq->size = size;
+    vq->event_idx = event_idx;
+    vq->desc = (volatile struct virtq_desc *)base;
+    vq->avail = (volatile struct virtq_avail *)(base + PAGE_SIZE);
+    vq->used = (volatile struct virtq_used *)(base + PAGE_SIZE + VIRTQ_USED_OFFSET);
+    vq->cookies = (void **)(base + 2 * PAGE_SIZE);
+    vq->notify = NULL;
+    vq->free_head = 0;
+    vq->num_free = size;
+    vq->avail_idx = 0;
+    vq->published_idx = 0;
+    vq->last_used_idx = 0;
+    vq->kicks = 0;
+    vq->kicks_suppressed = 0;
+    spin_lock_init(&vq->lock);
+
+    for (entry = 0; entry < size - 1; entry++)
+        vq->desc[entry].next = entry + 1;
+
+    return 0;
+}
+
+int virtqueue_add(struct virtqueue *vq, const struct virtq_buf *bufs, u16 count, void *cookie)
+{
+    u16 head = vq->free_head;
+    u16 entry = head;
+    u16 last = head;
+    u16 index;
+
+    if (count == 0 || count > vq->num_free)
+        return -1;
+
+    for (index = 0; index < count; index++)
+    {
+        vq->desc[entry].addr = virt_to_phys(bufs[index].addr);
+        vq->desc[entry].len = bufs[index].len;
+        vq->desc[entry].flags = (bufs[index].device_writable ? VIRTQ_DESC_F__WRITE : 0) |
+                                (index + 1 < count ? VIRTQ_DESC_F__NEXT : 0);
+        last = entry;
+        entry = vq->desc[entry].next;
+    }
+
+    vq->free_head = vq->desc[last].next;
+    vq->num_free -= count;
+    vq->cookies[head] = cookie;
+
+    /* Visible to the device only once avail->idx is published by virtqueue_kick_prepare() */
+    vq->avail->ring[vq->avail_idx & (vq->size - 1)] = head;
+    vq->avail_idx++;
+
+    return 0;
+}
+
+bool virtqueue_kick_prepare(struct virtqueue *vq)
+{
+    u16 old_idx = vq->published_idx;
+    u16 new_idx = vq->avail_idx;
+    bool needed;
+
+    if (old_idx == new_idx)
+        return false;
+
+    /* Descriptors and ring slots must be visible before the index that exposes them */
+    wmb();
+    vq->avail->idx = new_idx;
+    vq->published_idx = new_idx;
+
+    /* The index store must be ordered before reading the device's suppression state */
+    mb();
+
+    if (vq->event_idx)
+        needed = virtq_need_event(*virtq_avail_event(vq), new_idx, old_idx);
+    else
+        needed = !(vq->used->flags & VIRTQ_USED_F__NO_NOTIFY);
+
+    if (needed)
+        vq->kicks++;
+    else
+        vq->kicks_suppressed++;
+
+    return needed;
+}
+
+void virtqueue_notify(struct virtqueue *vq)
+{
+    mmio_write16(vq->notify, vq->index);
+
+    return;
+}
+
+bool virtqueue_has_used(const struct virtqueue *vq)
+{
+    return vq->last_used_idx != vq->used->idx;
+}
+
+void *virtqueue_get_buf(struct virtqueue *vq, u32 *len)
+{
+    volatile struct virtq_used_elem *elem;
+    void *cookie;
+    u16 head;
+    u16 entry;
+
+    if (!virtqueue_has_used(vq))
+        return NULL;
+
+    /* Read the ring entry only after observing the index that covers it */
+    rmb();
+
+    elem = &vq->used->ring[vq->last_used_idx & (vq->size - 1)];
+    head = (u16)elem->id;
+    if (len != NULL)
+        *len = elem->len;
+    vq->last_used_idx++;
+
+    cookie = vq->cookies[head];
+    vq->cookies[head] = NULL;
+
+    for (entry = head; vq->desc[entry].flags & VIRTQ_DESC_F__NEXT; entry = vq->desc[entry].next)
+        vq->num_free++;
+    vq->num_free++;
+    vq->desc[entry].next = vq->free_head;
+    vq->free_head = head;
+
+    return cookie;
+}
+
+void virtqueue_disable_cb(struct virtqueue *vq)
+{
+    /* With event indices the flag is ignored; used_event simply stops advancing */
+    vq->avail->flags |= VIRTQ_AVAIL_F__NO_INTERRUPT;
+
+    return;
+}
+
+/* Re-arms completion notification; returns false if completions raced in meanwhile */
+bool virtqueue_enable_cb(struct virtqueue *vq)
+{
+    vq->avail->flags &= ~VIRTQ_AVAIL_F__NO_INTERRUPT;
+    if (vq->event_idx)
+        *virtq_used_event(vq) = vq->last_used_idx;
+
+    mb();
+
+    return !virtqueue_has_used(vq);
+}
@@ -0,0 +1,73 @@
+#ifndef __INCLUDE__ACPI__ACPI_H__
+#define __INCLUDE__ACPI__ACPI_H__
+
+#include <types.h>
+#include <boot/bootloader.h>
+
+/*
+ * ACPI table cache.
+ *
+ * The RSDP handed over by the bootloader is validated once, every table
+ * listed in the XSDT (or RSDT) is checksummed and mapped, and the result is
+ * indexed by signature. Lookups afterwards are a hash probe, not a walk of
+ * physical memory.
+ */
+
+#define ACPI_SIGNATURE(a, b, c, d)  ((u32)(a) | (u32)(b) << 8 | (u32)(c) << 16 | (u32)(d) << 24)
+
+#define ACPI_SIGNATURE__FADT    ACPI_SIGNATURE('F', 'A', 'C', 'P')
+#define ACPI_SIGNATURE__DSDT    ACPI_SIGNATURE('D', 'S', 'D', 'T')
+#define ACPI_SIGNATURE__MADT    ACPI_SIGNATURE('A', 'P', 'I', 'C')
+#define ACPI_SIGNATURE__HPET    ACPI_SIGNATURE('H', 'P', 'E', 'T')
+#define ACPI_SIGNATURE__MCFG    ACPI_SIGNATURE('M', 'C', 'F', 'G')
+#define ACPI_SIGNATURE__SRAT    ACPI_SIGNATURE('S', 'R', 'A', 'T')
+#define ACPI_SIGNATURE__SLIT    ACPI_SIGNATURE('S', 'L', 'I', 'T')
+
+#define ACPI_MAX_TABLES         64
+
+#define ACPI_GAS__SPACE__MEMORY ((u8)0)
+#define ACPI_GAS__SPACE__IO     ((u8)1)
+
+struct acpi_rsdp
+{
+    char signature[8];      /* "RSD PTR " */
+    u8 checksum;            /* covers the first 20 bytes */
+    char oem_id[6];
+    u8 revision;            /* 0 for ACPI 1.0, 2 and above have the extended fields */
+    u32 rsdt_address;
+    u32 length;
+    u64 xsdt_address;
+    u8 extended_checksum;   /* covers 'length' bytes */
+    u8 reserved[3];
+} __attribute__ ((__packed__));
+
+struct acpi_sdt_header
+{
+    char signature[4];
+    u32 length;
+    u8 revision;
+    u8 checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    u32 oem_revision;
+    u32 creator_id;
+    u32 creator_revision;
+} __attribute__ ((__packed__));
+
+/* Generic Address Structure */
+struct acpi_gas
+{
+    u8 address_space;
+    u8 bit_width;
+    u8 bit_offset;
+    u8 access_size;
+    u64 address;
+} __attribute__ ((__packed__));
+
+int acpi_init(const struct boot_info *boot_info);
+
+/* Returns the 'instance'-th table with this signature (SSDTs repeat), or NULL */
+const struct acpi_sdt_header *acpi_find_table(u32 signature, size_t instance);
+size_t acpi_table_count(void);
+
+#endif /* __INCLUDE__ACPI__ACPI_H__ */
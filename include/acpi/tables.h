@@ -0,0 +1,177 @@
+#ifndef __INCLUDE__ACPI__TABLES_H__
+#define __INCLUDE__ACPI__TABLES_H__
+
+#include <types.h>
+#include <acpi/acpi.h>
+
+/* FADT: only the DSDT pointers are used */
+#define ACPI_FADT__DSDT_OFFSET      40
+#define ACPI_FADT__X_DSDT_OFFSET    140
+
+/* MADT */
+
+#define ACPI_MADT__TYPE__LOCAL_APIC             ((u8)0)
+#define ACPI_MADT__TYPE__IO_APIC                ((u8)1)
+#define ACPI_MADT__TYPE__INTERRUPT_OVERRIDE     ((u8)2)
+#define ACPI_MADT__TYPE__LOCAL_APIC_OVERRIDE    ((u8)5)
+#define ACPI_MADT__TYPE__LOCAL_X2APIC           ((u8)9)
+
+#define ACPI_MADT__LOCAL_APIC__ENABLED          ((u32)1 << 0)
+
+struct acpi_madt
+{
+    struct acpi_sdt_header header;
+    u32 local_apic_address;
+    u32 flags;
+    u8 entries[];
+} __attribute__ ((__packed__));
+
+struct acpi_madt_entry
+{
+    u8 type;
+    u8 length;
+} __attribute__ ((__packed__));
+
+struct acpi_madt_entry__local_apic
+{
+    u8 type;    /* = 0 */
+    u8 length;  /* = 8 */
+    u8 processor_uid;
+    u8 apic_id;
+    u32 flags;
+} __attribute__ ((__packed__));
+
+struct acpi_madt_entry__io_apic
+{
+    u8 type;    /* = 1 */
+    u8 length;  /* = 12 */
+    u8 id;
+    u8 reserved;
+    u32 address;
+    u32 gsi_base;
+} __attribute__ ((__packed__));
+
+struct acpi_madt_entry__interrupt_override
+{
+    u8 type;    /* = 2 */
+    u8 length;  /* = 10 */
+    u8 bus;
+    u8 source;
+    u32 gsi;
+    u16 flags;
+} __attribute__ ((__packed__));
+
+struct acpi_madt_entry__local_apic_override
+{
+    u8 type;    /* = 5 */
+    u8 length;  /* = 12 */
+    u16 reserved;
+    u64 address;
+} __attribute__ ((__packed__));
+
+struct acpi_madt_entry__local_x2apic
+{
+    u8 type;    /* = 9 */
+    u8 length;  /* = 16 */
+    u16 reserved;
+    u32 x2apic_id;
+    u32 flags;
+    u32 processor_uid;
+} __attribute__ ((__packed__));
+
+/* HPET */
+
+struct acpi_hpet
+{
+    struct acpi_sdt_header header;
+    u32 event_timer_block_id;
+    struct acpi_gas base_address;
+    u8 hpet_number;
+    u16 minimum_tick;
+    u8 page_protection;
+} __attribute__ ((__packed__));
+
+/* MCFG */
+
+struct acpi_mcfg_allocation
+{
+    u64 base_address;
+    u16 segment;
+    u8 start_bus;
+    u8 end_bus;
+    u32 reserved;
+} __attribute__ ((__packed__));
+
+struct acpi_mcfg
+{
+    struct acpi_sdt_header header;
+    u64 reserved;
+    struct acpi_mcfg_allocation allocations[];
+} __attribute__ ((__packed__));
+
+/* SRAT */
+
+#define ACPI_SRAT__TYPE__PROCESSOR      ((u8)0)
+#define ACPI_SRAT__TYPE__MEMORY         ((u8)1)
+#define ACPI_SRAT__TYPE__X2APIC         ((u8)2)
+
+#define ACPI_SRAT__ENABLED              ((u32)1 << 0)
+#define ACPI_SRAT__MEMORY__HOTPLUG      ((u32)1 << 1)
+
+struct acpi_srat
+{
+    struct acpi_sdt_header header;
+    u32 reserved1;
+    u64 reserved2;
+    u8 entries[];
+} __attribute__ ((__packed__));
+
+struct acpi_srat_entry__processor
+{
+    u8 type;    /* = 0 */
+    u8 length;  /* = 16 */
+    u8 proximity_domain_low;
+    u8 apic_id;
+    u32 flags;
+    u8 sapic_eid;
+    u8 proximity_domain_high[3];
+    u32 clock_domain;
+} __attribute__ ((__packed__));
+
+struct acpi_srat_entry__memory
+{
+    u8 type;    /* = 1 */
+    u8 length;  /* = 40 */
+    u32 proximity_domain;
+    u16 reserved1;
+    u32 base_low;
+    u32 base_high;
+    u32 length_low;
+    u32 length_high;
+    u32 reserved2;
+    u32 flags;
+    u64 reserved3;
+} __attribute__ ((__packed__));
+
+struct acpi_srat_entry__x2apic
+{
+    u8 type;    /* = 2 */
+    u8 length;  /* = 24 */
+    u16 reserved1;
+    u32 proximity_domain;
+    u32 x2apic_id;
+    u32 flags;
+    u32 clock_domain;
+    u32 reserved2;
+} __attribute__ ((__packed__));
+
+/* SLIT */
+
+struct acpi_slit
+{
+    struct acpi_sdt_header header;
+    u64 locality_count;
+    u8 entries[];   /* locality_count x locality_count relative distances */
+} __attribute__ ((__packed__));
+
+#endif /* __INCLUDE__ACPI__TABLES_H__ */
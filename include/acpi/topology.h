@@ -0,0 +1,70 @@
+#ifndef __INCLUDE__ACPI__TOPOLOGY_H__
+#define __INCLUDE__ACPI__TOPOLOGY_H__
+
+#include <types.h>
+#include <arch/cpu.h>
+
+#define ACPI_MAX_NODES          8
+#define ACPI_MAX_IO_APICS       8
+#define ACPI_MAX_OVERRIDES      16
+#define ACPI_MAX_MEMORY_RANGES  32
+
+/* SLIT distances are relative to 10 for local access */
+#define ACPI_DISTANCE__LOCAL    10
+#define ACPI_DISTANCE__REMOTE   20
+
+struct acpi_topology__cpu
+{
+    u32 apic_id;
+    u32 processor_uid;
+    u32 node;
+};
+
+struct acpi_topology__io_apic
+{
+    u32 id;
+    u32 address;
+    u32 gsi_base;
+};
+
+struct acpi_topology__override
+{
+    u8 source;
+    u32 gsi;
+    u16 flags;
+};
+
+struct acpi_topology__memory
+{
+    u64 base;
+    u64 length;
+    u32 node;
+    bool hotplug;
+};
+
+/*
+ * Interrupt controllers from the MADT and NUMA layout from SRAT/SLIT.
+ * Proximity domains are renumbered densely into nodes 0..node_count-1.
+ * Without an SRAT everything is node 0.
+ */
+struct acpi_topology
+{
+    u64 local_apic_address;
+    size_t cpu_count;
+    struct acpi_topology__cpu cpus[NR_CPUS];
+    size_t io_apic_count;
+    struct acpi_topology__io_apic io_apics[ACPI_MAX_IO_APICS];
+    size_t override_count;
+    struct acpi_topology__override overrides[ACPI_MAX_OVERRIDES];
+    size_t memory_count;
+    struct acpi_topology__memory memory[ACPI_MAX_MEMORY_RANGES];
+    u32 node_count;
+    u32 node_domains[ACPI_MAX_NODES];
+    u8 distance[ACPI_MAX_NODES][ACPI_MAX_NODES];
+};
+
+extern struct acpi_topology acpi_topology;
+
+int acpi_topology_init(void);
+
+#endif /* __INCLUDE__ACPI__TOPOLOGY_H__ */
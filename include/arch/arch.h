@@ -0,0 +1,14 @@
+#ifndef __INCLUDE__ARCH__ARCH_H__
+#define __INCLUDE__ARCH__ARCH_H__
+
+#include <types.h>
+
+/* Select the architecture-specific constants for the current target */
+
+#ifdef __x86_64__
+    #include <arch/x86_64/arch_types.h>
+#else
+    #include <arch/i386/arch_types.h>
+#endif
+
+#endif /* __INCLUDE__ARCH__ARCH_H__ */
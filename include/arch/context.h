@@ -0,0 +1,22 @@
+#ifndef __INCLUDE__ARCH__CONTEXT_H__
+#define __INCLUDE__ARCH__CONTEXT_H__
+
+#include <types.h>
+
+/* Flags and callee-saved registers context_switch() leaves on a suspended stack, below its return address */
+#ifdef __x86_64__
+    #define CONTEXT_SAVED_WORDS     7
+#else
+    #define CONTEXT_SAVED_WORDS     5
+#endif
+
+/*
+ * Pushes the flags and callee-saved registers, stores the stack pointer in
+ * '*save_sp' and resumes the context suspended at 'sp' (src/arch/ARCH/entry.s).
+ */
+void context_switch(uintptr_t *save_sp, uintptr_t sp);
+
+/* Tail of the interrupt entry: restores the struct interrupt_frame at the stack pointer and IRETs */
+extern u8 interrupt_return[];
+
+#endif /* __INCLUDE__ARCH__CONTEXT_H__ */
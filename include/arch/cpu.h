@@ -0,0 +1,147 @@
+#ifndef __INCLUDE__ARCH__CPU_H__
+#define __INCLUDE__ARCH__CPU_H__
+
+#include <types.h>
+#include <arch/gdt.h>
+
+/* Upper bound on the number of CPUs the kernel keeps per-CPU state for */
+#define NR_CPUS 16
+
+/* Compiler and memory barriers */
+#define barrier()   __asm__ volatile ("" : : : "memory")
+#ifdef __x86_64__
+    #define mb()    __asm__ volatile ("lock; addl $0, (%%rsp)" : : : "memory", "cc")
+#else
+    #define mb()    __asm__ volatile ("lock; addl $0, (%%esp)" : : : "memory", "cc")
+#endif
+#define rmb()       barrier()
+#define wmb()       barrier()
+
+static inline void cpu_relax(void)
+{
+    __asm__ volatile ("pause" : : : "memory");
+}
+
+static inline void cpu_halt(void)
+{
+    __asm__ volatile ("hlt");
+}
+
+static inline u64 rdtsc(void)
+{
+    u32 low;
+    u32 high;
+
+    __asm__ volatile ("rdtsc" : "=a"(low), "=d"(high));
+
+    return ((u64)high << 32) | low;
+}
+
+static inline void cpuid(u32 leaf, u32 subleaf, u32 *eax, u32 *ebx, u32 *ecx, u32 *edx)
+{
+    __asm__ volatile ("cpuid"
+                      : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                      : "a"(leaf), "c"(subleaf));
+}
+
+static inline u64 rdmsr(u32 msr)
+{
+    u32 low;
+    u32 high;
+
+    __asm__ volatile ("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+
+    return ((u64)high << 32) | low;
+}
+
+static inline void wrmsr(u32 msr, u64 value)
+{
+    __asm__ volatile ("wrmsr" : : "c"(msr), "a"((u32)value), "d"((u32)(value >> 32)));
+}
+
+static inline uintptr_t read_cr0(void)
+{
+    uintptr_t value;
+
+    __asm__ volatile ("mov %%cr0, %0" : "=r"(value));
+
+    return value;
+}
+
+static inline void write_cr0(uintptr_t value)
+{
+    __asm__ volatile ("mov %0, %%cr0" : : "r"(value) : "memory");
+}
+
+/* Faulting linear address of the last page fault */
+static inline uintptr_t read_cr2(void)
+{
+    uintptr_t value;
+
+    __asm__ volatile ("mov %%cr2, %0" : "=r"(value));
+
+    return value;
+}
+
+static inline uintptr_t read_cr3(void)
+{
+    uintptr_t value;
+
+    __asm__ volatile ("mov %%cr3, %0" : "=r"(value));
+
+    return value;
+}
+
+static inline void write_cr3(uintptr_t value)
+{
+    __asm__ volatile ("mov %0, %%cr3" : : "r"(value) : "memory");
+}
+
+static inline uintptr_t read_cr4(void)
+{
+    uintptr_t value;
+
+    __asm__ volatile ("mov %%cr4, %0" : "=r"(value));
+
+    return value;
+}
+
+static inline void write_cr4(uintptr_t value)
+{
+    __asm__ volatile ("mov %0, %%cr4" : : "r"(value) : "memory");
+}
+
+static inline void invlpg(uintptr_t addr)
+{
+    __asm__ volatile ("invlpg (%0)" : : "r"(addr) : "memory");
+}
+
+/* Initial APIC ID of the executing CPU (CPUID leaf 1, EBX[31:24]) */
+static inline u32 cpu_apic_id(void)
+{
+    u32 eax, ebx, ecx, edx;
+
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+
+    return ebx >> 24;
+}
+
+/*
+ * Dense index of the executing CPU, its position in acpi_topology.cpus
+ * (the boot CPU is 0). Each CPU has loaded its own TSS with gdt_load(),
+ * so the task register tells them apart without a memory access. Until
+ * gdt_init() it holds whatever the boot loader left: out-of-range values
+ * count as the boot CPU.
+ */
+static inline u32 cpu_index(void)
+{
+    u16 selector;
+    u32 index;
+
+    __asm__ volatile ("str %0" : "=r"(selector));
+    index = (u32)(selector - GDT_TSS) / GDT_TSS_SIZE;
+
+    return index < NR_CPUS ? index : 0;
+}
+
+#endif /* __INCLUDE__ARCH__CPU_H__ */
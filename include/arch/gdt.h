@@ -0,0 +1,47 @@
+#ifndef __INCLUDE__ARCH__GDT_H__
+#define __INCLUDE__ARCH__GDT_H__
+
+#include <types.h>
+
+/*
+ * Segment selectors. The user descriptors are ordered the way the fast
+ * system-call instructions expect: SYSRET derives both user selectors
+ * from STAR[63:48] (SS = base + 8, CS = base + 16), SYSEXIT from
+ * SYSENTER_CS (CS = base + 16, SS = base + 24). Each CPU has its own TSS
+ * descriptor after them. The entry code (src/arch/ARCH/entry.s) repeats
+ * these values.
+ */
+#define GDT_KERNEL_CS       0x08
+#define GDT_KERNEL_DS       0x10
+#ifdef __x86_64__
+    #define GDT_USER_BASE   (0x18 | 3)  /* 32-bit user code, never loaded */
+    #define GDT_USER_DS     (0x20 | 3)
+    #define GDT_USER_CS     (0x28 | 3)
+    #define GDT_TSS         0x30
+    #define GDT_TSS_SIZE    16          /* system descriptors take two slots */
+
+    /*
+     * Interrupt stack table slots (1-7) of every CPU's TSS. NMI, #DF and
+     * #MC can arrive on a kernel stack that is unusable or mid-switch, so
+     * their gates always switch to a stack of their own.
+     */
+    #define GDT_IST__NMI            1
+    #define GDT_IST__DOUBLE_FAULT   2
+    #define GDT_IST__MACHINE_CHECK  3
+    #define GDT_IST_STACKS          3
+#else
+    #define GDT_USER_CS     (0x18 | 3)
+    #define GDT_USER_DS     (0x20 | 3)
+    #define GDT_TSS         0x28
+    #define GDT_TSS_SIZE    8
+#endif
+
+/* Builds the GDT with a TSS per CPU and loads both on this CPU */
+void gdt_init(void);
+/* Loads the already built GDT and the TSS of 'cpu' on this CPU, which cpu_index() then returns */
+void gdt_load(u32 cpu);
+
+/* Stack the CPU switches to when an interrupt arrives in user mode */
+void tss_set_kernel_stack(uintptr_t top);
+
+#endif /* __INCLUDE__ARCH__GDT_H__ */
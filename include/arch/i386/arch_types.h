@@ -20,4 +20,17 @@ typedef u8  reg8_t;
 /* Maximum physical address space (4GB for i386) */
 #define MAX_PHYS_ADDR   0xFFFFFFFFUL
 
+/*
+ * mmu_init() identity-maps all 4GB with 4MB pages, but [1GB, 2GB) is
+ * replaced by the user window in process address spaces: only frames
+ * below 1GB are reachable from every context.
+ */
+#define DIRECT_MAP_END_PFN  0x40000UL
+
+/* The frame allocator manages nothing the kernel could not reach */
+#define MEMORY_END_PFN      DIRECT_MAP_END_PFN
+
+#define USER_BASE       0x40000000UL
+#define USER_END        0x80000000UL
+
 #endif /* __INCLUDE__ARCH_I386_ARCH_TYPES_H__ */
@@ -0,0 +1,108 @@
+#ifndef __INCLUDE__ARCH__INTERRUPT_H__
+#define __INCLUDE__ARCH__INTERRUPT_H__
+
+#include <types.h>
+
+#define INTERRUPT_VECTORS               256
+
+/* Vectors 0-31 are CPU exceptions */
+#define INTERRUPT_VECTOR__DEBUG         1
+#define INTERRUPT_VECTOR__NMI           2
+#define INTERRUPT_VECTOR__DOUBLE_FAULT  8
+#define INTERRUPT_VECTOR__PAGE_FAULT    14
+#define INTERRUPT_VECTOR__MACHINE_CHECK 18
+#define INTERRUPT_VECTOR__EXCEPTIONS    32
+
+#define EFLAGS__FIXED                   ((uintptr_t)1 << 1)     /* always set */
+#define EFLAGS__TF                      ((uintptr_t)1 << 8)
+#define EFLAGS__IF                      ((uintptr_t)1 << 9)
+#define EFLAGS__DF                      ((uintptr_t)1 << 10)
+
+/* Page-fault error code */
+#define PAGE_FAULT__PRESENT             ((uintptr_t)1 << 0)     /* protection violation, not a missing page */
+#define PAGE_FAULT__WRITE               ((uintptr_t)1 << 1)
+#define PAGE_FAULT__USER                ((uintptr_t)1 << 2)
+
+/*
+ * Register state saved by the entry stubs (src/arch/ARCH/entry.s), lowest
+ * address first. 'vector' and 'error_code' are pushed by the stub (0 when
+ * the CPU supplies no error code); the rest of the tail is the CPU's own
+ * interrupt frame.
+ */
+struct interrupt_frame
+{
+#ifdef __x86_64__
+    u64 r15;
+    u64 r14;
+    u64 r13;
+    u64 r12;
+    u64 r11;
+    u64 r10;
+    u64 r9;
+    u64 r8;
+    u64 rbp;
+    u64 rdi;
+    u64 rsi;
+    u64 rdx;
+    u64 rcx;
+    u64 rbx;
+    u64 rax;
+#else
+    u32 edi;
+    u32 esi;
+    u32 ebp;
+    u32 esp_ignored;    /* 'pusha' copy, not restored */
+    u32 ebx;
+    u32 edx;
+    u32 ecx;
+    u32 eax;
+    u32 es;
+    u32 ds;
+#endif
+    uintptr_t vector;
+    uintptr_t error_code;
+    uintptr_t ip;
+    uintptr_t cs;
+    uintptr_t flags;
+    /* On i386 only present when the interrupt changed privilege level */
+    uintptr_t sp;
+    uintptr_t ss;
+};
+
+/* Points every IDT vector at its entry stub and loads the IDT on this CPU */
+void idt_init(void);
+/* Loads the already built IDT, for CPUs started after idt_init() */
+void idt_load(void);
+
+static inline void interrupts_enable(void)
+{
+    __asm__ volatile ("sti" : : : "memory");
+}
+
+static inline void interrupts_disable(void)
+{
+    __asm__ volatile ("cli" : : : "memory");
+}
+
+/* Enables interrupts and halts until one arrives: STI delays them past HLT, so none is missed in between */
+static inline void interrupts_enable_halt(void)
+{
+    __asm__ volatile ("sti\n\thlt" : : : "memory");
+}
+
+/* Disables interrupts and returns the previous flags for interrupts_restore() */
+static inline uintptr_t interrupts_save(void)
+{
+    uintptr_t flags;
+
+    __asm__ volatile ("pushf\n\tpop %0\n\tcli" : "=r"(flags) : : "memory");
+
+    return flags;
+}
+
+static inline void interrupts_restore(uintptr_t flags)
+{
+    __asm__ volatile ("push %0\n\tpopf" : : "r"(flags) : "memory", "cc");
+}
+
+#endif /* __INCLUDE__ARCH__INTERRUPT_H__ */
@@ -0,0 +1,97 @@
+#ifndef __INCLUDE__ARCH__IO_H__
+#define __INCLUDE__ARCH__IO_H__
+
+#include <types.h>
+
+/* Port I/O (identical on i386 and x86_64) */
+
+static inline void outb(u16 port, u8 value)
+{
+    __asm__ volatile ("outb %0, %1" : : "a"(value), "Nd"(port));
+}
+
+static inline void outw(u16 port, u16 value)
+{
+    __asm__ volatile ("outw %0, %1" : : "a"(value), "Nd"(port));
+}
+
+static inline void outl(u16 port, u32 value)
+{
+    __asm__ volatile ("outl %0, %1" : : "a"(value), "Nd"(port));
+}
+
+static inline u8 inb(u16 port)
+{
+    u8 value;
+
+    __asm__ volatile ("inb %1, %0" : "=a"(value) : "Nd"(port));
+
+    return value;
+}
+
+static inline u16 inw(u16 port)
+{
+    u16 value;
+
+    __asm__ volatile ("inw %1, %0" : "=a"(value) : "Nd"(port));
+
+    return value;
+}
+
+static inline u32 inl(u16 port)
+{
+    u32 value;
+
+    __asm__ volatile ("inl %1, %0" : "=a"(value) : "Nd"(port));
+
+    return value;
+}
+
+/* Memory-mapped I/O: the volatile access keeps the compiler from merging or reordering device accesses */
+
+static inline u8 mmio_read8(const volatile void *addr)
+{
+    return *(const volatile u8 *)addr;
+}
+
+static inline u16 mmio_read16(const volatile void *addr)
+{
+    return *(const volatile u16 *)addr;
+}
+
+static inline u32 mmio_read32(const volatile void *addr)
+{
+    return *(const volatile u32 *)addr;
+}
+
+static inline void mmio_write8(volatile void *addr, u8 value)
+{
+    *(volatile u8 *)addr = value;
+}
+
+static inline void mmio_write16(volatile void *addr, u16 value)
+{
+    *(volatile u16 *)addr = value;
+}
+
+static inline void mmio_write32(volatile void *addr, u32 value)
+{
+    *(volatile u32 *)addr = value;
+}
+
+/* 64-bit registers are accessed as two halves, low first, which every device we drive accepts */
+static inline u64 mmio_read64(const volatile void *addr)
+{
+    u64 low = mmio_read32(addr);
+    u64 high = mmio_read32((const volatile u8 *)addr + 4);
+
+    return low | (high << 32);
+}
+
+static inline void mmio_write64(volatile void *addr, u64 value)
+{
+    mmio_write32(addr, (u32)value);
+    mmio_write32((volatile u8 *)addr + 4, (u32)(value >> 32));
+}
+
+#endif /* __INCLUDE__ARCH__IO_H__ */
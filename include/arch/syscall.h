@@ -0,0 +1,47 @@
+#ifndef __INCLUDE__ARCH__SYSCALL_H__
+#define __INCLUDE__ARCH__SYSCALL_H__
+
+#include <types.h>
+
+/*
+ * User registers saved by the fast system-call entry (src/arch/ARCH/entry.s),
+ * lowest address first. The number arrives in RAX/EAX and the result goes
+ * back in it.
+ *
+ * x86_64, SYSCALL: arguments in RDI, RSI, RDX, R10, R8, R9; RCX and R11
+ * are clobbered (they carry the return RIP and RFLAGS).
+ *
+ * i386, SYSENTER: arguments in EBX, ESI, EDI, EBP; the caller passes its
+ * return address in EDX and its stack pointer in ECX, both clobbered.
+ */
+struct syscall_frame
+{
+#ifdef __x86_64__
+    u64 arg5;
+    u64 arg4;
+    u64 arg3;
+    u64 arg2;
+    u64 arg1;
+    u64 arg0;
+    u64 value;
+    u64 ip;
+    u64 flags;
+    u64 sp;
+#else
+    u32 arg3;
+    u32 arg2;
+    u32 arg1;
+    u32 arg0;
+    u32 value;
+    u32 ip;
+    u32 sp;
+#endif
+};
+
+/* Points this CPU's SYSCALL (or SYSENTER) MSRs at the entry code; -1 if the CPU lacks the instruction */
+int syscall_init(void);
+
+/* Stack the entry code switches to, the top of the running process's kernel stack */
+void syscall_set_kernel_stack(uintptr_t top);
+
+#endif /* __INCLUDE__ARCH__SYSCALL_H__ */
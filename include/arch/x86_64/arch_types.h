@@ -33,4 +33,14 @@ typedef u8  reg8_t;
 /* Maximum physical address space (architecture dependent, typically 52 bits) */
 #define MAX_PHYS_ADDR   0x000FFFFFFFFFFFFFUL
 
+/* boot.s identity-maps the first 1GB with 2MB pages */
+#define DIRECT_MAP_END_PFN  0x40000UL
+
+/* frame_init() maps available RAM above it on the way, up to 256GB (well clear of the user window) */
+#define MEMORY_END_PFN      0x4000000UL
+
+/* User mode owns the last PML4 slot of the lower half; the kernel mapping is shared above and below */
+#define USER_BASE       0x00007F8000000000UL
+#define USER_END        0x0000800000000000UL
+
 #endif /* __INCLUDE__ARCH_X86_64_ARCH_TYPES_H__ */
@@ -0,0 +1,16 @@
+#ifndef __INCLUDE__BENCH__BCACHEBENCH_H__
+#define __INCLUDE__BENCH__BCACHEBENCH_H__
+
+#include <types.h>
+#include <block/blkdev.h>
+
+/*
+ * Buffer cache workload on a block device: a sequential read for
+ * read-ahead, re-reads of a small working set for hits, a rewrite of that
+ * set with its own contents for write-back, and a scan past the cache's
+ * capacity for eviction, after which the working set should still hit.
+ * Enabled with the "bcachebench" kernel command-line option.
+ */
+int bcachebench_run(struct blk_device *dev);
+
+#endif /* __INCLUDE__BENCH__BCACHEBENCH_H__ */
@@ -0,0 +1,14 @@
+#ifndef __INCLUDE__BENCH__BLKBENCH_H__
+#define __INCLUDE__BENCH__BLKBENCH_H__
+
+#include <types.h>
+#include <block/blkdev.h>
+
+/*
+ * fio-style 4KiB random-read run against a block device at several queue
+ * depths, reporting IOPS and completion-latency percentiles.
+ * Enabled with the "blkbench" kernel command-line option.
+ */
+int blkbench_run(struct blk_device *dev);
+
+#endif /* __INCLUDE__BENCH__BLKBENCH_H__ */
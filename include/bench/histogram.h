@@ -0,0 +1,27 @@
+#ifndef __INCLUDE__BENCH__HISTOGRAM_H__
+#define __INCLUDE__BENCH__HISTOGRAM_H__
+
+#include <types.h>
+
+/*
+ * Log-linear latency histogram: every power of two is split into 16
+ * buckets, so any recorded value is reported within 1/16 of itself.
+ */
+#define HISTOGRAM_SUB_BITS  4
+#define HISTOGRAM_BUCKETS   ((64 - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS)
+
+struct histogram
+{
+    u64 count;
+    u64 min;
+    u64 max;
+    u32 buckets[HISTOGRAM_BUCKETS];
+};
+
+void histogram_reset(struct histogram *histogram);
+void histogram_record(struct histogram *histogram, u64 value);
+
+/* Value at the given percentile, expressed in hundredths of a percent (9990 = p99.9) */
+u64 histogram_percentile(const struct histogram *histogram, u32 permyriad);
+
+#endif /* __INCLUDE__BENCH__HISTOGRAM_H__ */
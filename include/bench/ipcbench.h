@@ -0,0 +1,35 @@
+#ifndef __INCLUDE__BENCH__IPCBENCH_H__
+#define __INCLUDE__BENCH__IPCBENCH_H__
+
+#include <types.h>
+#include <arch/arch.h>
+
+/* Roles of the user program (user/ipcbench.c), its first argument; the second is the port */
+#define IPCBENCH__SERVER        0x10
+#define IPCBENCH__CLIENT        0x11
+
+/* Message labels of the benchmark protocol */
+#define IPCBENCH_LABEL__PING    1   /* w0 comes back incremented */
+#define IPCBENCH_LABEL__DATA    2   /* w0 comes back as the sum of the first word of every page */
+#define IPCBENCH_LABEL__QUIT    3
+
+/* Iterations, powers of two */
+#define IPCBENCH_PING_SHIFT     14
+#define IPCBENCH_BULK_SHIFT     6
+
+/* Bulk messages grow by 4x from IPCBENCH_MIN_SIZE to IPCBENCH_MAX_SIZE */
+#define IPCBENCH_MIN_SIZE       PAGE_SIZE
+#define IPCBENCH_MAX_SIZE       (1U << 20)
+
+#define IPCBENCH_BUFFER         (USER_BASE + 0x1000000)     /* the client's data */
+#define IPCBENCH_WINDOW         (USER_BASE + 0x2000000)     /* the server's receive window */
+
+/*
+ * Runs a client and a server process on one port. The client reports the
+ * call/reply round trip, then the throughput of bulk messages across
+ * sizes, copied and mapped. Enabled with the "ipcbench" kernel
+ * command-line option.
+ */
+int ipcbench_run(void);
+
+#endif /* __INCLUDE__BENCH__IPCBENCH_H__ */
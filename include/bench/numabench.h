@@ -0,0 +1,13 @@
+#ifndef __INCLUDE__BENCH__NUMABENCH_H__
+#define __INCLUDE__BENCH__NUMABENCH_H__
+
+#include <types.h>
+
+/*
+ * Memory bandwidth from the boot CPU with the buffer on its own node,
+ * interleaved page by page across all nodes, and on the farthest node.
+ * Enabled with the "numabench" kernel command-line option.
+ */
+int numabench_run(void);
+
+#endif /* __INCLUDE__BENCH__NUMABENCH_H__ */
@@ -0,0 +1,23 @@
+#ifndef __INCLUDE__BENCH__SYSCALLBENCH_H__
+#define __INCLUDE__BENCH__SYSCALLBENCH_H__
+
+#include <types.h>
+
+/* Tests of the user program (user/bench.c), passed as its first argument */
+#define SYSCALLBENCH__NOP           0   /* SYS_NOP round trip */
+#define SYSCALLBENCH__CLOCK_VDSO    1   /* clock read from the shared time page */
+#define SYSCALLBENCH__CLOCK_SYSCALL 2   /* the same clock through SYS_CLOCK_NS */
+#define SYSCALLBENCH_TESTS          3
+
+/* Iterations are a power of two, passed as the shift in the second argument */
+#define SYSCALLBENCH_SHIFT          16
+#define SYSCALLBENCH_BATCH_SHIFT    8
+
+/*
+ * Runs each test in a fresh user process, which reports its own average
+ * and best-batch latency. Enabled with the "syscallbench" kernel
+ * command-line option.
+ */
+int syscallbench_run(void);
+
+#endif /* __INCLUDE__BENCH__SYSCALLBENCH_H__ */
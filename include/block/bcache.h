@@ -0,0 +1,82 @@
+#ifndef __INCLUDE__BLOCK__BCACHE_H__
+#define __INCLUDE__BLOCK__BCACHE_H__
+
+#include <types.h>
+#include <arch/arch.h>
+#include <block/blkdev.h>
+
+/*
+ * Block buffer cache.
+ *
+ * Buffers are keyed by (device, block) in a hash table with one lock per
+ * bucket, so a hit never touches the replacement state beyond setting a
+ * reference bit. Replacement is CLOCK-Pro: resident pages are hot or
+ * cold, recently evicted cold pages are remembered as non-resident "test"
+ * entries, and a re-reference during the test period promotes a page to
+ * hot and grows the cold allocation. One-time scans therefore only cycle
+ * through the cold pages and leave the hot working set alone.
+ */
+
+#define BCACHE_BLOCK_SIZE           PAGE_SIZE
+#define BCACHE_SECTORS_PER_BLOCK    (BCACHE_BLOCK_SIZE / BLK_SECTOR_SIZE)
+
+#define BCACHE_F__VALID         ((u32)1 << 0)
+#define BCACHE_F__DIRTY         ((u32)1 << 1)
+#define BCACHE_F__IO            ((u32)1 << 2)
+#define BCACHE_F__REFERENCED    ((u32)1 << 3)
+#define BCACHE_F__HOT           ((u32)1 << 4)
+#define BCACHE_F__TEST          ((u32)1 << 5)
+#define BCACHE_F__RESIDENT      ((u32)1 << 6)
+#define BCACHE_F__READAHEAD     ((u32)1 << 7)
+#define BCACHE_F__ERROR         ((u32)1 << 8)
+
+struct bcache_buf
+{
+    struct blk_device *dev;
+    u64 block;
+    void *data;
+    volatile u32 flags;
+    u32 refcount;
+    struct bcache_buf *hash_next;
+    struct bcache_buf *clock_prev;
+    struct bcache_buf *clock_next;
+};
+
+struct bcache_stats
+{
+    u64 hits;
+    u64 misses;
+    u64 test_hits;          /* misses on a block still remembered as non-resident */
+    u64 evictions;
+    u64 readahead_blocks;
+    u64 readahead_hits;
+    u64 readahead_wasted;   /* read ahead but evicted before first use */
+    u64 writeback_blocks;
+    u64 writeback_requests;
+    size_t capacity;
+    size_t hot;
+    size_t cold;
+    size_t test;
+    size_t dirty;
+    size_t cold_target;
+};
+
+/* Takes 'frames' data frames from the frame allocator; 0 picks 1/8 of free memory */
+int bcache_init(size_t frames);
+
+/* Returns the block with valid contents and a reference held, or NULL on I/O error */
+struct bcache_buf *bcache_read(struct blk_device *dev, u64 block);
+
+/* Returns the block without reading it, for callers that overwrite it entirely */
+struct bcache_buf *bcache_get(struct blk_device *dev, u64 block);
+
+void bcache_mark_dirty(struct bcache_buf *buf);
+void bcache_release(struct bcache_buf *buf);
+
+/* Writes every dirty block of 'dev' back, merged into multi-segment requests */
+int bcache_sync(struct blk_device *dev);
+
+void bcache_get_stats(struct bcache_stats *stats);
+void bcache_print_stats(void);
+
+#endif /* __INCLUDE__BLOCK__BCACHE_H__ */
@@ -0,0 +1,82 @@
+#ifndef __INCLUDE__BLOCK__BLKDEV_H__
+#define __INCLUDE__BLOCK__BLKDEV_H__
+
+#include <types.h>
+
+#define BLK_SECTOR_SIZE     512
+#define BLK_SECTOR_SHIFT    9
+#define BLK_MAX_SEGMENTS    16
+#define BLK_MAX_DEVICES     8
+
+#define BLK_STATUS__OK          0
+#define BLK_STATUS__IO_ERROR    (-1)
+#define BLK_STATUS__UNSUPPORTED (-2)
+
+enum blk_op
+{
+    BLK_OP__READ,
+    BLK_OP__WRITE,
+    BLK_OP__FLUSH,
+};
+
+struct blk_segment
+{
+    void *buf;
+    u32 length;
+};
+
+/*
+ * An asynchronous request. The submitter owns the structure until end_io()
+ * runs; end_io() is called from blk_poll() and may submit new requests.
+ */
+struct blk_request
+{
+    enum blk_op op;
+    u64 sector;
+    u16 segment_count;
+    struct blk_segment segments[BLK_MAX_SEGMENTS];
+    int status;
+    void (*end_io)(struct blk_request *req);
+    void *private;
+    u64 submit_tsc;
+};
+
+struct blk_device;
+
+struct blk_device_ops
+{
+    /* Queues the request on the submitting CPU's hardware queue; -1 if that queue is full */
+    int (*submit)(struct blk_device *dev, struct blk_request *req);
+    /* Rings the doorbell of every queue with requests added since the last commit */
+    void (*commit)(struct blk_device *dev);
+    /* Completes finished requests; returns how many end_io() calls were made */
+    size_t (*poll)(struct blk_device *dev);
+};
+
+struct blk_device
+{
+    const char *name;
+    u64 sector_count;
+    u32 block_size;
+    u16 queue_count;
+    u16 queue_depth;
+    const struct blk_device_ops *ops;
+    void *driver_data;
+};
+
+int blk_register(struct blk_device *dev);
+size_t blk_device_count(void);
+struct blk_device *blk_get(size_t index);
+
+int blk_submit(struct blk_device *dev, struct blk_request *req);
+/* Submits as many requests as fit with a single doorbell; returns the number accepted */
+size_t blk_submit_batch(struct blk_device *dev, struct blk_request **reqs, size_t count);
+size_t blk_poll(struct blk_device *dev);
+
+/* Called by drivers from poll() for each finished request, once req->status is set */
+void blk_end_request(struct blk_request *req);
+
+/* Synchronous helper for a single contiguous buffer; returns a BLK_STATUS__ value */
+int blk_rw_sync(struct blk_device *dev, enum blk_op op, u64 sector, void *buf, u32 length);
+
+#endif /* __INCLUDE__BLOCK__BLKDEV_H__ */
@@ -4,6 +4,38 @@
 #include <types.h>
 #include <boot/multiboot2.h>
 
-int bootloader(u32 multiboot2_magic_number, struct mb2_info_tag *mb2_info_tag);
+#define BOOT_INFO__MAX_MODULES      8
+#define BOOT_INFO__COMMAND_LINE_SIZE 256
+
+struct boot_info__module
+{
+    uintptr_t start;
+    uintptr_t end;
+    const char *string;
+};
+
+/*
+ * What the kernel keeps from the Multiboot2 information after the tag walk.
+ * The command line is copied out; every other pointer refers into the
+ * Multiboot2 information and is cleared when reclaim_boot_memory() frees it.
+ */
+struct boot_info
+{
+    uintptr_t mb2_info_start;
+    uintptr_t mb2_info_end;
+    const char *command_line;
+    const char *boot_loader_name;
+    struct mb2_info_tag__memory_map *memory_map;
+    struct mb2_info_tag__efi_memory_map *efi_memory_map;
+    bool efi_boot_services;     /* ExitBootServices() was not called */
+    const void *acpi_rsdp;
+    size_t module_count;
+    struct boot_info__module modules[BOOT_INFO__MAX_MODULES];
+};
+
+extern struct boot_info boot_info;
+
+int bootloader(u32 multiboot2_magic_number, struct mb2_info *mb2_info);
+bool boot_info_has_option(const char *option);
 
 #endif /* __INCLUDE__BOOT__BOOTLOADER_H__ */
\ No newline at end of file
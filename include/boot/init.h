@@ -0,0 +1,18 @@
+#ifndef __INCLUDE__BOOT__INIT_H__
+#define __INCLUDE__BOOT__INIT_H__
+
+#include <types.h>
+
+/*
+ * Code and data only needed while the kernel initialises. The linker
+ * script gathers them into one page-aligned region between _init_start
+ * and _init_end, which reclaim_boot_memory() hands back to the frame
+ * allocator. Nothing marked here may be referenced after that point.
+ */
+#define __init      __attribute__ ((__section__(".init.text"), __cold__))
+#define __initdata  __attribute__ ((__section__(".init.data")))
+
+extern u8 _init_start[];
+extern u8 _init_end[];
+
+#endif /* __INCLUDE__BOOT__INIT_H__ */
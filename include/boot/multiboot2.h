@@ -163,6 +163,13 @@ struct mb2_info_tag
     u32 size;
 } __attribute__ ((__packed__));
 
+struct mb2_info
+{
+    u32 total_size;
+    u32 reserved;
+    struct mb2_info_tag tags[];
+} __attribute__ ((__packed__));
+
 struct mb2_info_tag__boot_command_line
 {
     u32 type;   /* = 1 */
@@ -346,6 +353,25 @@ struct mb2_info_tag__efi_memory_map
     u8 efi_memory_map[];
 } __attribute__ ((__packed__));
 
+/* UEFI memory descriptor, 'descriptor_size' bytes apart in efi_memory_map[] */
+#define MB2_INFO_TAG__EFI_MEMORY_MAP__TYPE__LOADER_CODE         ((u32)1)
+#define MB2_INFO_TAG__EFI_MEMORY_MAP__TYPE__LOADER_DATA         ((u32)2)
+#define MB2_INFO_TAG__EFI_MEMORY_MAP__TYPE__BOOT_SERVICES_CODE  ((u32)3)
+#define MB2_INFO_TAG__EFI_MEMORY_MAP__TYPE__BOOT_SERVICES_DATA  ((u32)4)
+#define MB2_INFO_TAG__EFI_MEMORY_MAP__TYPE__CONVENTIONAL        ((u32)7)
+
+#define MB2_INFO_TAG__EFI_MEMORY_MAP__PAGE_SHIFT 12
+
+struct mb2_info_tag__efi_memory_map__descriptor
+{
+    u32 type;
+    u32 pad;
+    u64 physical_start;
+    u64 virtual_start;
+    u64 page_count;
+    u64 attribute;
+} __attribute__ ((__packed__));
+
 struct mb2_info_tag__efi_boot_service
 {
     u32 type;   /* = 18 */
@@ -0,0 +1,40 @@
+#ifndef __INCLUDE__DRIVERS__BLOCK__VIRTIO_BLK_H__
+#define __INCLUDE__DRIVERS__BLOCK__VIRTIO_BLK_H__
+
+#include <types.h>
+
+#define VIRTIO_BLK_MAX_DEVICES  4
+#define VIRTIO_BLK_MAX_QUEUES   16
+
+#define VIRTIO_BLK_F__SIZE_MAX  ((u64)1 << 1)
+#define VIRTIO_BLK_F__SEG_MAX   ((u64)1 << 2)
+#define VIRTIO_BLK_F__BLK_SIZE  ((u64)1 << 6)
+#define VIRTIO_BLK_F__FLUSH     ((u64)1 << 9)
+#define VIRTIO_BLK_F__MQ        ((u64)1 << 12)
+
+/* Device configuration layout offsets */
+#define VIRTIO_BLK_CONFIG__CAPACITY     ((u32)0)
+#define VIRTIO_BLK_CONFIG__SIZE_MAX     ((u32)8)
+#define VIRTIO_BLK_CONFIG__SEG_MAX      ((u32)12)
+#define VIRTIO_BLK_CONFIG__BLK_SIZE     ((u32)20)
+#define VIRTIO_BLK_CONFIG__NUM_QUEUES   ((u32)34)
+
+#define VIRTIO_BLK_T__IN        ((u32)0)
+#define VIRTIO_BLK_T__OUT       ((u32)1)
+#define VIRTIO_BLK_T__FLUSH     ((u32)4)
+
+#define VIRTIO_BLK_S__OK        ((u8)0)
+#define VIRTIO_BLK_S__IOERR     ((u8)1)
+#define VIRTIO_BLK_S__UNSUPP    ((u8)2)
+
+struct virtio_blk_req_hdr
+{
+    u32 type;
+    u32 reserved;
+    u64 sector;
+} __attribute__ ((__packed__));
+
+/* Probes every virtio-blk PCI function through its modern interface and registers it as a block device */
+int virtio_blk_init(void);
+
+#endif /* __INCLUDE__DRIVERS__BLOCK__VIRTIO_BLK_H__ */
@@ -0,0 +1,85 @@
+#ifndef __INCLUDE__DRIVERS__PCI__PCI_H__
+#define __INCLUDE__DRIVERS__PCI__PCI_H__
+
+#include <types.h>
+
+#define PCI_MAX_DEVICES 64
+#define PCI_MAX_BARS    6
+
+/* Configuration space header (type 0) */
+#define PCI_CONFIG__VENDOR_ID       ((u16)0x00)
+#define PCI_CONFIG__DEVICE_ID       ((u16)0x02)
+#define PCI_CONFIG__COMMAND         ((u16)0x04)
+#define PCI_CONFIG__STATUS          ((u16)0x06)
+#define PCI_CONFIG__REVISION_ID     ((u16)0x08)
+#define PCI_CONFIG__PROG_IF         ((u16)0x09)
+#define PCI_CONFIG__SUBCLASS        ((u16)0x0A)
+#define PCI_CONFIG__CLASS_CODE      ((u16)0x0B)
+#define PCI_CONFIG__HEADER_TYPE     ((u16)0x0E)
+#define PCI_CONFIG__BAR0            ((u16)0x10)
+#define PCI_CONFIG__SUBSYSTEM_ID    ((u16)0x2E)
+#define PCI_CONFIG__CAPABILITIES    ((u16)0x34)
+#define PCI_CONFIG__INTERRUPT_LINE  ((u16)0x3C)
+
+#define PCI_COMMAND__IO             ((u16)0x0001)
+#define PCI_COMMAND__MEMORY         ((u16)0x0002)
+#define PCI_COMMAND__BUS_MASTER     ((u16)0x0004)
+#define PCI_COMMAND__INTX_DISABLE   ((u16)0x0400)
+
+#define PCI_STATUS__CAPABILITIES    ((u16)0x0010)
+
+#define PCI_HEADER_TYPE__MASK           ((u8)0x7F)
+#define PCI_HEADER_TYPE__MULTIFUNCTION  ((u8)0x80)
+
+#define PCI_CAP__MSI                ((u8)0x05)
+#define PCI_CAP__VENDOR             ((u8)0x09)
+#define PCI_CAP__PCI_EXPRESS        ((u8)0x10)
+#define PCI_CAP__MSIX               ((u8)0x11)
+
+#define PCI_VENDOR__NONE            ((u16)0xFFFF)
+
+struct pci_device
+{
+    u16 segment;
+    u8 bus;
+    u8 slot;
+    u8 function;
+    u16 vendor_id;
+    u16 device_id;
+    u8 class_code;
+    u8 subclass;
+    u8 prog_if;
+    u8 revision;
+    u8 header_type;
+    u64 bars[PCI_MAX_BARS];
+    bool bar_is_io[PCI_MAX_BARS];
+};
+
+/* Configuration space access method; legacy port 0xCF8/0xCFC cycles by default */
+struct pci_config_ops
+{
+    u32 (*read32)(u16 segment, u8 bus, u8 slot, u8 function, u16 offset);
+    void (*write32)(u16 segment, u8 bus, u8 slot, u8 function, u16 offset, u32 value);
+};
+
+int pci_init(void);
+void pci_set_config_ops(const struct pci_config_ops *ops);
+
+/* Switches configuration access to the PCIe ECAM windows listed in the ACPI MCFG table */
+int pci_ecam_init(void);
+
+size_t pci_device_count(void);
+struct pci_device *pci_device_get(size_t index);
+struct pci_device *pci_find_device(u16 vendor_id, u16 device_id, struct pci_device *from);
+
+u8 pci_read8(const struct pci_device *dev, u16 offset);
+u16 pci_read16(const struct pci_device *dev, u16 offset);
+u32 pci_read32(const struct pci_device *dev, u16 offset);
+void pci_write16(const struct pci_device *dev, u16 offset, u16 value);
+void pci_write32(const struct pci_device *dev, u16 offset, u32 value);
+
+/* Returns the config offset of the next capability 'cap_id' after 'from' (0 to start), or 0 */
+u8 pci_find_capability(const struct pci_device *dev, u8 cap_id, u8 from);
+void pci_enable(const struct pci_device *dev, u16 command);
+
+#endif /* __INCLUDE__DRIVERS__PCI__PCI_H__ */
@@ -0,0 +1,14 @@
+#ifndef __INCLUDE__DRIVERS__SERIAL__SERIAL_H__
+#define __INCLUDE__DRIVERS__SERIAL__SERIAL_H__
+
+#include <types.h>
+
+#define SERIAL_COM1     0x3F8
+
+/* Programs the 16550 at 'port' for 115200 baud 8N1; -1 if no UART answers there */
+int serial_init(u16 port);
+
+/* Polled, byte-transparent output: binary data goes out unchanged */
+void serial_write(u16 port, const void *data, size_t length);
+
+#endif /* __INCLUDE__DRIVERS__SERIAL__SERIAL_H__ */
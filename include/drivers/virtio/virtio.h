@@ -0,0 +1,89 @@
+#ifndef __INCLUDE__DRIVERS__VIRTIO__VIRTIO_H__
+#define __INCLUDE__DRIVERS__VIRTIO__VIRTIO_H__
+
+#include <types.h>
+#include <drivers/pci/pci.h>
+#include <drivers/virtio/virtqueue.h>
+
+#define VIRTIO_PCI_VENDOR_ID            ((u16)0x1AF4)
+/* Modern (virtio 1.x) devices use 0x1040 + device type */
+#define VIRTIO_PCI_DEVICE_ID__MODERN    ((u16)0x1040)
+#define VIRTIO_DEVICE_TYPE__BLOCK       ((u16)2)
+/* Transitional devices keep their legacy IDs but expose the modern capabilities too */
+#define VIRTIO_PCI_DEVICE_ID__TRANSITIONAL_BLOCK ((u16)0x1001)
+
+#define VIRTIO_STATUS__ACKNOWLEDGE      ((u8)1)
+#define VIRTIO_STATUS__DRIVER           ((u8)2)
+#define VIRTIO_STATUS__DRIVER_OK        ((u8)4)
+#define VIRTIO_STATUS__FEATURES_OK      ((u8)8)
+#define VIRTIO_STATUS__NEEDS_RESET      ((u8)64)
+#define VIRTIO_STATUS__FAILED           ((u8)128)
+
+#define VIRTIO_F__INDIRECT_DESC         ((u64)1 << 28)
+#define VIRTIO_F__RING_EVENT_IDX        ((u64)1 << 29)
+#define VIRTIO_F__VERSION_1             ((u64)1 << 32)
+
+/* MSI-X vector value meaning "no vector assigned" */
+#define VIRTIO_MSI__NO_VECTOR           ((u16)0xFFFF)
+
+/* Vendor capability types locating each configuration structure */
+#define VIRTIO_PCI_CAP__COMMON_CFG      ((u8)1)
+#define VIRTIO_PCI_CAP__NOTIFY_CFG      ((u8)2)
+#define VIRTIO_PCI_CAP__ISR_CFG         ((u8)3)
+#define VIRTIO_PCI_CAP__DEVICE_CFG      ((u8)4)
+#define VIRTIO_PCI_CAP__PCI_CFG         ((u8)5)
+
+struct virtio_pci_common_cfg
+{
+    u32 device_feature_select;
+    u32 device_feature;
+    u32 driver_feature_select;
+    u32 driver_feature;
+    u16 config_msix_vector;
+    u16 num_queues;
+    u8 device_status;
+    u8 config_generation;
+    u16 queue_select;
+    u16 queue_size;
+    u16 queue_msix_vector;
+    u16 queue_enable;
+    u16 queue_notify_off;
+    u64 queue_desc;
+    u64 queue_driver;
+    u64 queue_device;
+} __attribute__ ((__packed__));
+
+struct virtio_device
+{
+    struct pci_device *pci;
+    volatile struct virtio_pci_common_cfg *common;
+    volatile u8 *notify_base;
+    u32 notify_off_multiplier;
+    volatile u8 *isr;
+    volatile u8 *device_cfg;
+    u64 features;
+};
+
+/* Locates the configuration structures and resets the device */
+int virtio_pci_init(struct virtio_device *vdev, struct pci_device *pci);
+
+/* Offers 'wanted' & device features; VERSION_1 is required. Returns -1 if FEATURES_OK is refused */
+int virtio_negotiate(struct virtio_device *vdev, u64 wanted);
+
+u16 virtio_queue_count(struct virtio_device *vdev);
+int virtio_setup_queue(struct virtio_device *vdev, struct virtqueue *vq, u16 index, u16 max_size);
+void virtio_driver_ok(struct virtio_device *vdev);
+void virtio_fail(struct virtio_device *vdev);
+
+/* Device-specific configuration reads; 64-bit reads retry until config_generation is stable */
+u8 virtio_config_read8(struct virtio_device *vdev, u32 offset);
+u16 virtio_config_read16(struct virtio_device *vdev, u32 offset);
+u32 virtio_config_read32(struct virtio_device *vdev, u32 offset);
+u64 virtio_config_read64(struct virtio_device *vdev, u32 offset);
+
+static inline bool virtio_has_feature(const struct virtio_device *vdev, u64 feature)
+{
+    return (vdev->features & feature) != 0;
+}
+
+#endif /* __INCLUDE__DRIVERS__VIRTIO__VIRTIO_H__ */
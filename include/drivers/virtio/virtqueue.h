@@ -0,0 +1,89 @@
+#ifndef __INCLUDE__DRIVERS__VIRTIO__VIRTQUEUE_H__
+#define __INCLUDE__DRIVERS__VIRTIO__VIRTQUEUE_H__
+
+#include <types.h>
+#include <lib/spinlock.h>
+
+/* Split virtqueue layout (virtio 1.x, section 2.7); natural alignment matches the spec */
+
+#define VIRTQ_MAX_SIZE              256
+
+#define VIRTQ_DESC_F__NEXT          ((u16)1)
+#define VIRTQ_DESC_F__WRITE         ((u16)2)
+
+#define VIRTQ_AVAIL_F__NO_INTERRUPT ((u16)1)
+#define VIRTQ_USED_F__NO_NOTIFY     ((u16)1)
+
+struct virtq_desc
+{
+    u64 addr;
+    u32 len;
+    u16 flags;
+    u16 next;
+};
+
+struct virtq_avail
+{
+    u16 flags;
+    u16 idx;
+    u16 ring[];     /* followed by u16 used_event with VIRTIO_F_RING_EVENT_IDX */
+};
+
+struct virtq_used_elem
+{
+    u32 id;
+    u32 len;
+};
+
+struct virtq_used
+{
+    u16 flags;
+    u16 idx;
+    struct virtq_used_elem ring[];  /* followed by u16 avail_event with VIRTIO_F_RING_EVENT_IDX */
+};
+
+/* One buffer of a chain: 'device_writable' buffers come after all driver-written ones */
+struct virtq_buf
+{
+    void *addr;
+    u32 len;
+    bool device_writable;
+};
+
+struct virtqueue
+{
+    u16 index;
+    u16 size;
+    bool event_idx;
+    volatile struct virtq_desc *desc;
+    volatile struct virtq_avail *avail;
+    volatile struct virtq_used *used;
+    volatile u16 *notify;
+    void **cookies;
+    u16 free_head;
+    u16 num_free;
+    u16 avail_idx;          /* driver-side shadow of avail->idx */
+    u16 published_idx;      /* avail->idx as of the last kick */
+    u16 last_used_idx;
+    spinlock_t lock;
+    u64 kicks;
+    u64 kicks_suppressed;
+};
+
+int virtqueue_init(struct virtqueue *vq, u16 index, u16 size, bool event_idx);
+
+/* Queues a chain without notifying the device; returns -1 when the ring is full */
+int virtqueue_add(struct virtqueue *vq, const struct virtq_buf *bufs, u16 count, void *cookie);
+
+/* Publishes queued chains and tells whether the device asked to be notified */
+bool virtqueue_kick_prepare(struct virtqueue *vq);
+void virtqueue_notify(struct virtqueue *vq);
+
+/* Returns the cookie of the next completed chain, or NULL */
+void *virtqueue_get_buf(struct virtqueue *vq, u32 *len);
+bool virtqueue_has_used(const struct virtqueue *vq);
+
+void virtqueue_disable_cb(struct virtqueue *vq);
+bool virtqueue_enable_cb(struct virtqueue *vq);
+
+#endif /* __INCLUDE__DRIVERS__VIRTIO__VIRTQUEUE_H__ */
@@ -0,0 +1,32 @@
+#ifndef __INCLUDE__IRQ__IRQ_H__
+#define __INCLUDE__IRQ__IRQ_H__
+
+#include <types.h>
+#include <arch/interrupt.h>
+
+/* Legacy PIC lines 0-15 are delivered on vectors IRQ_VECTOR_BASE.. */
+#define IRQ_VECTOR_BASE     0x20
+
+typedef void (*irq_handler_t)(struct interrupt_frame *frame);
+
+/*
+ * Installs the IDT, remaps and masks the legacy PICs and enables
+ * interrupts. Exceptions without a handler print the faulting state,
+ * dump the trace buffers and halt.
+ */
+int irq_init(void);
+
+/* One handler per vector; NULL removes it. PIC lines are acknowledged by the dispatcher */
+int irq_register(u32 vector, irq_handler_t handler);
+
+/*
+ * What happens to exceptions without a handler: ends the process that
+ * raised it in user mode, otherwise the fatal path above. For handlers
+ * that only deal with some cases of their exception.
+ */
+void irq_exception(struct interrupt_frame *frame);
+
+/* Common C entry point of every vector, called from the entry stubs */
+void interrupt_dispatch(struct interrupt_frame *frame);
+
+#endif /* __INCLUDE__IRQ__IRQ_H__ */
@@ -0,0 +1,29 @@
+#ifndef __INCLUDE__IRQ__LAPIC_H__
+#define __INCLUDE__IRQ__LAPIC_H__
+
+#include <types.h>
+
+/* The spurious vector is never acknowledged; the dispatcher ignores it as a stray vector */
+#define LAPIC_VECTOR_SPURIOUS   0xFF
+
+/*
+ * Local APIC in xAPIC (MMIO) mode, used only for inter-processor
+ * interrupts: device interrupts still come through the legacy PICs to
+ * the boot CPU. lapic_init() maps the registers the MADT (or the APIC
+ * base MSR) points to and enables the boot CPU's APIC; every other CPU
+ * calls lapic_enable() once it runs.
+ */
+int lapic_init(void);
+void lapic_enable(void);
+
+u32 lapic_id(void);
+void lapic_eoi(void);
+
+/* Fixed interrupt on 'vector' to the CPU with 'apic_id'; -1 if the APIC never accepted it */
+int lapic_send_ipi(u32 apic_id, u8 vector);
+
+/* The INIT and STARTUP messages that start an application processor at 'page' << 12 in real mode */
+int lapic_send_init(u32 apic_id);
+int lapic_send_startup(u32 apic_id, u8 page);
+
+#endif /* __INCLUDE__IRQ__LAPIC_H__ */
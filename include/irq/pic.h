@@ -0,0 +1,18 @@
+#ifndef __INCLUDE__IRQ__PIC_H__
+#define __INCLUDE__IRQ__PIC_H__
+
+#include <types.h>
+
+#define PIC_LINES   16
+
+/* Remaps the two legacy 8259 PICs to 'vector_base'..'vector_base'+15 with every line masked */
+void pic_init(u8 vector_base);
+
+void pic_mask(u8 line);
+void pic_unmask(u8 line);
+void pic_eoi(u8 line);
+
+/* True for a spurious IRQ 7/15 (in-service bit clear), which must not be acknowledged */
+bool pic_spurious(u8 line);
+
+#endif /* __INCLUDE__IRQ__PIC_H__ */
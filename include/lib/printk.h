@@ -0,0 +1,15 @@
+#ifndef __INCLUDE__LIB__PRINTK_H__
+#define __INCLUDE__LIB__PRINTK_H__
+
+#include <types.h>
+#include <lib/stdarg.h>
+
+/*
+ * Supported conversions: %d %i %u %x %X %p %s %c %%, with an optional
+ * '0' flag, field width and 'l' / 'll' / 'z' length modifiers.
+ */
+int vsnprintk(char *buf, size_t size, const char *fmt, va_list args);
+int snprintk(char *buf, size_t size, const char *fmt, ...) __attribute__ ((format (printf, 3, 4)));
+int printk(const char *fmt, ...) __attribute__ ((format (printf, 1, 2)));
+
+#endif /* __INCLUDE__LIB__PRINTK_H__ */
@@ -0,0 +1,49 @@
+#ifndef __INCLUDE__LIB__SPINLOCK_H__
+#define __INCLUDE__LIB__SPINLOCK_H__
+
+#include <types.h>
+#include <arch/cpu.h>
+#include <trace/trace.h>
+
+typedef struct
+{
+    volatile u32 locked;
+} spinlock_t;
+
+#define SPINLOCK_INIT { 0 }
+
+static inline void spin_lock_init(spinlock_t *lock)
+{
+    lock->locked = 0;
+}
+
+static inline bool spin_trylock(spinlock_t *lock)
+{
+    return __atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE) == 0;
+}
+
+/* Test-and-test-and-set: spin on a plain read so waiters don't bounce the line */
+static inline void spin_lock(spinlock_t *lock)
+{
+    u64 waited;
+
+    if (spin_trylock(lock))
+        return;
+
+    waited = rdtsc();
+    do
+    {
+        while (__atomic_load_n(&lock->locked, __ATOMIC_RELAXED))
+            cpu_relax();
+    } while (!spin_trylock(lock));
+    waited = rdtsc() - waited;
+
+    trace_point(TRACE_EVENT__LOCK_CONTENDED, waited > U32_MAX ? U32_MAX : waited, (uintptr_t)lock);
+}
+
+static inline void spin_unlock(spinlock_t *lock)
+{
+    __atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+#endif /* __INCLUDE__LIB__SPINLOCK_H__ */
@@ -0,0 +1,13 @@
+#ifndef __INCLUDE__LIB__STRING_H__
+#define __INCLUDE__LIB__STRING_H__
+
+#include <types.h>
+
+void *memset(void *dest, int value, size_t count);
+void *memcpy(void *dest, const void *src, size_t count);
+void *memmove(void *dest, const void *src, size_t count);
+int memcmp(const void *lhs, const void *rhs, size_t count);
+size_t strlen(const char *str);
+int strncmp(const char *lhs, const char *rhs, size_t count);
+
+#endif /* __INCLUDE__LIB__STRING_H__ */
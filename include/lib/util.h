@@ -0,0 +1,30 @@
+#ifndef __INCLUDE__LIB__UTIL_H__
+#define __INCLUDE__LIB__UTIL_H__
+
+#include <types.h>
+
+#define ARRAY_SIZE(array)           (sizeof(array) / sizeof((array)[0]))
+#define ALIGN_UP(value, align)      (((value) + (align) - 1) & ~((__typeof__(value))(align) - 1))
+#define ALIGN_DOWN(value, align)    ((value) & ~((__typeof__(value))(align) - 1))
+#define MIN(a, b)                   ((a) < (b) ? (a) : (b))
+#define MAX(a, b)                   ((a) > (b) ? (a) : (b))
+
+#define container_of(ptr, type, member) ((type *)((u8 *)(ptr) - offsetof(type, member)))
+
+#define likely(x)   __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+
+/*
+ * 64-bit division helpers. The kernel is linked without libgcc, so plain
+ * u64 '/' and '%' must not appear in code that is also built for i386.
+ */
+u64 div_u64_rem(u64 dividend, u32 divisor, u32 *remainder);
+
+static inline u64 div_u64(u64 dividend, u32 divisor)
+{
+    u32 remainder;
+
+    return div_u64_rem(dividend, divisor, &remainder);
+}
+
+#endif /* __INCLUDE__LIB__UTIL_H__ */
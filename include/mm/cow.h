@@ -0,0 +1,23 @@
+#ifndef __INCLUDE__MM__COW_H__
+#define __INCLUDE__MM__COW_H__
+
+#include <types.h>
+
+/*
+ * Share counts of frames mapped copy-on-write into more than one place.
+ * A frame with no entry has a single owner; entries exist only while a
+ * frame is shared, so the table stays small however much memory is
+ * mapped. The page tables carry MMU_USER__COW on every such mapping.
+ */
+#define COW_SLOTS   4096    /* power of two; shared frames at any one time, with slack for probing */
+
+/* One more mapping of 'frame'; -1 when the table is full */
+int cow_share(uintptr_t frame);
+
+/* One mapping of 'frame' less; true when it was the last one and the caller must free the frame */
+bool cow_release(uintptr_t frame);
+
+/* Number of mappings of 'frame', 1 when it is not shared */
+u32 cow_count(uintptr_t frame);
+
+#endif /* __INCLUDE__MM__COW_H__ */
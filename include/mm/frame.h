@@ -0,0 +1,91 @@
+#ifndef __INCLUDE__MM__FRAME_H__
+#define __INCLUDE__MM__FRAME_H__
+
+#include <types.h>
+#include <boot/bootloader.h>
+#include <lib/spinlock.h>
+
+#define FRAME_MAX_NODES 8
+
+/* Real-mode memory, BIOS areas and the SMP trampoline: never handed out */
+#define FRAME_LOW_MEMORY_END 0x100000UL
+
+/*
+ * Physical frame allocator.
+ *
+ * A frame pool tracks the frames in [start_pfn, end_pfn) with one bit per
+ * frame (set while the frame is in use). Allocation is next-fit from a
+ * rotating hint and skips fully used words, so the common single-frame
+ * case rarely touches more than one cache line of the bitmap.
+ */
+
+struct frame_pool
+{
+    uintptr_t start_pfn;
+    uintptr_t end_pfn;
+    u32 *bitmap;
+    size_t free_frames;
+    uintptr_t next_pfn;
+    spinlock_t lock;
+};
+
+size_t frame_pool_bitmap_size(uintptr_t start_pfn, uintptr_t end_pfn);
+void frame_pool_init(struct frame_pool *pool, uintptr_t start_pfn, uintptr_t end_pfn, u32 *bitmap);
+size_t frame_pool_release(struct frame_pool *pool, uintptr_t start_pfn, uintptr_t end_pfn);
+void frame_pool_reserve(struct frame_pool *pool, uintptr_t start_pfn, uintptr_t end_pfn);
+uintptr_t frame_pool_alloc(struct frame_pool *pool, size_t count);
+void frame_pool_free(struct frame_pool *pool, uintptr_t pfn, size_t count);
+
+/*
+ * Builds the kernel's frame pool from the Multiboot2 memory map. Only the
+ * 128MB chunks holding the kernel, the boot information or the pool's
+ * bitmap are filled in at once; the others stay pending, all used, until
+ * frame_init_parallel() has every online CPU initialise a few. What is
+ * left after that is done by idle CPUs, one chunk per frame_init_deferred()
+ * call, or by an allocation that would otherwise fail. On x86_64 memory
+ * above the boot mapping is mapped here.
+ */
+int frame_init(const struct boot_info *info);
+void frame_init_parallel(void);
+bool frame_init_deferred(void);
+
+/* Splits it into one pool per ACPI (SRAT) node; a no-op on non-NUMA machines */
+int frame_numa_init(const struct boot_info *info);
+
+/*
+ * Physical addresses of page-aligned frames; 0 means out of memory.
+ * Frames come from the calling CPU's node, then from the other nodes in
+ * SLIT distance order.
+ */
+uintptr_t frame_alloc(void);
+uintptr_t frame_alloc_contig(size_t count);
+uintptr_t frame_alloc_node(u32 node, size_t count);
+void frame_free(uintptr_t addr);
+void frame_free_contig(uintptr_t addr, size_t count);
+
+/*
+ * Hands the whole frames inside [start, end) to the allocator, ignoring
+ * anything outside managed memory; returns how many were not free yet.
+ */
+size_t frame_release(uintptr_t start, uintptr_t end);
+
+/* End of the memory the allocator manages and has mapped, as an address */
+uintptr_t frame_managed_end(void);
+
+/* Includes the frames of pending chunks */
+size_t frame_free_count(void);
+
+struct frame_node_stats
+{
+    size_t total_frames;
+    size_t free_frames;
+    size_t local_allocs;    /* requests from this node served by it */
+    size_t remote_allocs;   /* requests from this node that fell back to another */
+};
+
+u32 frame_node_count(void);
+u32 frame_node_of(uintptr_t addr);
+u32 frame_current_node(void);
+int frame_node_stats(u32 node, struct frame_node_stats *stats);
+
+#endif /* __INCLUDE__MM__FRAME_H__ */
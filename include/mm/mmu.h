@@ -0,0 +1,59 @@
+#ifndef __INCLUDE__MM__MMU_H__
+#define __INCLUDE__MM__MMU_H__
+
+#include <types.h>
+
+/* The kernel runs identity-mapped, so DMA addresses are plain physical addresses */
+static inline uintptr_t virt_to_phys(const void *addr)
+{
+    return (uintptr_t)addr;
+}
+
+static inline void *phys_to_virt(uintptr_t phys)
+{
+    return (void *)phys;
+}
+
+/*
+ * Makes [phys, phys + size) accessible as uncached device memory at the
+ * same address and returns it, or NULL when the range cannot be mapped.
+ */
+void *mmu_map_io(u64 phys, size_t size);
+
+/* Same, but cached: for firmware tables and other RAM outside the boot mapping */
+void *mmu_map(u64 phys, size_t size);
+
+/*
+ * Process address spaces: a copy of the kernel's top-level table whose
+ * [USER_BASE, USER_END) window holds 4KB user pages. Kernel mappings are
+ * shared at creation time, so ones added later that need a new top-level
+ * entry (or, on i386, any change) are not seen by existing spaces.
+ */
+#define MMU_USER__WRITABLE  ((u32)1 << 0)
+#define MMU_USER__OWNED     ((u32)1 << 1)   /* frame is freed with the address space */
+#define MMU_USER__COW       ((u32)1 << 2)   /* read-only while shared, see include/mm/cow.h */
+
+struct mmu_space
+{
+    uintptr_t root;     /* physical address of the top-level table */
+};
+
+/* Takes over the boot page tables (and turns paging on for i386); -1 without the needed CPU support */
+int mmu_init(void);
+
+int mmu_space_create(struct mmu_space *space);
+void mmu_space_destroy(struct mmu_space *space);
+
+/* Loads 'space' on this CPU, or the kernel-only tables when NULL */
+void mmu_space_switch(const struct mmu_space *space);
+
+/* Maps the page at 'virt' in the user window to the frame at 'phys' with MMU_USER__ flags */
+int mmu_map_user(struct mmu_space *space, uintptr_t virt, uintptr_t phys, u32 flags);
+
+/* Removes the mapping at 'virt' and returns its frame and flags, or 0 when nothing was mapped */
+uintptr_t mmu_unmap_user(struct mmu_space *space, uintptr_t virt, u32 *flags);
+
+/* Frame behind the user page at 'virt' and its MMU_USER__ flags, or 0 when nothing is mapped */
+uintptr_t mmu_translate_user(const struct mmu_space *space, uintptr_t virt, u32 *flags);
+
+#endif /* __INCLUDE__MM__MMU_H__ */
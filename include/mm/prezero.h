@@ -0,0 +1,22 @@
+#ifndef __INCLUDE__MM__PREZERO_H__
+#define __INCLUDE__MM__PREZERO_H__
+
+#include <types.h>
+
+/*
+ * Pre-zeroed frames. Each node keeps a small stack of frames that idle
+ * CPUs have already cleared, with non-temporal stores where the CPU has
+ * them so the zeroing does not push the cache out. Taking one is a pop;
+ * when the stack runs low the idle CPUs are woken to refill it, and when
+ * it is empty the frame is cleared on the spot.
+ */
+#define PREZERO_FRAMES      256     /* per node */
+#define PREZERO_LOW         64      /* below this the idle CPUs are woken */
+
+/* Registers the refill as idle work; allocations work before it, just without the stack */
+int prezero_init(void);
+
+/* Physical address of a zeroed frame from the caller's node, 0 when out of memory */
+uintptr_t prezero_alloc(void);
+
+#endif /* __INCLUDE__MM__PREZERO_H__ */
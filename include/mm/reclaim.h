@@ -0,0 +1,15 @@
+#ifndef __INCLUDE__MM__RECLAIM_H__
+#define __INCLUDE__MM__RECLAIM_H__
+
+#include <types.h>
+#include <boot/bootloader.h>
+
+/*
+ * Late-init pass returning boot-only memory to the frame allocator: EFI
+ * boot-services and loader regions, the Multiboot2 information, boot
+ * modules and the kernel's __init sections. Must run after the last use
+ * of any of them; clears the boot_info fields that pointed there.
+ */
+void reclaim_boot_memory(struct boot_info *info);
+
+#endif /* __INCLUDE__MM__RECLAIM_H__ */
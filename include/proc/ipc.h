@@ -0,0 +1,65 @@
+#ifndef __INCLUDE__PROC__IPC_H__
+#define __INCLUDE__PROC__IPC_H__
+
+#include <types.h>
+
+/*
+ * Synchronous message passing between processes through ports.
+ *
+ * A port has one owner, which receives calls on it and replies to them
+ * one at a time. A message is three words, carried in registers by the
+ * system calls (include/proc/syscall.h). When the owner is already
+ * waiting, a call switches straight to it and its reply straight back,
+ * without going through the run queue.
+ *
+ * Larger data goes through the port's receive window, a range of the
+ * owner's address space set aside for it: a tag with IPC_TAG__MAP or
+ * IPC_TAG__COPY makes w0/w1 the address and length of a buffer in the
+ * caller, which is mapped copy-on-write or copied into the window, and
+ * the owner receives w0 rewritten to where it landed. Mapped pages stay
+ * shared read-only on both sides until one of them writes. Replies carry
+ * registers only.
+ *
+ * Ports are created by the kernel and handed to processes as arguments.
+ * Like the processes that use them, they stay on one CPU.
+ */
+#define IPC_PORTS           32
+
+#define IPC_TAG_LABEL(tag)  ((tag) & 0xFFFF)            /* free for the protocol */
+#define IPC_TAG__MAP        ((uintptr_t)1 << 16)
+#define IPC_TAG__COPY       ((uintptr_t)1 << 17)
+
+struct ipc_message
+{
+    uintptr_t tag;
+    uintptr_t w0;
+    uintptr_t w1;
+};
+
+struct process;
+
+/* Port ids are small integers; -1 when all IPC_PORTS are in use */
+int ipc_port_create(void);
+int ipc_port_bind(u32 port, struct process *owner);
+
+/* Fails every call still waiting on the port and frees it */
+void ipc_port_destroy(u32 port);
+
+/*
+ * Operations of the running process, 0 or -1. ipc_call() blocks until the
+ * owner replies and leaves the reply in 'message'. ipc_receive() blocks
+ * until a call arrives. ipc_reply_wait() answers the call received last
+ * and waits for the next one in a single step.
+ */
+int ipc_call(u32 port, struct ipc_message *message);
+int ipc_receive(u32 port, struct ipc_message *message);
+int ipc_reply(u32 port, const struct ipc_message *message);
+int ipc_reply_wait(u32 port, struct ipc_message *message);
+
+/* Sets the owner's receive window to [addr, addr + length), where nothing may be mapped yet */
+int ipc_set_window(u32 port, uintptr_t addr, size_t length);
+
+/* Detaches an exiting or destroyed process from every port; calls waiting on ports it owns fail */
+void ipc_process_gone(struct process *process);
+
+#endif /* __INCLUDE__PROC__IPC_H__ */
@@ -0,0 +1,105 @@
+#ifndef __INCLUDE__PROC__PROCESS_H__
+#define __INCLUDE__PROC__PROCESS_H__
+
+#include <types.h>
+#include <arch/arch.h>
+#include <mm/mmu.h>
+
+#define PROCESS_MAX                 16
+#define PROCESS_KERNEL_STACK_FRAMES 4       /* 16KiB */
+
+/*
+ * Layout of the user window, the same in every process. USER_IMAGE_BASE
+ * is where user programs are linked (the Makefile passes the same value
+ * to user/user.ld) and where they start executing. The last page is never
+ * mapped: on x86_64 no SYSCALL can then sit at the end of the canonical
+ * lower half, where SYSRET would fault in ring 0 on its return address.
+ */
+#define USER_TIME_PAGE              USER_BASE                       /* struct vdso_time, read-only */
+#define USER_IMAGE_BASE             (USER_BASE + 0x10000)
+#define USER_STACK_PAGES            4
+#define USER_STACK_TOP              (USER_END - PAGE_SIZE)
+
+/* The user programs (user/), linked at USER_IMAGE_BASE and embedded by user/image.s */
+extern const u8 user_image_start[];
+extern const u8 user_image_end[];
+
+enum process_state
+{
+    PROCESS_STATE__FREE,
+    PROCESS_STATE__NEW,         /* created, not started */
+    PROCESS_STATE__READY,       /* on its CPU's run queue */
+    PROCESS_STATE__RUNNING,
+    PROCESS_STATE__BLOCKED,     /* waiting in IPC until someone wakes or switches to it */
+    PROCESS_STATE__EXITED,
+};
+
+struct ipc_message;
+
+struct process
+{
+    u32 pid;
+    enum process_state state;
+    struct mmu_space space;
+    uintptr_t kernel_stack;     /* lowest address of PROCESS_KERNEL_STACK_FRAMES frames */
+    uintptr_t kernel_sp;        /* saved by context_switch() while not running */
+    int exit_status;
+    struct process *next;       /* run queue or IPC wait queue link */
+
+    /* While blocked in IPC: where the peer writes the message, and the result of the operation */
+    struct ipc_message *ipc_message;
+    int ipc_status;
+};
+
+/*
+ * Creates a process running the flat user image 'image' (loaded at
+ * USER_IMAGE_BASE, writable) with the shared time page mapped. Its entry
+ * point receives 'arg0' and 'arg1' in RDI/RSI on x86_64, EAX/EDX on i386.
+ */
+struct process *process_create(const void *image, size_t size, uintptr_t arg0, uintptr_t arg1);
+
+/*
+ * Processes run on the CPU that starts them, without preemption: one
+ * runs until it exits or blocks, and then the next on that CPU's run
+ * queue takes over. process_start() queues a new process; process_run()
+ * queues one and runs the queue until that one exits, returning its exit
+ * status, or -1 when everything left is blocked first.
+ */
+void process_start(struct process *process);
+int process_run(struct process *process);
+
+/* Registers the page-fault handler that resolves copy-on-write faults */
+void process_init(void);
+
+/* Frees a process that is not running and everything mapped in it */
+void process_destroy(struct process *process);
+
+/* From system-call or exception context: ends the running process and runs the next one */
+void process_exit(int status) __attribute__ ((noreturn));
+
+/* The process whose address space this CPU has loaded, NULL in kernel-only context */
+struct process *process_current(void);
+
+/*
+ * Blocks the running process and switches straight to 'next', which must
+ * be blocked waiting for this hand-off, or to the next runnable process
+ * when NULL. Returns once the process is switched back to.
+ */
+void process_block(struct process *next);
+
+/* Queues a blocked process to run again */
+void process_wake(struct process *process);
+
+/*
+ * Whether the running process may read (or write) all of [addr, addr + length).
+ * Checking for write gives it private copies of copy-on-write pages in the range.
+ */
+bool process_access_ok(uintptr_t addr, size_t length, bool write);
+
+/* Maps zeroed writable pages over [addr, addr + length) in the running process, where nothing is mapped yet */
+int process_map_anonymous(uintptr_t addr, size_t length);
+
+/* Replaces the copy-on-write page at 'virt' with a writable one private to 'process' */
+int process_cow_break(struct process *process, uintptr_t virt);
+
+#endif /* __INCLUDE__PROC__PROCESS_H__ */
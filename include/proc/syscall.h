@@ -0,0 +1,31 @@
+#ifndef __INCLUDE__PROC__SYSCALL_H__
+#define __INCLUDE__PROC__SYSCALL_H__
+
+#include <types.h>
+
+/*
+ * System call numbers, shared with user programs (user/). Register usage
+ * is described with struct syscall_frame in include/arch/syscall.h. IPC
+ * messages (struct ipc_message) travel in arguments 1-3, tag first, in
+ * both directions.
+ */
+#define SYS_EXIT            0   /* (int status), does not return */
+#define SYS_NOP             1   /* (), returns 0: the bare round trip */
+#define SYS_CLOCK_NS        2   /* (u64 *ns), the time page clock read in the kernel */
+#define SYS_WRITE           3   /* (const char *buffer, size_t length), to the console */
+#define SYS_MAP             4   /* (void *addr, size_t length), zeroed pages where nothing is mapped */
+#define SYS_IPC_CALL        5   /* (port, message), returns with the reply in the message */
+#define SYS_IPC_RECEIVE     6   /* (port), returns with the call in the message */
+#define SYS_IPC_REPLY       7   /* (port, message) */
+#define SYS_IPC_REPLY_WAIT  8   /* (port, message), returns with the next call */
+#define SYS_IPC_WINDOW      9   /* (port, void *addr, size_t length), see include/proc/ipc.h */
+#define SYSCALLS            10
+
+#define SYSCALL_ERROR       ((uintptr_t)-1)
+
+struct syscall_frame;
+
+/* Called by the entry code with interrupts enabled; stores the result in frame->value */
+void syscall_dispatch(struct syscall_frame *frame);
+
+#endif /* __INCLUDE__PROC__SYSCALL_H__ */
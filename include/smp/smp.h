@@ -0,0 +1,47 @@
+#ifndef __INCLUDE__SMP__SMP_H__
+#define __INCLUDE__SMP__SMP_H__
+
+#include <types.h>
+#include <boot/bootloader.h>
+
+/* IPI that only ends a sleeping CPU's HLT */
+#define SMP_VECTOR_WAKE     0xF0
+
+/*
+ * Application processors. smp_init() starts every CPU of the ACPI
+ * topology that the local APIC can address, one at a time, through the
+ * real-mode trampoline (src/arch/ARCH/trampoline.s), each from a page of
+ * its own. A CPU that starts after its time is up halts. They take no device
+ * interrupts and run no processes: each sits in smp_idle(), running work
+ * the boot CPU posts with smp_run() and, when there is none, the
+ * registered idle work until that has nothing left to do either, then
+ * halts until smp_wake_idle().
+ */
+int smp_init(const struct boot_info *info);
+
+u32 smp_cpus_online(void);
+
+/* Runs work(data) on every online CPU, the caller included, and returns once all have finished; boot CPU only */
+void smp_run(void (*work)(void *data), void *data);
+
+/* Idle work returns true when it did something, so the CPU calls it again before halting; boot only */
+int smp_idle_register(bool (*work)(void));
+
+/*
+ * Parks every other online CPU in smp_idle() with interrupts off, for code
+ * that must not run anywhere else meanwhile (patching trace sites). Fails
+ * when another CPU already holds the pause or one does not park in time,
+ * for instance the boot CPU before it reaches smp_idle().
+ */
+int smp_pause(void);
+
+/* Lets the CPUs parked by a successful smp_pause() go; they serialise before running on */
+void smp_resume(void);
+
+/* Gets the halted CPUs to look at their idle work again, for work that just appeared */
+void smp_wake_idle(void);
+
+/* The idle loop: every application processor ends here, and so does the boot CPU once initialised */
+void smp_idle(void) __attribute__ ((noreturn));
+
+#endif /* __INCLUDE__SMP__SMP_H__ */
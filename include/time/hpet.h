@@ -0,0 +1,18 @@
+#ifndef __INCLUDE__TIME__HPET_H__
+#define __INCLUDE__TIME__HPET_H__
+
+#include <types.h>
+
+/* Enables the main counter of the HPET described by the ACPI HPET table */
+int hpet_init(void);
+
+bool hpet_available(void);
+u32 hpet_period_fs(void);
+
+u64 hpet_read(void);
+/* Ticks from 'start' to 'end', correct across one wrap of a 32-bit counter */
+u64 hpet_delta(u64 start, u64 end);
+u64 hpet_ticks_to_ns(u64 ticks);
+u64 hpet_ns(void);
+
+#endif /* __INCLUDE__TIME__HPET_H__ */
@@ -0,0 +1,19 @@
+#ifndef __INCLUDE__TIME__PIT_H__
+#define __INCLUDE__TIME__PIT_H__
+
+#include <types.h>
+
+/* The legacy 8254 programmable interval timer: channel 0 drives PIC line 0, channel 2 the speaker gate */
+#define PIT_FREQUENCY           1193182U
+#define PIT_PORT_CHANNEL0       0x40
+#define PIT_PORT_CHANNEL2       0x42
+#define PIT_PORT_COMMAND        0x43
+#define PIT_PORT_GATE           0x61
+
+#define PIT_GATE__ENABLE        0x01
+#define PIT_GATE__SPEAKER       0x02
+#define PIT_GATE__OUTPUT        0x20
+
+#define PIT_IRQ_LINE            0
+
+#endif /* __INCLUDE__TIME__PIT_H__ */
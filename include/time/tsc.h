@@ -0,0 +1,31 @@
+#ifndef __INCLUDE__TIME__TSC_H__
+#define __INCLUDE__TIME__TSC_H__
+
+#include <types.h>
+
+/* Calibrates the time-stamp counter against the HPET, or PIT channel 2 without one */
+int tsc_init(void);
+
+u32 tsc_khz(void);
+u64 tsc_cycles_to_ns(u64 cycles);
+
+/* ns = cycles * mult >> TSC_SHIFT */
+#define TSC_SHIFT 32
+
+/*
+ * The 96-bit product taken as three 64-bit ones. With a 32-bit shift the
+ * low half of mult only meets the low half of cycles, so no partial
+ * product overflows whatever the TSC frequency. User programs reach it
+ * through time/vdso.h.
+ */
+static inline u64 tsc_scale(u64 cycles, u64 mult)
+{
+    u64 low = cycles & 0xFFFFFFFFU;
+
+    return (cycles >> 32) * mult + low * (mult >> 32) + ((low * (mult & 0xFFFFFFFFU)) >> 32);
+}
+
+/* The mult for tsc_scale() */
+void tsc_conversion(u64 *mult);
+
+#endif /* __INCLUDE__TIME__TSC_H__ */
@@ -0,0 +1,52 @@
+#ifndef __INCLUDE__TIME__VDSO_H__
+#define __INCLUDE__TIME__VDSO_H__
+
+#include <types.h>
+#include <arch/cpu.h>
+#include <time/tsc.h>
+
+/*
+ * Shared time page, mapped read-only at USER_TIME_PAGE in every process
+ * so user code reads the clock with RDTSC and no kernel transition. It
+ * counts nanoseconds since vdso_init(). 'sequence' is odd while the
+ * kernel rewrites the page; readers retry until they saw the same even
+ * value before and after.
+ */
+struct vdso_time
+{
+    volatile u32 sequence;
+    u32 tsc_khz;
+    u64 mult;
+    u64 base_tsc;
+    u64 base_ns;
+};
+
+/* Shared by the kernel and user programs (user/), which include this header */
+static inline u64 vdso_time_ns(const volatile struct vdso_time *time)
+{
+    u64 cycles;
+    u64 ns;
+    u32 sequence;
+
+    do
+    {
+        sequence = time->sequence;
+        barrier();
+        cycles = rdtsc() - time->base_tsc;
+        ns = time->base_ns + tsc_scale(cycles, time->mult);
+        barrier();
+    } while ((sequence & 1) || sequence != time->sequence);
+
+    return ns;
+}
+
+/* Fills the page from the calibrated TSC; call after tsc_init() */
+int vdso_init(void);
+
+/* Physical address of the page, 0 before vdso_init() */
+uintptr_t vdso_time_page(void);
+
+/* The clock user programs read, from kernel context */
+u64 vdso_clock_ns(void);
+
+#endif /* __INCLUDE__TIME__VDSO_H__ */
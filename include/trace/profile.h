@@ -0,0 +1,27 @@
+#ifndef __INCLUDE__TRACE__PROFILE_H__
+#define __INCLUDE__TRACE__PROFILE_H__
+
+#include <types.h>
+
+/*
+ * Sampling profiler for the link-time text layout. With the "profile"
+ * boot option, PIT channel 0 interrupts PROFILE_HZ times a second and the
+ * interrupted kernel instruction pointer is counted in a hash table.
+ * Code running with interrupts disabled is never sampled.
+ *
+ * profile_dump() writes one "prof <ip> <samples>" line per address to
+ * COM1. tools/hotlist resolves the addresses against the kernel's symbol
+ * table and prints the functions that cover most samples; the Makefile
+ * places the functions in that list (HOT_FUNCTIONS) together at the start
+ * of .text.
+ */
+#define PROFILE_HZ          4000
+#define PROFILE_SLOTS_SHIFT 13
+#define PROFILE_SLOTS       (1U << PROFILE_SLOTS_SHIFT)
+
+int profile_init(void);
+
+/* Stops sampling and writes the counts out; a no-op unless profiling was enabled */
+void profile_dump(void);
+
+#endif /* __INCLUDE__TRACE__PROFILE_H__ */
@@ -0,0 +1,102 @@
+#ifndef __INCLUDE__TRACE__TRACE_H__
+#define __INCLUDE__TRACE__TRACE_H__
+
+#include <types.h>
+
+/*
+ * Static tracepoints.
+ *
+ * trace_point() assembles to a 5-byte NOP plus a struct trace_site entry
+ * in the .trace_sites section giving the NOP's address and the address of
+ * the recording code the compiler emitted out of line. Enabling an event
+ * patches each of its NOPs into a JMP to that code; a disabled
+ * tracepoint costs one NOP and nothing else.
+ *
+ * Sites in __init code are never patched, since that memory is reclaimed.
+ */
+
+#define TRACE_EVENT__IRQ_ENTRY          0   /* arg0: vector, arg1: interrupted ip */
+#define TRACE_EVENT__IRQ_EXIT           1   /* arg0: vector */
+#define TRACE_EVENT__SCHED_SWITCH       2   /* arg0: previous task, arg1: next task */
+#define TRACE_EVENT__PAGE_ALLOC         3   /* arg0: frames, arg1: physical address */
+#define TRACE_EVENT__PAGE_FREE          4   /* arg0: frames, arg1: physical address */
+#define TRACE_EVENT__BLOCK_SUBMIT       5   /* arg0: sector (low 32 bits), arg1: request */
+#define TRACE_EVENT__BLOCK_COMPLETE     6   /* arg0: status, arg1: request */
+#define TRACE_EVENT__LOCK_CONTENDED     7   /* arg0: TSC cycles spent waiting, arg1: lock */
+#define TRACE_EVENTS                    8
+
+#define TRACE_EVENTS__ALL               (((u32)1 << TRACE_EVENTS) - 1)
+
+/* The dump is a header followed by every CPU's records, oldest first */
+#define TRACE_DUMP_MAGIC                0x4352544BU     /* "KTRC" */
+#define TRACE_DUMP_VERSION              1
+
+struct trace_record
+{
+    u64 timestamp;      /* TSC */
+    u16 event;
+    u16 cpu;
+    u32 arg0;
+    u64 arg1;
+};
+
+struct trace_dump_header
+{
+    u32 magic;
+    u16 version;
+    u16 record_size;
+    u32 tsc_khz;
+    u32 record_count;
+    u32 lost_count;     /* overwritten before the dump */
+};
+
+struct trace_site
+{
+    uintptr_t code;
+    uintptr_t target;
+    uintptr_t event;
+};
+
+#ifdef __x86_64__
+    #define TRACE_ASM_WORD  ".quad"
+    #define TRACE_ASM_ALIGN ".balign 8"
+#else
+    #define TRACE_ASM_WORD  ".long"
+    #define TRACE_ASM_ALIGN ".balign 4"
+#endif
+
+/* 'event' must be a constant; pointers in 'arg1' need an explicit uintptr_t cast */
+#define trace_point(event, arg0, arg1)                                                      \
+    do                                                                                      \
+    {                                                                                       \
+        __label__ trace_enabled;                                                            \
+                                                                                            \
+        __asm__ goto ("1: .byte 0x0F, 0x1F, 0x44, 0x00, 0x00\n\t"                           \
+                      ".pushsection .trace_sites, \"aw\"\n\t"                               \
+                      TRACE_ASM_ALIGN "\n\t"                                                \
+                      TRACE_ASM_WORD " 1b, %l[trace_enabled], %c0\n\t"                      \
+                      ".popsection"                                                         \
+                      : : "i"(event) : : trace_enabled);                                    \
+        break;                                                                              \
+    trace_enabled:                                                                          \
+        trace_emit((event), (u32)(arg0), (u64)(arg1));                                      \
+    } while (0)
+
+/* Allocates a ring on each CPU's node and enables every event with the "trace" boot option */
+int trace_init(void);
+
+/* Patches the sites of each event in the mask in or out, with the other CPUs parked by smp_pause() */
+void trace_set_events(u32 events);
+u32 trace_events(void);
+
+/* Out-of-line body of an enabled trace_point() */
+void trace_emit(u32 event, u32 arg0, u64 arg1);
+
+/*
+ * Writes the rings to COM1, or to the QEMU debugcon port (0xE9) with the
+ * "trace_debugcon" boot option, and empties them. tools/trace2json turns
+ * the dump into Chrome/Perfetto trace JSON.
+ */
+void trace_dump(void);
+
+#endif /* __INCLUDE__TRACE__TRACE_H__ */
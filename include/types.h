@@ -28,6 +28,11 @@
 
 #define NULL ((void *)0)
 
+#define true    1
+#define false   0
+
+#define offsetof(type, member) __builtin_offsetof(type, member)
+
 typedef char    s8;
 typedef short   s16;
 typedef int     s32;
@@ -36,6 +41,8 @@ typedef unsigned char   u8;
 typedef unsigned short  u16;
 typedef unsigned int    u32;
 
+typedef _Bool bool;
+
 typedef float       f32;
 typedef double      f64;
 typedef long double f80;
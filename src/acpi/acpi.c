@@ -0,0 +1,223 @@
+#include <types.h>
+#include <acpi/acpi.h>
+#include <acpi/tables.h>
+#include <boot/init.h>
+#include <lib/printk.h>
+#include <lib/string.h>
+#include <mm/mmu.h>
+
+/* Open-addressed signature index, twice the table capacity so probes stay short */
+#define ACPI_INDEX_SHIFT    7
+#define ACPI_INDEX_SIZE     (1 << ACPI_INDEX_SHIFT)
+#define ACPI_NONE           ((u16)0xFFFF)
+
+struct acpi_table
+{
+    u32 signature;
+    u16 next;       /* next table with the same signature */
+    const struct acpi_sdt_header *header;
+};
+
+static struct acpi_table acpi_tables[ACPI_MAX_TABLES];
+static size_t acpi_tables_count;
+static u16 acpi_index[ACPI_INDEX_SIZE];
+
+static inline u32 acpi_hash(u32 signature)
+{
+    return (signature * 0x9E3779B1U) >> (32 - ACPI_INDEX_SHIFT);
+}
+
+static inline u32 acpi_signature(const char *signature)
+{
+    return ACPI_SIGNATURE(signature[0], signature[1], signature[2], signature[3]);
+}
+
+static bool __init acpi_checksum(const void *data, size_t length)
+{
+    const u8 *bytes = data;
+    u8 sum = 0;
+    size_t index;
+
+    for (index = 0; index < length; index++)
+        sum += bytes[index];
+
+    return sum == 0;
+}
+
+/* Maps a table whose length is only known once its header is readable */
+static const struct acpi_sdt_header *__init acpi_map_table(u64 phys)
+{
+    const struct acpi_sdt_header *header;
+
+    if (phys == 0)
+        return NULL;
+
+    header = mmu_map(phys, sizeof(struct acpi_sdt_header));
+    if (header == NULL || header->length < sizeof(struct acpi_sdt_header))
+        return NULL;
+
+    return mmu_map(phys, header->length);
+}
+
+static void __init acpi_add_table(u64 phys)
+{
+    const struct acpi_sdt_header *header = acpi_map_table(phys);
+    struct acpi_table *table;
+    u32 slot;
+
+    if (header == NULL || acpi_tables_count == ACPI_MAX_TABLES)
+        return;
+
+    if (!acpi_checksum(header, header->length))
+    {
+        printk("acpi: %c%c%c%c at %llx has a bad checksum\n", header->signature[0], header->signature[1],
+               header->signature[2], header->signature[3], (unsigned long long)phys);
+        return;
+    }
+
+    table = &acpi_tables[acpi_tables_count];
+    table->signature = acpi_signature(header->signature);
+    table->header = header;
+    table->next = ACPI_NONE;
+
+    for (slot = acpi_hash(table->signature); acpi_index[slot] != ACPI_NONE; slot = (slot + 1) % ACPI_INDEX_SIZE)
+    {
+        struct acpi_table *first = &acpi_tables[acpi_index[slot]];
+
+        if (first->signature == table->signature)
+        {
+            /* Keep firmware order among same-signature tables */
+            while (first->next != ACPI_NONE)
+                first = &acpi_tables[first->next];
+            first->next = (u16)acpi_tables_count;
+            acpi_tables_count++;
+            return;
+        }
+    }
+
+    acpi_index[slot] = (u16)acpi_tables_count;
+    acpi_tables_count++;
+
+    return;
+}
+
+static const struct acpi_rsdp *__init acpi_check_rsdp(const struct acpi_rsdp *rsdp)
+{
+    if (rsdp == NULL || memcmp(rsdp->signature, "RSD PTR ", 8) != 0)
+        return NULL;
+
+    if (!acpi_checksum(rsdp, offsetof(struct acpi_rsdp, length)))
+        return NULL;
+
+    if (rsdp->revision >= 2 && !acpi_checksum(rsdp, rsdp->length))
+        return NULL;
+
+    return rsdp;
+}
+
+int __init acpi_init(const struct boot_info *boot_info)
+{
+    const struct acpi_rsdp *rsdp = acpi_check_rsdp(boot_info->acpi_rsdp);
+    const struct acpi_sdt_header *root;
+    const struct acpi_sdt_header *fadt;
+    size_t entry_size;
+    size_t entries;
+    size_t index;
+
+    memset(acpi_index, 0xFF, sizeof(acpi_index));
+    acpi_tables_count = 0;
+
+    if (rsdp == NULL)
+    {
+        printk("acpi: no valid RSDP\n");
+        return -1;
+    }
+
+    /* The XSDT carries 64-bit pointers and wins over the RSDT when present */
+    if (rsdp->revision >= 2 && rsdp->xsdt_address != 0)
+    {
+        root = acpi_map_table(rsdp->xsdt_address);
+        entry_size = sizeof(u64);
+    }
+    else
+    {
+        root = acpi_map_table(rsdp->rsdt_address);
+        entry_size = sizeof(u32);
+    }
+
+    if (root == NULL || !acpi_checksum(root, root->length))
+    {
+        printk("acpi: invalid root table\n");
+        return -1;
+    }
+
+    entries = (root->length - sizeof(struct acpi_sdt_header)) / entry_size;
+    for (index = 0; index < entries; index++)
+    {
+        const u8 *entry = (const u8 *)(root + 1) + index * entry_size;
+        u64 phys;
+
+        if (entry_size == sizeof(u64))
+            memcpy(&phys, entry, sizeof(u64));
+        else
+            phys = *(const u32 *)entry;
+
+        acpi_add_table(phys);
+    }
+
+    /* The DSDT is only reachable through the FADT */
+    fadt = acpi_find_table(ACPI_SIGNATURE__FADT, 0);
+    if (fadt != NULL)
+    {
+        u64 dsdt = 0;
+
+        if (fadt->length >= ACPI_FADT__X_DSDT_OFFSET + sizeof(u64))
+            memcpy(&dsdt, (const u8 *)fadt + ACPI_FADT__X_DSDT_OFFSET, sizeof(u64));
+        if (dsdt == 0 && fadt->length >= ACPI_FADT__DSDT_OFFSET + sizeof(u32))
+            dsdt = *(const u32 *)((const u8 *)fadt + ACPI_FADT__DSDT_OFFSET);
+        acpi_add_table(dsdt);
+    }
+
+    printk("acpi: revision %u, %zu tables:", rsdp->revision, acpi_tables_count);
+    for (index = 0; index < acpi_tables_count; index++)
+    {
+        const char *signature = acpi_tables[index].header->signature;
+
+        printk(" %c%c%c%c", signature[0], signature[1], signature[2], signature[3]);
+    }
+    printk("\n");
+
+    return 0;
+}
+
+const struct acpi_sdt_header *acpi_find_table(u32 signature, size_t instance)
+{
+    u32 slot;
+
+    if (acpi_tables_count == 0)
+        return NULL;
+
+    for (slot = acpi_hash(signature); acpi_index[slot] != ACPI_NONE; slot = (slot + 1) % ACPI_INDEX_SIZE)
+    {
+        const struct acpi_table *table = &acpi_tables[acpi_index[slot]];
+
+        if (table->signature != signature)
+            continue;
+
+        while (instance-- > 0)
+        {
+            if (table->next == ACPI_NONE)
+                return NULL;
+            table = &acpi_tables[table->next];
+        }
+
+        return table->header;
+    }
+
+    return NULL;
+}
+
+size_t acpi_table_count(void)
+{
+    return acpi_tables_count;
+}
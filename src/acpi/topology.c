@@ -0,0 +1,269 @@
+#include <types.h>
+#include <acpi/acpi.h>
+#include <acpi/tables.h>
+#include <acpi/topology.h>
+#include <boot/init.h>
+#include <lib/printk.h>
+#include <lib/string.h>
+
+struct acpi_topology acpi_topology;
+
+/* Returns the node for a proximity domain, allocating the next one on first sight */
+static u32 __init acpi_node(u32 domain)
+{
+    u32 node;
+
+    for (node = 0; node < acpi_topology.node_count; node++)
+        if (acpi_topology.node_domains[node] == domain)
+            return node;
+
+    if (acpi_topology.node_count == ACPI_MAX_NODES)
+    {
+        printk("acpi: proximity domain %u folded into node 0\n", domain);
+        return 0;
+    }
+
+    acpi_topology.node_domains[acpi_topology.node_count] = domain;
+
+    return acpi_topology.node_count++;
+}
+
+static struct acpi_topology__cpu *__init acpi_cpu_by_apic_id(u32 apic_id)
+{
+    size_t index;
+
+    for (index = 0; index < acpi_topology.cpu_count; index++)
+        if (acpi_topology.cpus[index].apic_id == apic_id)
+            return &acpi_topology.cpus[index];
+
+    return NULL;
+}
+
+/* Enabled CPUs of the MADT left out of acpi_topology for lack of room */
+static u32 acpi_cpus_dropped;
+
+static void __init acpi_add_cpu(u32 apic_id, u32 processor_uid, u32 flags)
+{
+    struct acpi_topology__cpu *cpu;
+
+    if (!(flags & ACPI_MADT__LOCAL_APIC__ENABLED) || acpi_cpu_by_apic_id(apic_id) != NULL)
+        return;
+
+    if (acpi_topology.cpu_count == NR_CPUS)
+    {
+        acpi_cpus_dropped++;
+        /* The boot CPU is running this code: it takes the last slot rather than go missing */
+        if (apic_id != cpu_apic_id())
+            return;
+        acpi_topology.cpu_count--;
+    }
+
+    cpu = &acpi_topology.cpus[acpi_topology.cpu_count++];
+    cpu->apic_id = apic_id;
+    cpu->processor_uid = processor_uid;
+    cpu->node = 0;
+
+    return;
+}
+
+static void __init acpi_parse_madt(const struct acpi_madt *madt)
+{
+    const u8 *entry = madt->entries;
+    const u8 *end = (const u8 *)madt + madt->header.length;
+
+    acpi_topology.local_apic_address = madt->local_apic_address;
+
+    while (entry + sizeof(struct acpi_madt_entry) <= end)
+    {
+        const struct acpi_madt_entry *header = (const struct acpi_madt_entry *)entry;
+
+        if (header->length < sizeof(struct acpi_madt_entry) || entry + header->length > end)
+            break;
+
+        switch (header->type)
+        {
+            case ACPI_MADT__TYPE__LOCAL_APIC:
+            {
+                const struct acpi_madt_entry__local_apic *lapic = (const void *)entry;
+
+                acpi_add_cpu(lapic->apic_id, lapic->processor_uid, lapic->flags);
+                break;
+            }
+            case ACPI_MADT__TYPE__LOCAL_X2APIC:
+            {
+                const struct acpi_madt_entry__local_x2apic *x2apic = (const void *)entry;
+
+                acpi_add_cpu(x2apic->x2apic_id, x2apic->processor_uid, x2apic->flags);
+                break;
+            }
+            case ACPI_MADT__TYPE__IO_APIC:
+            {
+                const struct acpi_madt_entry__io_apic *ioapic = (const void *)entry;
+                struct acpi_topology__io_apic *info;
+
+                if (acpi_topology.io_apic_count == ACPI_MAX_IO_APICS)
+                    break;
+                info = &acpi_topology.io_apics[acpi_topology.io_apic_count++];
+                info->id = ioapic->id;
+                info->address = ioapic->address;
+                info->gsi_base = ioapic->gsi_base;
+                break;
+            }
+            case ACPI_MADT__TYPE__INTERRUPT_OVERRIDE:
+            {
+                const struct acpi_madt_entry__interrupt_override *iso = (const void *)entry;
+                struct acpi_topology__override *info;
+
+                if (acpi_topology.override_count == ACPI_MAX_OVERRIDES)
+                    break;
+                info = &acpi_topology.overrides[acpi_topology.override_count++];
+                info->source = iso->source;
+                info->gsi = iso->gsi;
+                info->flags = iso->flags;
+                break;
+            }
+            case ACPI_MADT__TYPE__LOCAL_APIC_OVERRIDE:
+            {
+                const struct acpi_madt_entry__local_apic_override *override = (const void *)entry;
+
+                acpi_topology.local_apic_address = override->address;
+                break;
+            }
+            default:
+                break;
+        }
+
+        entry += header->length;
+    }
+
+    return;
+}
+
+static void __init acpi_parse_srat(const struct acpi_srat *srat)
+{
+    const u8 *entry = srat->entries;
+    const u8 *end = (const u8 *)srat + srat->header.length;
+
+    while (entry + 2 <= end)
+    {
+        u8 type = entry[0];
+        u8 length = entry[1];
+
+        if (length < 2 || entry + length > end)
+            break;
+
+        if (type == ACPI_SRAT__TYPE__PROCESSOR)
+        {
+            const struct acpi_srat_entry__processor *cpu = (const void *)entry;
+            u32 domain = cpu->proximity_domain_low | (u32)cpu->proximity_domain_high[0] << 8 |
+                         (u32)cpu->proximity_domain_high[1] << 16 | (u32)cpu->proximity_domain_high[2] << 24;
+            struct acpi_topology__cpu *info = acpi_cpu_by_apic_id(cpu->apic_id);
+
+            if ((cpu->flags & ACPI_SRAT__ENABLED) && info != NULL)
+                info->node = acpi_node(domain);
+        }
+        else if (type == ACPI_SRAT__TYPE__X2APIC)
+        {
+            const struct acpi_srat_entry__x2apic *cpu = (const void *)entry;
+            struct acpi_topology__cpu *info = acpi_cpu_by_apic_id(cpu->x2apic_id);
+
+            if ((cpu->flags & ACPI_SRAT__ENABLED) && info != NULL)
+                info->node = acpi_node(cpu->proximity_domain);
+        }
+        else if (type == ACPI_SRAT__TYPE__MEMORY)
+        {
+            const struct acpi_srat_entry__memory *memory = (const void *)entry;
+            struct acpi_topology__memory *info;
+
+            if ((memory->flags & ACPI_SRAT__ENABLED) && acpi_topology.memory_count < ACPI_MAX_MEMORY_RANGES)
+            {
+                info = &acpi_topology.memory[acpi_topology.memory_count++];
+                info->base = (u64)memory->base_high << 32 | memory->base_low;
+                info->length = (u64)memory->length_high << 32 | memory->length_low;
+                info->node = acpi_node(memory->proximity_domain);
+                info->hotplug = (memory->flags & ACPI_SRAT__MEMORY__HOTPLUG) != 0;
+            }
+        }
+
+        entry += length;
+    }
+
+    return;
+}
+
+/* SLIT rows and columns are proximity domains; only the ones seen in the SRAT are kept */
+static void __init acpi_parse_slit(const struct acpi_slit *slit)
+{
+    u64 count = slit->locality_count;
+    u32 from;
+    u32 to;
+
+    if (sizeof(struct acpi_slit) + count * count > slit->header.length)
+        return;
+
+    for (from = 0; from < acpi_topology.node_count; from++)
+    {
+        for (to = 0; to < acpi_topology.node_count; to++)
+        {
+            u64 row = acpi_topology.node_domains[from];
+            u64 column = acpi_topology.node_domains[to];
+
+            if (row < count && column < count)
+                acpi_topology.distance[from][to] = slit->entries[row * count + column];
+        }
+    }
+
+    return;
+}
+
+int __init acpi_topology_init(void)
+{
+    const struct acpi_sdt_header *madt = acpi_find_table(ACPI_SIGNATURE__MADT, 0);
+    const struct acpi_sdt_header *srat = acpi_find_table(ACPI_SIGNATURE__SRAT, 0);
+    const struct acpi_sdt_header *slit = acpi_find_table(ACPI_SIGNATURE__SLIT, 0);
+    struct acpi_topology__cpu *boot_cpu;
+    u32 from;
+    u32 to;
+
+    memset(&acpi_topology, 0, sizeof(acpi_topology));
+    acpi_cpus_dropped = 0;
+
+    if (madt != NULL)
+        acpi_parse_madt((const struct acpi_madt *)madt);
+    if (acpi_cpus_dropped)
+        printk("acpi: %u cpus beyond NR_CPUS (%u) ignored\n", acpi_cpus_dropped, NR_CPUS);
+
+    /* The boot CPU goes first: positions in the table are cpu_index() values */
+    boot_cpu = acpi_cpu_by_apic_id(cpu_apic_id());
+    if (boot_cpu != NULL && boot_cpu != &acpi_topology.cpus[0])
+    {
+        struct acpi_topology__cpu first = acpi_topology.cpus[0];
+
+        acpi_topology.cpus[0] = *boot_cpu;
+        *boot_cpu = first;
+    }
+
+    if (acpi_topology.cpu_count == 0)
+    {
+        /* No MADT: at least the boot CPU exists */
+        acpi_topology.cpus[0].apic_id = cpu_apic_id();
+        acpi_topology.cpu_count = 1;
+    }
+
+    if (srat != NULL)
+        acpi_parse_srat((const struct acpi_srat *)srat);
+    if (acpi_topology.node_count == 0)
+        acpi_topology.node_count = 1;
+
+    for (from = 0; from < acpi_topology.node_count; from++)
+        for (to = 0; to < acpi_topology.node_count; to++)
+            acpi_topology.distance[from][to] = from == to ? ACPI_DISTANCE__LOCAL : ACPI_DISTANCE__REMOTE;
+
+    if (slit != NULL && srat != NULL)
+        acpi_parse_slit((const struct acpi_slit *)slit);
+
+    printk("acpi: %zu cpus, %zu io-apics, %u nodes\n",
+           acpi_topology.cpu_count, acpi_topology.io_apic_count, acpi_topology.node_count);
+
+    return madt != NULL ? 0 : -1;
+}
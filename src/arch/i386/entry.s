@@ -0,0 +1,136 @@
+; Interrupt, exception and system-call entry, and the context switch
+;
+; Every vector gets a stub that pushes a dummy error code (unless the CPU
+; pushed one) and its vector number, then jumps to interrupt_common, which
+; completes a struct interrupt_frame (include/arch/interrupt.h) and passes
+; it to interrupt_dispatch().
+
+section .text
+bits 32
+global interrupt_stubs
+global interrupt_return
+global sysenter_entry
+global context_switch
+extern interrupt_dispatch
+extern syscall_dispatch
+
+; include/arch/gdt.h
+GDT_KERNEL_DS equ 0x10
+GDT_USER_DS equ 0x23
+
+; struct syscall_cpu (src/arch/i386/syscall.c), relative to SYSENTER_ESP
+SYSCALL_CPU_KERNEL_SP equ 0
+
+; Exceptions that push an error code: #DF, #TS, #NP, #SS, #GP, #PF, #AC, #CP, #VC, #SX
+%assign vector 0
+%rep 256
+interrupt_stub_%+vector:
+%if (vector == 8) || (vector >= 10 && vector <= 14) || (vector == 17) || (vector == 21) || (vector == 29) || (vector == 30)
+%else
+    push 0
+%endif
+    push vector
+    jmp interrupt_common
+%assign vector vector + 1
+%endrep
+
+interrupt_common:
+    push ds
+    push es
+    pusha
+
+    ; SS always holds the kernel data segment here: reload the others from it
+    mov ax, ss
+    mov ds, ax
+    mov es, ax
+
+    cld
+    push esp
+    call interrupt_dispatch
+    add esp, 4
+
+; Also where a new process first enters user mode, from a frame built by process_create()
+interrupt_return:
+    popa
+    pop es
+    pop ds
+
+    ; Drop the vector and error code
+    add esp, 8
+    iret
+
+; SYSENTER loads ESP with the address of this CPU's syscall_cpu.kernel_sp,
+; the top of its entry stack, and masks interrupts; by convention EDX holds
+; the user return address and ECX the user stack. Build a struct
+; syscall_frame (include/arch/syscall.h) on the running process's kernel
+; stack. An NMI, or the single-step trap of a user that set TF, can arrive
+; before the first instruction: it runs on the entry stack.
+sysenter_entry:
+    mov esp, [esp + SYSCALL_CPU_KERNEL_SP]
+
+    push ecx
+    push edx
+    push eax
+    push ebx
+    push esi
+    push edi
+    push ebp
+
+    ; DS and ES still hold whatever user mode left in them
+    mov ax, GDT_KERNEL_DS
+    mov ds, ax
+    mov es, ax
+
+    sti
+    cld
+    push esp
+    call syscall_dispatch
+    add esp, 4
+    cli
+
+    mov ax, GDT_USER_DS
+    mov ds, ax
+    mov es, ax
+
+    pop ebp
+    pop edi
+    pop esi
+    pop ebx
+    pop eax
+    pop edx
+    pop ecx
+
+    ; STI takes effect after the next instruction, so nothing interrupts before SYSEXIT
+    sti
+    sysexit
+
+; void context_switch(uintptr_t *save_sp, uintptr_t sp)
+; EFLAGS travels with the context: a process that exits from an exception
+; handler must not leave interrupts disabled for the code it resumes
+context_switch:
+    mov eax, [esp + 4]
+    mov edx, [esp + 8]
+
+    pushfd
+    push ebx
+    push esi
+    push edi
+    push ebp
+    mov [eax], esp
+
+    mov esp, edx
+    pop ebp
+    pop edi
+    pop esi
+    pop ebx
+    popfd
+    ret
+
+section .rodata
+align 4
+interrupt_stubs:
+%assign vector 0
+%rep 256
+    dd interrupt_stub_%+vector
+%assign vector vector + 1
+%endrep
@@ -0,0 +1,96 @@
+#include <types.h>
+#include <arch/cpu.h>
+#include <arch/gdt.h>
+#include <boot/init.h>
+
+/* Flat 4GB segments, DPL 0 for the kernel and 3 for user mode */
+#define GDT_KERNEL_CODE     0x00CF9A000000FFFFULL
+#define GDT_KERNEL_DATA     0x00CF92000000FFFFULL
+#define GDT_USER_CODE       0x00CFFA000000FFFFULL
+#define GDT_USER_DATA       0x00CFF2000000FFFFULL
+
+/* Present, available 32-bit TSS */
+#define GDT_ACCESS__TSS     0x89
+
+/* Null, four segments, then one TSS descriptor per CPU */
+#define GDT_ENTRIES         (GDT_TSS / 8 + NR_CPUS)
+
+/* Only the ring 0 stack is used: there is no hardware task switching */
+struct tss
+{
+    u32 link;
+    u32 esp0;
+    u32 ss0;
+    u32 unused[22];
+    u16 trap;
+    u16 iomap_base;
+} __attribute__ ((packed));
+
+struct gdt_pointer
+{
+    u16 limit;
+    u32 base;
+} __attribute__ ((packed));
+
+static u64 gdt[GDT_ENTRIES] __attribute__ ((aligned(8)));
+static struct tss gdt_tss[NR_CPUS] __attribute__ ((aligned(8)));
+
+void __init gdt_init(void)
+{
+    u32 cpu;
+
+    gdt[0] = 0;
+    gdt[GDT_KERNEL_CS / 8] = GDT_KERNEL_CODE;
+    gdt[GDT_KERNEL_DS / 8] = GDT_KERNEL_DATA;
+    gdt[GDT_USER_CS / 8] = GDT_USER_CODE;
+    gdt[GDT_USER_DS / 8] = GDT_USER_DATA;
+
+    for (cpu = 0; cpu < NR_CPUS; cpu++)
+    {
+        uintptr_t base = (uintptr_t)&gdt_tss[cpu];
+        u32 limit = sizeof(struct tss) - 1;
+
+        gdt_tss[cpu].ss0 = GDT_KERNEL_DS;
+        /* An I/O map base past the limit: no port is accessible from user mode */
+        gdt_tss[cpu].iomap_base = sizeof(struct tss);
+
+        gdt[GDT_TSS / 8 + cpu] = (limit & 0xFFFF) | ((u64)(base & 0xFFFFFF) << 16) |
+                                 ((u64)GDT_ACCESS__TSS << 40) | ((u64)((limit >> 16) & 0xF) << 48) |
+                                 ((u64)((base >> 24) & 0xFF) << 56);
+    }
+
+    gdt_load(0);
+
+    return;
+}
+
+void gdt_load(u32 cpu)
+{
+    struct gdt_pointer pointer;
+
+    pointer.limit = sizeof(gdt) - 1;
+    pointer.base = (uintptr_t)gdt;
+
+    __asm__ volatile ("lgdt %0" : : "m"(pointer));
+
+    /* Replace the boot loader's selectors: a far jump reloads CS, the data segments follow */
+    __asm__ volatile ("ljmp %[cs], $1f\n\t"
+                      "1:\n\t"
+                      "mov %w[ds], %%ds\n\t"
+                      "mov %w[ds], %%es\n\t"
+                      "mov %w[ds], %%ss\n\t"
+                      "mov %w[null], %%fs\n\t"
+                      "mov %w[null], %%gs"
+                      : : [cs] "i"(GDT_KERNEL_CS), [ds] "r"(GDT_KERNEL_DS), [null] "r"(0) : "memory");
+
+    __asm__ volatile ("ltr %w0" : : "r"(GDT_TSS + GDT_TSS_SIZE * cpu));
+
+    return;
+}
+
+void tss_set_kernel_stack(uintptr_t top)
+{
+    gdt_tss[cpu_index()].esp0 = top;
+
+    return;
+}
@@ -0,0 +1,59 @@
+#include <types.h>
+#include <arch/gdt.h>
+#include <arch/interrupt.h>
+#include <boot/init.h>
+
+/* Present, DPL 0, 32-bit interrupt gate (IF cleared on entry) */
+#define IDT_GATE__INTERRUPT     0x8E
+
+struct idt_gate
+{
+    u16 offset_low;
+    u16 selector;
+    u8 zero;
+    u8 flags;
+    u16 offset_high;
+} __attribute__ ((packed));
+
+struct idt_pointer
+{
+    u16 limit;
+    u32 base;
+} __attribute__ ((packed));
+
+/* Entry stub addresses, one per vector (entry.s) */
+extern const uintptr_t interrupt_stubs[INTERRUPT_VECTORS];
+
+static struct idt_gate idt[INTERRUPT_VECTORS] __attribute__ ((aligned(8)));
+
+void __init idt_init(void)
+{
+    u32 vector;
+
+    for (vector = 0; vector < INTERRUPT_VECTORS; vector++)
+    {
+        uintptr_t offset = interrupt_stubs[vector];
+
+        idt[vector].offset_low = (u16)offset;
+        idt[vector].selector = GDT_KERNEL_CS;
+        idt[vector].zero = 0;
+        idt[vector].flags = IDT_GATE__INTERRUPT;
+        idt[vector].offset_high = (u16)(offset >> 16);
+    }
+
+    idt_load();
+
+    return;
+}
+
+void idt_load(void)
+{
+    struct idt_pointer pointer;
+
+    pointer.limit = sizeof(idt) - 1;
+    pointer.base = (uintptr_t)idt;
+
+    __asm__ volatile ("lidt %0" : : "m"(pointer));
+
+    return;
+}
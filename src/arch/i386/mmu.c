@@ -0,0 +1,258 @@
+#include <types.h>
+#include <arch/arch.h>
+#include <arch/cpu.h>
+#include <boot/init.h>
+#include <lib/spinlock.h>
+#include <lib/string.h>
+#include <lib/util.h>
+#include <mm/cow.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+#include <mm/prezero.h>
+
+#define PTE_PRESENT         ((u32)1 << 0)
+#define PTE_WRITABLE        ((u32)1 << 1)
+#define PTE_USER            ((u32)1 << 2)
+#define PTE_WRITE_THROUGH   ((u32)1 << 3)
+#define PTE_CACHE_DISABLE   ((u32)1 << 4)
+#define PTE_LARGE           ((u32)1 << 7)   /* 4MB page, in a directory entry */
+#define PTE_OWNED           ((u32)1 << 9)   /* ignored by the CPU: MMU_USER__OWNED */
+#define PTE_COW             ((u32)1 << 10)  /* ignored by the CPU: MMU_USER__COW */
+#define PTE_ADDRESS_MASK    ((u32)0xFFFFF000U)
+
+#define PD_INDEX(addr)      ((addr) >> 22)
+#define PT_INDEX(addr)      (((addr) >> 12) & 0x3FF)
+#define PT_ENTRIES          1024
+#define PD_LARGE_SIZE       ((u64)1 << 22)
+
+#define CR0_WP              ((uintptr_t)1 << 16)
+#define CR0_PG              ((uintptr_t)1 << 31)
+#define CR4_PSE             ((uintptr_t)1 << 4)
+
+#define CPUID_1_EDX__PSE    ((u32)1 << 3)
+
+static spinlock_t mmu_lock = SPINLOCK_INIT;
+
+/* Identity map of all 4GB with 4MB pages, the template for every process directory */
+static u32 mmu_kernel_directory[PT_ENTRIES] __attribute__ ((aligned(4096)));
+
+/*
+ * Paging is enabled by mmu_init() with everything below 4GB mapped at its
+ * physical address, so pointers taken before and after stay valid.
+ */
+int __init mmu_init(void)
+{
+    u32 eax, ebx, ecx, edx;
+    u32 index;
+
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_1_EDX__PSE))
+        return -1;
+
+    for (index = 0; index < PT_ENTRIES; index++)
+        mmu_kernel_directory[index] = (index << 22) | PTE_PRESENT | PTE_WRITABLE | PTE_LARGE;
+
+    write_cr4(read_cr4() | CR4_PSE);
+    write_cr3(virt_to_phys(mmu_kernel_directory));
+    /* With WP, supervisor writes fault on read-only pages too */
+    write_cr0(read_cr0() | CR0_PG | CR0_WP);
+
+    return 0;
+}
+
+/* Sets 'flags' on the 4MB pages covering the range */
+static void *mmu_map_large(u64 phys, size_t size, u32 flags)
+{
+    u64 addr;
+    u64 end = phys + size;
+
+    if (size == 0 || end - 1 > MAX_PHYS_ADDR)
+        return NULL;
+
+    spin_lock(&mmu_lock);
+
+    for (addr = ALIGN_DOWN(phys, PD_LARGE_SIZE); addr < end; addr += PD_LARGE_SIZE)
+    {
+        mmu_kernel_directory[PD_INDEX(addr)] |= flags;
+        invlpg((uintptr_t)addr);
+    }
+
+    spin_unlock(&mmu_lock);
+
+    return (void *)(uintptr_t)phys;
+}
+
+void *mmu_map_io(u64 phys, size_t size)
+{
+    return mmu_map_large(phys, size, PTE_WRITE_THROUGH | PTE_CACHE_DISABLE);
+}
+
+void *mmu_map(u64 phys, size_t size)
+{
+    return mmu_map_large(phys, size, 0);
+}
+
+int mmu_space_create(struct mmu_space *space)
+{
+    uintptr_t frame = frame_alloc();
+    u32 *directory;
+
+    if (frame == 0)
+        return -1;
+
+    directory = (u32 *)phys_to_virt(frame);
+
+    spin_lock(&mmu_lock);
+    memcpy(directory, mmu_kernel_directory, PAGE_SIZE);
+    spin_unlock(&mmu_lock);
+
+    memset(&directory[PD_INDEX(USER_BASE)], 0, (PD_INDEX(USER_END) - PD_INDEX(USER_BASE)) * sizeof(u32));
+    space->root = frame;
+
+    return 0;
+}
+
+void mmu_space_destroy(struct mmu_space *space)
+{
+    u32 *directory = (u32 *)phys_to_virt(space->root);
+    u32 index;
+
+    for (index = PD_INDEX(USER_BASE); index < PD_INDEX(USER_END); index++)
+    {
+        u32 *table;
+        u32 entry;
+
+        if (!(directory[index] & PTE_PRESENT))
+            continue;
+
+        table = (u32 *)phys_to_virt(directory[index] & PTE_ADDRESS_MASK);
+        for (entry = 0; entry < PT_ENTRIES; entry++)
+        {
+            /* Owned frames still mapped copy-on-write elsewhere stay with the other spaces */
+            if ((table[entry] & PTE_PRESENT) && (table[entry] & PTE_OWNED) &&
+                cow_release(table[entry] & PTE_ADDRESS_MASK))
+                frame_free(table[entry] & PTE_ADDRESS_MASK);
+        }
+        frame_free(virt_to_phys(table));
+    }
+
+    frame_free(space->root);
+    space->root = 0;
+
+    return;
+}
+
+void mmu_space_switch(const struct mmu_space *space)
+{
+    uintptr_t root = space != NULL ? space->root : virt_to_phys(mmu_kernel_directory);
+
+    if ((read_cr3() & PTE_ADDRESS_MASK) != root)
+        write_cr3(root);
+
+    return;
+}
+
+/* MMU_USER__ flags to page-table bits and back */
+static inline u32 mmu_user_pte(u32 flags)
+{
+    return ((flags & MMU_USER__WRITABLE) ? PTE_WRITABLE : 0) | ((flags & MMU_USER__OWNED) ? PTE_OWNED : 0) |
+           ((flags & MMU_USER__COW) ? PTE_COW : 0);
+}
+
+static inline u32 mmu_user_flags(u32 entry)
+{
+    return ((entry & PTE_WRITABLE) ? MMU_USER__WRITABLE : 0) | ((entry & PTE_OWNED) ? MMU_USER__OWNED : 0) |
+           ((entry & PTE_COW) ? MMU_USER__COW : 0);
+}
+
+/* Page-table entry for 'virt', creating the table when 'create' is set; call with mmu_lock held */
+static u32 *mmu_user_entry(uintptr_t root, uintptr_t virt, bool create)
+{
+    u32 *pde = &((u32 *)phys_to_virt(root))[PD_INDEX(virt)];
+    uintptr_t frame;
+
+    if (!(*pde & PTE_PRESENT))
+    {
+        if (!create)
+            return NULL;
+
+        frame = prezero_alloc();
+        if (frame == 0)
+            return NULL;
+
+        *pde = frame | PTE_PRESENT | PTE_WRITABLE | PTE_USER;
+    }
+
+    return &((u32 *)phys_to_virt(*pde & PTE_ADDRESS_MASK))[PT_INDEX(virt)];
+}
+
+int mmu_map_user(struct mmu_space *space, uintptr_t virt, uintptr_t phys, u32 flags)
+{
+    u32 *entry;
+
+    if (virt < USER_BASE || virt >= USER_END || (virt & PAGE_MASK) || (phys & PAGE_MASK))
+        return -1;
+
+    spin_lock(&mmu_lock);
+
+    entry = mmu_user_entry(space->root, virt, true);
+    if (entry != NULL)
+    {
+        *entry = phys | PTE_PRESENT | PTE_USER | mmu_user_pte(flags);
+        if ((read_cr3() & PTE_ADDRESS_MASK) == space->root)
+            invlpg(virt);
+    }
+
+    spin_unlock(&mmu_lock);
+
+    return entry != NULL ? 0 : -1;
+}
+
+uintptr_t mmu_translate_user(const struct mmu_space *space, uintptr_t virt, u32 *flags)
+{
+    uintptr_t phys = 0;
+    u32 *entry;
+
+    if (virt < USER_BASE || virt >= USER_END)
+        return 0;
+
+    spin_lock(&mmu_lock);
+
+    entry = mmu_user_entry(space->root, virt, false);
+    if (entry != NULL && (*entry & PTE_PRESENT))
+    {
+        phys = *entry & PTE_ADDRESS_MASK;
+        if (flags != NULL)
+            *flags = mmu_user_flags(*entry);
+    }
+
+    spin_unlock(&mmu_lock);
+
+    return phys;
+}
+
+uintptr_t mmu_unmap_user(struct mmu_space *space, uintptr_t virt, u32 *flags)
+{
+    uintptr_t phys = 0;
+    u32 *entry;
+
+    if (virt < USER_BASE || virt >= USER_END)
+        return 0;
+
+    spin_lock(&mmu_lock);
+
+    entry = mmu_user_entry(space->root, virt, false);
+    if (entry != NULL && (*entry & PTE_PRESENT))
+    {
+        phys = *entry & PTE_ADDRESS_MASK;
+        if (flags != NULL)
+            *flags = mmu_user_flags(*entry);
+        *entry = 0;
+        if ((read_cr3() & PTE_ADDRESS_MASK) == space->root)
+            invlpg(virt);
+    }
+
+    spin_unlock(&mmu_lock);
+
+    return phys;
+}
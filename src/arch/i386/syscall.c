@@ -0,0 +1,77 @@
+#include <types.h>
+#include <arch/cpu.h>
+#include <arch/gdt.h>
+#include <arch/interrupt.h>
+#include <arch/syscall.h>
+#include <irq/irq.h>
+
+#define MSR_SYSENTER_CS     0x174
+#define MSR_SYSENTER_ESP    0x175
+#define MSR_SYSENTER_EIP    0x176
+
+#define CPUID_1_EDX__SEP    ((u32)1 << 11)
+
+/*
+ * Room for an exception frame and the C handlers behind it, the fatal
+ * path with printk() included, with some to spare
+ */
+#define SYSCALL_ENTRY_STACK_SIZE    2048
+
+/*
+ * SYSENTER_ESP is fixed per CPU while the kernel stack changes with every
+ * process, so it points at 'kernel_sp' and sysenter_entry loads the real
+ * stack from there. Until it does, ESP is the top of 'entry_stack': an NMI
+ * or debug trap taken on the first instruction pushes its frame there
+ * instead of over other data.
+ */
+struct syscall_cpu
+{
+    u8 entry_stack[SYSCALL_ENTRY_STACK_SIZE];
+    uintptr_t kernel_sp;
+} __attribute__ ((aligned(64)));
+
+extern u8 sysenter_entry[];
+
+static struct syscall_cpu syscall_cpus[NR_CPUS];
+
+/*
+ * SYSENTER leaves TF set, so a user that sets it takes a single-step trap
+ * on sysenter_entry itself, in ring 0 on the entry stack. Clearing TF lets
+ * the system call go on; every other debug exception is handled as before.
+ */
+static void syscall_debug_trap(struct interrupt_frame *frame)
+{
+    if (frame->ip == (uintptr_t)sysenter_entry && !(frame->cs & 3))
+    {
+        frame->flags &= ~EFLAGS__TF;
+        return;
+    }
+
+    irq_exception(frame);
+
+    return;
+}
+
+int syscall_init(void)
+{
+    u32 eax, ebx, ecx, edx;
+
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_1_EDX__SEP))
+        return -1;
+
+    /* SYSENTER loads CS from here and SS from the next descriptor; SYSEXIT uses the two after */
+    wrmsr(MSR_SYSENTER_CS, GDT_KERNEL_CS);
+    wrmsr(MSR_SYSENTER_ESP, (uintptr_t)&syscall_cpus[cpu_index()].kernel_sp);
+    wrmsr(MSR_SYSENTER_EIP, (uintptr_t)sysenter_entry);
+    irq_register(INTERRUPT_VECTOR__DEBUG, syscall_debug_trap);
+
+    return 0;
+}
+
+void syscall_set_kernel_stack(uintptr_t top)
+{
+    syscall_cpus[cpu_index()].kernel_sp = top;
+
+    return;
+}
@@ -0,0 +1,110 @@
+; Application processor startup (see smp_init() in src/smp/smp.c)
+;
+; smp_start() copies everything from smp_trampoline_start to
+; smp_trampoline_end into the AP's own page below 1MB and fills in the
+; data block at the end; a STARTUP IPI then starts the AP in real mode at
+; the start of that page. The copy runs at whatever address it was given, so the code
+; only uses offsets from smp_trampoline_start plus the page's linear
+; address, which it takes from CS and keeps in EBX. The top of the page is
+; the stack until the kernel's. From real mode it enables protected mode
+; and paging on the kernel's page directory, then calls smp_ap_entry(cpu)
+; on the stack it was given.
+
+CR0_PE              equ 1 << 0
+CR0_WP              equ 1 << 16
+CR0_PG              equ 1 << 31
+CR4_PSE             equ 1 << 4
+
+TRAMPOLINE_SIZE     equ 0x1000
+TRAMPOLINE_CODE     equ 0x08
+TRAMPOLINE_DATA     equ 0x10
+
+%define OFFSET(label) ((label) - smp_trampoline_start)
+
+; Copied before it runs, never executed in place; its own section so the
+; linker script can KEEP it
+section .rodata.trampoline progbits alloc noexec nowrite align=16
+global smp_trampoline_start
+global smp_trampoline_end
+
+align 16
+bits 16
+smp_trampoline_start:
+    cli
+    cld
+    mov ax, cs
+    mov ds, ax
+    mov ss, ax
+    mov sp, TRAMPOLINE_SIZE
+    movzx ebx, ax
+    shl ebx, 4
+
+    ; The GDT base must be linear
+    lea eax, [ebx + OFFSET(trampoline_gdt)]
+    mov [OFFSET(trampoline_gdt_pointer) + 2], eax
+    o32 lgdt [OFFSET(trampoline_gdt_pointer)]
+
+    mov eax, cr0
+    or eax, CR0_PE
+    mov cr0, eax
+
+    ; A far return loads the 32-bit code segment
+    lea eax, [ebx + OFFSET(trampoline_protected)]
+    push dword TRAMPOLINE_CODE
+    push eax
+    o32 retf
+
+bits 32
+trampoline_protected:
+    mov ax, TRAMPOLINE_DATA
+    mov ds, ax
+    mov es, ax
+    mov ss, ax
+    lea esp, [ebx + TRAMPOLINE_SIZE]
+
+    ; The kernel directory maps everything with 4MB pages at its physical address
+    mov eax, cr4
+    or eax, CR4_PSE
+    mov cr4, eax
+
+    mov eax, [ebx + OFFSET(trampoline_cr3)]
+    mov cr3, eax
+
+    mov eax, cr0
+    or eax, CR0_PG | CR0_WP
+    mov cr0, eax
+
+    ; Sixteen bytes below the aligned top at the call, as the compiler expects
+    mov esp, [ebx + OFFSET(trampoline_stack)]
+    sub esp, 12
+    push dword [ebx + OFFSET(trampoline_cpu)]
+    mov eax, [ebx + OFFSET(trampoline_entry)]
+    call eax
+
+.halt:
+    cli
+    hlt
+    jmp .halt
+
+; Flat segments; smp_ap_entry() replaces them with the kernel's GDT
+align 8
+trampoline_gdt:
+    dq 0
+    dq 0x00CF9A000000FFFF   ; code
+    dq 0x00CF92000000FFFF   ; data
+trampoline_gdt_pointer:
+    dw trampoline_gdt_pointer - trampoline_gdt - 1
+    dd 0
+
+; struct smp_trampoline (src/smp/smp.c)
+align 8
+trampoline_cr3:
+    dq 0
+trampoline_stack:
+    dq 0
+trampoline_entry:
+    dq 0
+trampoline_cpu:
+    dd 0
+    dd 0
+smp_trampoline_end:
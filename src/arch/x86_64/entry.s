@@ -0,0 +1,148 @@
+; Interrupt, exception and system-call entry, and the context switch
+;
+; Every vector gets a stub that pushes a dummy error code (unless the CPU
+; pushed one) and its vector number, then jumps to interrupt_common, which
+; completes a struct interrupt_frame (include/arch/interrupt.h) and passes
+; it to interrupt_dispatch().
+
+section .text
+bits 64
+global interrupt_stubs
+global interrupt_return
+global syscall_entry
+global context_switch
+extern interrupt_dispatch
+extern syscall_dispatch
+
+; struct syscall_cpu (src/arch/x86_64/syscall.c)
+SYSCALL_CPU_KERNEL_SP equ 0
+SYSCALL_CPU_USER_SP equ 8
+
+; Exceptions that push an error code: #DF, #TS, #NP, #SS, #GP, #PF, #AC, #CP, #VC, #SX
+%assign vector 0
+%rep 256
+interrupt_stub_%+vector:
+%if (vector == 8) || (vector >= 10 && vector <= 14) || (vector == 17) || (vector == 21) || (vector == 29) || (vector == 30)
+%else
+    push 0
+%endif
+    push vector
+    jmp interrupt_common
+%assign vector vector + 1
+%endrep
+
+interrupt_common:
+    push rax
+    push rbx
+    push rcx
+    push rdx
+    push rsi
+    push rdi
+    push rbp
+    push r8
+    push r9
+    push r10
+    push r11
+    push r12
+    push r13
+    push r14
+    push r15
+
+    ; The CPU aligned the stack to 16 bytes before its 5-word frame; the
+    ; 17 words pushed since keep the call below 16-byte aligned
+    cld
+    mov rdi, rsp
+    call interrupt_dispatch
+
+; Also where a new process first enters user mode, from a frame built by process_create()
+interrupt_return:
+    pop r15
+    pop r14
+    pop r13
+    pop r12
+    pop r11
+    pop r10
+    pop r9
+    pop r8
+    pop rbp
+    pop rdi
+    pop rsi
+    pop rdx
+    pop rcx
+    pop rbx
+    pop rax
+
+    ; Drop the vector and error code
+    add rsp, 16
+    iretq
+
+; SYSCALL leaves the user RIP in RCX and RFLAGS in R11, does not switch
+; stacks and masks interrupts (SFMASK). Build a struct syscall_frame
+; (include/arch/syscall.h) on the running process's kernel stack, whose
+; top the GS-based struct syscall_cpu holds.
+syscall_entry:
+    swapgs
+    mov [gs:SYSCALL_CPU_USER_SP], rsp
+    mov rsp, [gs:SYSCALL_CPU_KERNEL_SP]
+    push qword [gs:SYSCALL_CPU_USER_SP]
+    swapgs
+
+    push r11
+    push rcx
+    push rax
+    push rdi
+    push rsi
+    push rdx
+    push r10
+    push r8
+    push r9
+
+    ; Ten words below the 16-byte aligned stack top: the call is aligned
+    sti
+    mov rdi, rsp
+    call syscall_dispatch
+    cli
+
+    pop r9
+    pop r8
+    pop r10
+    pop rdx
+    pop rsi
+    pop rdi
+    pop rax
+    pop rcx
+    pop r11
+    pop rsp
+    o64 sysret
+
+; void context_switch(uintptr_t *save_sp, uintptr_t sp)
+; RFLAGS travels with the context: a process that exits from an exception
+; handler must not leave interrupts disabled for the code it resumes
+context_switch:
+    pushfq
+    push rbx
+    push rbp
+    push r12
+    push r13
+    push r14
+    push r15
+    mov [rdi], rsp
+
+    mov rsp, rsi
+    pop r15
+    pop r14
+    pop r13
+    pop r12
+    pop rbp
+    pop rbx
+    popfq
+    ret
+
+section .rodata
+align 8
+interrupt_stubs:
+%assign vector 0
+%rep 256
+    dq interrupt_stub_%+vector
+%assign vector vector + 1
+%endrep
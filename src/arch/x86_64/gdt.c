@@ -0,0 +1,111 @@
+#include <types.h>
+#include <arch/cpu.h>
+#include <arch/gdt.h>
+#include <boot/init.h>
+
+/* Flat segments: the L bit makes the code segments 64-bit, DPL 3 makes them user segments */
+#define GDT_KERNEL_CODE     0x00AF9A000000FFFFULL
+#define GDT_KERNEL_DATA     0x00CF92000000FFFFULL
+#define GDT_USER_CODE32     0x00CFFA000000FFFFULL
+#define GDT_USER_DATA       0x00CFF2000000FFFFULL
+#define GDT_USER_CODE64     0x00AFFA000000FFFFULL
+
+/* Present, available 64-bit TSS */
+#define GDT_ACCESS__TSS     0x89
+
+/* Null, five segments, then two slots per TSS descriptor */
+#define GDT_ENTRIES         (GDT_TSS / 8 + 2 * NR_CPUS)
+
+#define GDT_IST_STACK_SIZE  4096
+
+struct tss
+{
+    u32 reserved0;
+    u64 rsp0;
+    u64 rsp1;
+    u64 rsp2;
+    u64 reserved1;
+    u64 ist[7];
+    u64 reserved2;
+    u16 reserved3;
+    u16 iomap_base;
+} __attribute__ ((packed));
+
+struct gdt_pointer
+{
+    u16 limit;
+    u64 base;
+} __attribute__ ((packed));
+
+static u64 gdt[GDT_ENTRIES] __attribute__ ((aligned(16)));
+static struct tss gdt_tss[NR_CPUS] __attribute__ ((aligned(16)));
+static u8 gdt_ist_stacks[NR_CPUS][GDT_IST_STACKS][GDT_IST_STACK_SIZE] __attribute__ ((aligned(16)));
+
+void __init gdt_init(void)
+{
+    u32 cpu;
+
+    gdt[0] = 0;
+    gdt[GDT_KERNEL_CS / 8] = GDT_KERNEL_CODE;
+    gdt[GDT_KERNEL_DS / 8] = GDT_KERNEL_DATA;
+    gdt[GDT_USER_BASE / 8] = GDT_USER_CODE32;
+    gdt[GDT_USER_DS / 8] = GDT_USER_DATA;
+    gdt[GDT_USER_CS / 8] = GDT_USER_CODE64;
+
+    for (cpu = 0; cpu < NR_CPUS; cpu++)
+    {
+        uintptr_t base = (uintptr_t)&gdt_tss[cpu];
+        u32 limit = sizeof(struct tss) - 1;
+        u32 index = GDT_TSS / 8 + 2 * cpu;
+        u32 ist;
+
+        /* An I/O map base past the limit: no port is accessible from user mode */
+        gdt_tss[cpu].iomap_base = sizeof(struct tss);
+
+        /* Slot n is ist[n - 1]; the CPU takes the top of the stack */
+        for (ist = 0; ist < GDT_IST_STACKS; ist++)
+            gdt_tss[cpu].ist[ist] = (uintptr_t)gdt_ist_stacks[cpu][ist] + GDT_IST_STACK_SIZE;
+
+        gdt[index] = (limit & 0xFFFF) | ((u64)(base & 0xFFFFFF) << 16) | ((u64)GDT_ACCESS__TSS << 40) |
+                     ((u64)((limit >> 16) & 0xF) << 48) | ((u64)((base >> 24) & 0xFF) << 56);
+        gdt[index + 1] = base >> 32;
+    }
+
+    gdt_load(0);
+
+    return;
+}
+
+void gdt_load(u32 cpu)
+{
+    struct gdt_pointer pointer;
+
+    pointer.limit = sizeof(gdt) - 1;
+    pointer.base = (uintptr_t)gdt;
+
+    __asm__ volatile ("lgdt %0" : : "m"(pointer));
+
+    /* A far return reloads CS; FS and GS are not used by the kernel */
+    __asm__ volatile ("pushq %[cs]\n\t"
+                      "leaq 1f(%%rip), %%rax\n\t"
+                      "pushq %%rax\n\t"
+                      "lretq\n\t"
+                      "1:\n\t"
+                      "mov %w[ds], %%ds\n\t"
+                      "mov %w[ds], %%es\n\t"
+                      "mov %w[ds], %%ss\n\t"
+                      "mov %w[null], %%fs\n\t"
+                      "mov %w[null], %%gs"
+                      : : [cs] "i"(GDT_KERNEL_CS), [ds] "r"(GDT_KERNEL_DS), [null] "r"(0) : "rax", "memory");
+
+    __asm__ volatile ("ltr %w0" : : "r"(GDT_TSS + GDT_TSS_SIZE * cpu));
+
+    return;
+}
+
+void tss_set_kernel_stack(uintptr_t top)
+{
+    gdt_tss[cpu_index()].rsp0 = top;
+
+    return;
+}
@@ -0,0 +1,79 @@
+#include <types.h>
+#include <arch/gdt.h>
+#include <arch/interrupt.h>
+#include <boot/init.h>
+
+/* Present, DPL 0, 64-bit interrupt gate (IF cleared on entry) */
+#define IDT_GATE__INTERRUPT     0x8E
+
+struct idt_gate
+{
+    u16 offset_low;
+    u16 selector;
+    u8 ist;
+    u8 flags;
+    u16 offset_middle;
+    u32 offset_high;
+    u32 reserved;
+} __attribute__ ((packed));
+
+struct idt_pointer
+{
+    u16 limit;
+    u64 base;
+} __attribute__ ((packed));
+
+/* Entry stub addresses, one per vector (entry.s) */
+extern const uintptr_t interrupt_stubs[INTERRUPT_VECTORS];
+
+static struct idt_gate idt[INTERRUPT_VECTORS] __attribute__ ((aligned(16)));
+
+/* Interrupt stack table slot of a vector's gate, 0 to stay on the current stack */
+static u8 __init idt_ist(u32 vector)
+{
+    switch (vector)
+    {
+        case INTERRUPT_VECTOR__NMI:
+            return GDT_IST__NMI;
+        case INTERRUPT_VECTOR__DOUBLE_FAULT:
+            return GDT_IST__DOUBLE_FAULT;
+        case INTERRUPT_VECTOR__MACHINE_CHECK:
+            return GDT_IST__MACHINE_CHECK;
+        default:
+            return 0;
+    }
+}
+
+void __init idt_init(void)
+{
+    u32 vector;
+
+    for (vector = 0; vector < INTERRUPT_VECTORS; vector++)
+    {
+        uintptr_t offset = interrupt_stubs[vector];
+
+        idt[vector].offset_low = (u16)offset;
+        idt[vector].selector = GDT_KERNEL_CS;
+        idt[vector].ist = idt_ist(vector);
+        idt[vector].flags = IDT_GATE__INTERRUPT;
+        idt[vector].offset_middle = (u16)(offset >> 16);
+        idt[vector].offset_high = (u32)(offset >> 32);
+        idt[vector].reserved = 0;
+    }
+
+    idt_load();
+
+    return;
+}
+
+void idt_load(void)
+{
+    struct idt_pointer pointer;
+
+    pointer.limit = sizeof(idt) - 1;
+    pointer.base = (uintptr_t)idt;
+
+    __asm__ volatile ("lidt %0" : : "m"(pointer));
+
+    return;
+}
@@ -0,0 +1,285 @@
+#include <types.h>
+#include <arch/arch.h>
+#include <arch/cpu.h>
+#include <boot/init.h>
+#include <lib/spinlock.h>
+#include <lib/string.h>
+#include <lib/util.h>
+#include <mm/cow.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+#include <mm/prezero.h>
+
+#define PTE_PRESENT         ((u64)1 << 0)
+#define PTE_WRITABLE        ((u64)1 << 1)
+#define PTE_USER            ((u64)1 << 2)
+#define PTE_WRITE_THROUGH   ((u64)1 << 3)
+#define PTE_CACHE_DISABLE   ((u64)1 << 4)
+#define PTE_HUGE            ((u64)1 << 7)
+#define PTE_OWNED           ((u64)1 << 9)   /* ignored by the CPU: MMU_USER__OWNED */
+#define PTE_COW             ((u64)1 << 10)  /* ignored by the CPU: MMU_USER__COW */
+#define PTE_ADDRESS_MASK    ((u64)0x000FFFFFFFFFF000UL)
+
+#define PML4_INDEX(addr)    (((addr) >> 39) & 0x1FF)
+#define PDPT_INDEX(addr)    (((addr) >> 30) & 0x1FF)
+#define PD_INDEX(addr)      (((addr) >> 21) & 0x1FF)
+#define PT_INDEX(addr)      (((addr) >> 12) & 0x1FF)
+#define PT_ENTRIES          512
+
+#define CR0_WP              ((uintptr_t)1 << 16)
+
+static spinlock_t mmu_lock = SPINLOCK_INIT;
+
+/* The boot PML4: kernel mappings are made here and copied into every process */
+static uintptr_t mmu_kernel_root;
+
+/* Returns the table referenced by 'entry', allocating an empty one if it is not present */
+static u64 *mmu_table(u64 *entry, u64 flags)
+{
+    uintptr_t frame;
+
+    if (*entry & PTE_PRESENT)
+    {
+        *entry |= flags;
+        return (u64 *)phys_to_virt(*entry & PTE_ADDRESS_MASK);
+    }
+
+    frame = prezero_alloc();
+    if (frame == 0)
+        return NULL;
+
+    *entry = frame | PTE_PRESENT | PTE_WRITABLE | flags;
+
+    return (u64 *)phys_to_virt(frame);
+}
+
+/* Identity-maps the range with 2MB pages carrying 'flags', leaving existing mappings untouched */
+static void *mmu_map_large(u64 phys, size_t size, u64 flags)
+{
+    u64 *pml4 = (u64 *)phys_to_virt(mmu_kernel_root);
+    u64 addr;
+    u64 end = phys + size;
+
+    if (size == 0 || end > MAX_VIRT_ADDR)
+        return NULL;
+    if (phys < USER_END && end > USER_BASE)
+        return NULL;
+
+    spin_lock(&mmu_lock);
+
+    for (addr = ALIGN_DOWN(phys, (u64)LARGE_PAGE_SIZE); addr < end; addr += LARGE_PAGE_SIZE)
+    {
+        u64 *pdpt = mmu_table(&pml4[PML4_INDEX(addr)], 0);
+        u64 *pd;
+
+        if (pdpt == NULL)
+            break;
+        if (pdpt[PDPT_INDEX(addr)] & PTE_HUGE)
+            continue;
+
+        pd = mmu_table(&pdpt[PDPT_INDEX(addr)], 0);
+        if (pd == NULL)
+            break;
+        if (pd[PD_INDEX(addr)] & PTE_PRESENT)
+            continue;
+
+        pd[PD_INDEX(addr)] = addr | PTE_PRESENT | PTE_WRITABLE | PTE_HUGE | flags;
+        invlpg(addr);
+    }
+
+    spin_unlock(&mmu_lock);
+
+    return addr < end ? NULL : (void *)(uintptr_t)phys;
+}
+
+void *mmu_map_io(u64 phys, size_t size)
+{
+    return mmu_map_large(phys, size, PTE_WRITE_THROUGH | PTE_CACHE_DISABLE);
+}
+
+void *mmu_map(u64 phys, size_t size)
+{
+    return mmu_map_large(phys, size, 0);
+}
+
+int __init mmu_init(void)
+{
+    mmu_kernel_root = read_cr3() & PTE_ADDRESS_MASK;
+
+    /* Supervisor writes fault on read-only pages too, so the kernel cannot write through user mappings */
+    write_cr0(read_cr0() | CR0_WP);
+
+    return 0;
+}
+
+int mmu_space_create(struct mmu_space *space)
+{
+    uintptr_t frame = frame_alloc();
+    u64 *pml4;
+
+    if (frame == 0)
+        return -1;
+
+    pml4 = (u64 *)phys_to_virt(frame);
+
+    spin_lock(&mmu_lock);
+    memcpy(pml4, phys_to_virt(mmu_kernel_root), PAGE_SIZE);
+    spin_unlock(&mmu_lock);
+
+    pml4[PML4_INDEX(USER_BASE)] = 0;
+    space->root = frame;
+
+    return 0;
+}
+
+/* Frees 'table' and everything below it; 'level' 1 is a page table, whose owned frames go too unless still shared */
+static void mmu_free_table(u64 *table, u32 level)
+{
+    u32 index;
+
+    for (index = 0; index < PT_ENTRIES; index++)
+    {
+        u64 entry = table[index];
+
+        if (!(entry & PTE_PRESENT))
+            continue;
+        if (level > 1)
+            mmu_free_table((u64 *)phys_to_virt(entry & PTE_ADDRESS_MASK), level - 1);
+        else if ((entry & PTE_OWNED) && cow_release(entry & PTE_ADDRESS_MASK))
+            frame_free(entry & PTE_ADDRESS_MASK);
+    }
+
+    frame_free(virt_to_phys(table));
+
+    return;
+}
+
+void mmu_space_destroy(struct mmu_space *space)
+{
+    u64 *pml4 = (u64 *)phys_to_virt(space->root);
+    u64 entry = pml4[PML4_INDEX(USER_BASE)];
+
+    /* The user window is exactly one PML4 slot: the PDPT below it is private */
+    if (entry & PTE_PRESENT)
+        mmu_free_table((u64 *)phys_to_virt(entry & PTE_ADDRESS_MASK), 3);
+
+    frame_free(space->root);
+    space->root = 0;
+
+    return;
+}
+
+void mmu_space_switch(const struct mmu_space *space)
+{
+    uintptr_t root = space != NULL ? space->root : mmu_kernel_root;
+
+    if ((read_cr3() & PTE_ADDRESS_MASK) != root)
+        write_cr3(root);
+
+    return;
+}
+
+/* MMU_USER__ flags to page-table bits and back */
+static inline u64 mmu_user_pte(u32 flags)
+{
+    return ((flags & MMU_USER__WRITABLE) ? PTE_WRITABLE : 0) | ((flags & MMU_USER__OWNED) ? PTE_OWNED : 0) |
+           ((flags & MMU_USER__COW) ? PTE_COW : 0);
+}
+
+static inline u32 mmu_user_flags(u64 entry)
+{
+    return ((entry & PTE_WRITABLE) ? MMU_USER__WRITABLE : 0) | ((entry & PTE_OWNED) ? MMU_USER__OWNED : 0) |
+           ((entry & PTE_COW) ? MMU_USER__COW : 0);
+}
+
+/* Page-table entry for 'virt', creating the tables on the way when 'create' is set; call with mmu_lock held */
+static u64 *mmu_user_entry(uintptr_t root, uintptr_t virt, bool create)
+{
+    u64 *table = (u64 *)phys_to_virt(root);
+    u32 shift;
+
+    for (shift = 39; shift > PAGE_SHIFT; shift -= 9)
+    {
+        u64 *entry = &table[(virt >> shift) & 0x1FF];
+
+        if (!(*entry & PTE_PRESENT) && !create)
+            return NULL;
+
+        table = mmu_table(entry, PTE_USER);
+        if (table == NULL)
+            return NULL;
+    }
+
+    return &table[PT_INDEX(virt)];
+}
+
+int mmu_map_user(struct mmu_space *space, uintptr_t virt, uintptr_t phys, u32 flags)
+{
+    u64 *entry;
+
+    if (virt < USER_BASE || virt >= USER_END || (virt & PAGE_MASK) || (phys & PAGE_MASK))
+        return -1;
+
+    spin_lock(&mmu_lock);
+
+    entry = mmu_user_entry(space->root, virt, true);
+    if (entry != NULL)
+    {
+        *entry = phys | PTE_PRESENT | PTE_USER | mmu_user_pte(flags);
+        if ((read_cr3() & PTE_ADDRESS_MASK) == space->root)
+            invlpg(virt);
+    }
+
+    spin_unlock(&mmu_lock);
+
+    return entry != NULL ? 0 : -1;
+}
+
+uintptr_t mmu_translate_user(const struct mmu_space *space, uintptr_t virt, u32 *flags)
+{
+    uintptr_t phys = 0;
+    u64 *entry;
+
+    if (virt < USER_BASE || virt >= USER_END)
+        return 0;
+
+    spin_lock(&mmu_lock);
+
+    entry = mmu_user_entry(space->root, virt, false);
+    if (entry != NULL && (*entry & PTE_PRESENT))
+    {
+        phys = *entry & PTE_ADDRESS_MASK;
+        if (flags != NULL)
+            *flags = mmu_user_flags(*entry);
+    }
+
+    spin_unlock(&mmu_lock);
+
+    return phys;
+}
+
+uintptr_t mmu_unmap_user(struct mmu_space *space, uintptr_t virt, u32 *flags)
+{
+    uintptr_t phys = 0;
+    u64 *entry;
+
+    if (virt < USER_BASE || virt >= USER_END)
+        return 0;
+
+    spin_lock(&mmu_lock);
+
+    entry = mmu_user_entry(space->root, virt, false);
+    if (entry != NULL && (*entry & PTE_PRESENT))
+    {
+        phys = *entry & PTE_ADDRESS_MASK;
+        if (flags != NULL)
+            *flags = mmu_user_flags(*entry);
+        *entry = 0;
+        if ((read_cr3() & PTE_ADDRESS_MASK) == space->root)
+            invlpg(virt);
+    }
+
+    spin_unlock(&mmu_lock);
+
+    return phys;
+}
@@ -0,0 +1,50 @@
+#include <types.h>
+#include <arch/cpu.h>
+#include <arch/gdt.h>
+#include <arch/interrupt.h>
+#include <arch/syscall.h>
+
+#define MSR_EFER            0xC0000080
+#define MSR_STAR            0xC0000081
+#define MSR_LSTAR           0xC0000082
+#define MSR_SFMASK          0xC0000084
+#define MSR_KERNEL_GS_BASE  0xC0000102
+
+#define EFER__SCE           ((u64)1 << 0)
+
+/*
+ * Reached through GS between the two SWAPGS of syscall_entry, which
+ * repeats the offsets. SYSCALL leaves RSP on the user stack, so the user
+ * value is parked here while the kernel stack is loaded.
+ */
+struct syscall_cpu
+{
+    uintptr_t kernel_sp;
+    uintptr_t user_sp;
+} __attribute__ ((aligned(64)));
+
+extern u8 syscall_entry[];
+
+static struct syscall_cpu syscall_cpus[NR_CPUS];
+
+int syscall_init(void)
+{
+    wrmsr(MSR_KERNEL_GS_BASE, (uintptr_t)&syscall_cpus[cpu_index()]);
+
+    /* SYSCALL loads CS from STAR[47:32]; SYSRET takes its selectors from STAR[63:48] */
+    wrmsr(MSR_STAR, ((u64)GDT_USER_BASE << 48) | ((u64)GDT_KERNEL_CS << 32));
+    wrmsr(MSR_LSTAR, (uintptr_t)syscall_entry);
+
+    /* Interrupts stay masked until the entry code is off the user stack */
+    wrmsr(MSR_SFMASK, EFLAGS__IF | EFLAGS__DF | EFLAGS__TF);
+    wrmsr(MSR_EFER, rdmsr(MSR_EFER) | EFER__SCE);
+
+    return 0;
+}
+
+void syscall_set_kernel_stack(uintptr_t top)
+{
+    syscall_cpus[cpu_index()].kernel_sp = top;
+
+    return;
+}
@@ -0,0 +1,148 @@
+#include <types.h>
+#include <arch/arch.h>
+#include <arch/cpu.h>
+#include <bench/bcachebench.h>
+#include <block/bcache.h>
+#include <block/blkdev.h>
+#include <lib/printk.h>
+#include <lib/util.h>
+#include <time/tsc.h>
+
+#define BCACHEBENCH_REREAD_PASSES   4
+
+/* The working set is re-read once every this many scanned blocks */
+#define BCACHEBENCH_SCAN_STRIDE     16
+
+struct bcachebench
+{
+    struct blk_device *dev;
+    u64 errors;
+    u64 start;
+    struct bcache_stats before;
+};
+
+static struct bcachebench bcachebench;
+
+static void bcachebench_begin(struct bcachebench *bench)
+{
+    bcache_get_stats(&bench->before);
+    bench->errors = 0;
+    bench->start = rdtsc();
+
+    return;
+}
+
+static void bcachebench_end(struct bcachebench *bench, const char *phase)
+{
+    u64 elapsed_us = div_u64(tsc_cycles_to_ns(rdtsc() - bench->start), 1000);
+    struct bcache_stats after;
+
+    bcache_get_stats(&after);
+
+    printk("%s: hits=%llu misses=%llu ra_hits=%llu evictions=%llu writeback=%llu/%llu us=%llu",
+           phase, (unsigned long long)(after.hits - bench->before.hits),
+           (unsigned long long)(after.misses - bench->before.misses),
+           (unsigned long long)(after.readahead_hits - bench->before.readahead_hits),
+           (unsigned long long)(after.evictions - bench->before.evictions),
+           (unsigned long long)(after.writeback_blocks - bench->before.writeback_blocks),
+           (unsigned long long)(after.writeback_requests - bench->before.writeback_requests),
+           (unsigned long long)elapsed_us);
+    if (bench->errors)
+        printk(" errors=%llu", (unsigned long long)bench->errors);
+    printk("\n");
+
+    return;
+}
+
+static void bcachebench_read(struct bcachebench *bench, u64 block, bool dirty)
+{
+    struct bcache_buf *buf = bcache_read(bench->dev, block);
+
+    if (buf == NULL)
+    {
+        bench->errors++;
+        return;
+    }
+
+    /* Written back with the contents just read, so the disk is left as it was */
+    if (dirty)
+        bcache_mark_dirty(buf);
+    bcache_release(buf);
+
+    return;
+}
+
+static void bcachebench_range(struct bcachebench *bench, u64 start, u64 end, bool dirty)
+{
+    u64 block;
+
+    for (block = start; block < end; block++)
+        bcachebench_read(bench, block, dirty);
+
+    return;
+}
+
+int bcachebench_run(struct blk_device *dev)
+{
+    struct bcachebench *bench = &bcachebench;
+    struct bcache_stats stats;
+    u64 blocks;
+    u64 sequential;
+    u64 working;
+    u64 scan_end;
+    u64 block;
+    u64 hot = 0;
+    u32 pass;
+
+    bcache_get_stats(&stats);
+    if (dev == NULL || stats.capacity == 0)
+        return -1;
+
+    blocks = dev->sector_count >> (PAGE_SHIFT - BLK_SECTOR_SHIFT);
+    sequential = MIN((u64)stats.capacity / 2, blocks);
+    working = MIN((u64)stats.capacity / 8, blocks);
+    scan_end = MIN(sequential + 2 * (u64)stats.capacity, blocks);
+    if (working == 0)
+        return -1;
+
+    bench->dev = dev;
+
+    printk("bcachebench: %s, %zu cached blocks, working set %llu, scan to block %llu\n",
+           dev->name, stats.capacity, (unsigned long long)working, (unsigned long long)scan_end);
+
+    bcachebench_begin(bench);
+    bcachebench_range(bench, 0, sequential, false);
+    bcachebench_end(bench, "sequential");
+
+    bcachebench_begin(bench);
+    for (pass = 0; pass < BCACHEBENCH_REREAD_PASSES; pass++)
+        bcachebench_range(bench, 0, working, false);
+    bcachebench_end(bench, "reread");
+
+    bcachebench_begin(bench);
+    bcachebench_range(bench, 0, working, true);
+    if (bcache_sync(dev) != 0)
+        bench->errors++;
+    bcachebench_end(bench, "rewrite");
+
+    /* A one-time scan: it should only cycle through the cold pages */
+    bcachebench_begin(bench);
+    for (block = sequential; block < scan_end; block++)
+    {
+        bcachebench_read(bench, block, false);
+        if ((block - sequential) % BCACHEBENCH_SCAN_STRIDE == 0)
+        {
+            bcachebench_read(bench, hot, false);
+            hot = hot + 1 == working ? 0 : hot + 1;
+        }
+    }
+    bcachebench_end(bench, "scan");
+
+    bcachebench_begin(bench);
+    bcachebench_range(bench, 0, working, false);
+    bcachebench_end(bench, "after scan");
+
+    bcache_print_stats();
+
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include <types.h>
+#include <arch/arch.h>
+#include <arch/cpu.h>
+#include <bench/blkbench.h>
+#include <bench/histogram.h>
+#include <block/blkdev.h>
+#include <lib/printk.h>
+#include <lib/string.h>
+#include <lib/util.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+#include <time/tsc.h>
+
+#define BLKBENCH_BLOCK_SIZE     4096
+#define BLKBENCH_SECTOR_SHIFT   (PAGE_SHIFT - BLK_SECTOR_SHIFT)
+#define BLKBENCH_MAX_DEPTH      64
+#define BLKBENCH_OPS_PER_DEPTH  20000
+
+static const u16 blkbench_depths[] = { 1, 4, 16, 32, 64 };
+
+struct blkbench
+{
+    struct blk_device *dev;
+    u32 blocks;
+    u32 rng;
+    u64 completed;
+    u64 errors;
+    struct histogram latency;
+    struct blk_request requests[BLKBENCH_MAX_DEPTH];
+    struct blk_request *ready[BLKBENCH_MAX_DEPTH];
+    size_t ready_count;
+};
+
+static struct blkbench blkbench;
+
+static inline u32 blkbench_random(struct blkbench *bench)
+{
+    bench->rng ^= bench->rng << 13;
+    bench->rng ^= bench->rng >> 17;
+    bench->rng ^= bench->rng << 5;
+
+    return bench->rng;
+}
+
+static void blkbench_end_io(struct blk_request *req)
+{
+    struct blkbench *bench = req->private;
+
+    histogram_record(&bench->latency, tsc_cycles_to_ns(rdtsc() - req->submit_tsc));
+    if (req->status != BLK_STATUS__OK)
+        bench->errors++;
+    bench->completed++;
+    bench->ready[bench->ready_count++] = req;
+
+    return;
+}
+
+static void blkbench_print_us(const char *label, u64 ns)
+{
+    u32 fraction;
+    u64 us = div_u64_rem(ns, 1000, &fraction);
+
+    printk(" %s=%llu.%u", label, (unsigned long long)us, fraction / 100);
+
+    return;
+}
+
+static void blkbench_depth(struct blkbench *bench, u16 depth)
+{
+    u64 issued = 0;
+    u64 start;
+    u64 elapsed_us;
+    size_t index;
+
+    histogram_reset(&bench->latency);
+    bench->completed = 0;
+    bench->errors = 0;
+    bench->ready_count = depth;
+    for (index = 0; index < depth; index++)
+        bench->ready[index] = &bench->requests[index];
+
+    start = rdtsc();
+
+    while (bench->completed < BLKBENCH_OPS_PER_DEPTH)
+    {
+        size_t batch = MIN((u64)bench->ready_count, BLKBENCH_OPS_PER_DEPTH - issued);
+
+        /* Everything that completed since the last pass goes out behind one doorbell */
+        if (batch)
+        {
+            size_t submitted;
+            size_t base;
+
+            for (index = 0; index < batch; index++)
+                bench->ready[bench->ready_count - 1 - index]->sector =
+                    (u64)(blkbench_random(bench) % bench->blocks) << BLKBENCH_SECTOR_SHIFT;
+
+            /*
+             * The device may take only a prefix of the window: the rest
+             * moves down over the submitted ones and stays ready.
+             */
+            base = bench->ready_count - batch;
+            submitted = blk_submit_batch(bench->dev, &bench->ready[base], batch);
+            memmove(&bench->ready[base], &bench->ready[base + submitted],
+                    (bench->ready_count - base - submitted) * sizeof(bench->ready[0]));
+            bench->ready_count -= submitted;
+            issued += submitted;
+        }
+
+        if (blk_poll(bench->dev) == 0)
+            cpu_relax();
+    }
+
+    elapsed_us = div_u64(tsc_cycles_to_ns(rdtsc() - start), 1000);
+
+    printk("qd=%2u iops=%llu", depth,
+           (unsigned long long)div_u64(bench->completed * 1000000, (u32)MAX(elapsed_us, (u64)1)));
+    blkbench_print_us("p50", histogram_percentile(&bench->latency, 5000));
+    blkbench_print_us("p99", histogram_percentile(&bench->latency, 9900));
+    blkbench_print_us("p99.9", histogram_percentile(&bench->latency, 9990));
+    blkbench_print_us("max", bench->latency.max);
+    if (bench->errors)
+        printk(" errors=%llu", (unsigned long long)bench->errors);
+    printk("\n");
+
+    return;
+}
+
+int blkbench_run(struct blk_device *dev)
+{
+    struct blkbench *bench = &blkbench;
+    u16 max_depth;
+    size_t index;
+
+    if (dev == NULL || (dev->sector_count >> BLKBENCH_SECTOR_SHIFT) == 0)
+        return -1;
+
+    bench->dev = dev;
+    bench->rng = 0x9E3779B9U;
+    bench->blocks = (u32)MIN(dev->sector_count >> BLKBENCH_SECTOR_SHIFT, (u64)U32_MAX);
+
+    for (index = 0; index < BLKBENCH_MAX_DEPTH; index++)
+    {
+        struct blk_request *req = &bench->requests[index];
+        uintptr_t frame = frame_alloc();
+
+        if (frame == 0)
+            return -1;
+
+        req->op = BLK_OP__READ;
+        req->segment_count = 1;
+        req->segments[0].buf = phys_to_virt(frame);
+        req->segments[0].length = BLKBENCH_BLOCK_SIZE;
+        req->end_io = blkbench_end_io;
+        req->private = bench;
+    }
+
+    /* Deeper than the device holds would only measure requests waiting to be resubmitted */
+    max_depth = (u16)MAX(MIN(dev->queue_depth, (u16)BLKBENCH_MAX_DEPTH), (u16)1);
+
+    printk("blkbench: %s, 4KiB random read, %u ops per depth, up to qd=%u, latency in us\n",
+           dev->name, BLKBENCH_OPS_PER_DEPTH, max_depth);
+
+    for (index = 0; index < ARRAY_SIZE(blkbench_depths) && blkbench_depths[index] <= max_depth; index++)
+        blkbench_depth(bench, blkbench_depths[index]);
+    /* The device's own depth is the last point when it falls between the fixed ones; 1 always runs */
+    if (blkbench_depths[index - 1] != max_depth)
+        blkbench_depth(bench, max_depth);
+
+    for (index = 0; index < BLKBENCH_MAX_DEPTH; index++)
+        frame_free(virt_to_phys(bench->requests[index].segments[0].buf));
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <types.h>
+#include <bench/histogram.h>
+#include <lib/string.h>
+#include <lib/util.h>
+
+#define HISTOGRAM_SUB_COUNT (1U << HISTOGRAM_SUB_BITS)
+
+static inline u32 histogram_msb(u64 value)
+{
+    u32 high = (u32)(value >> 32);
+
+    return high ? 63 - (u32)__builtin_clz(high) : 31 - (u32)__builtin_clz((u32)value);
+}
+
+static inline u32 histogram_index(u64 value)
+{
+    u32 msb;
+
+    if (value < HISTOGRAM_SUB_COUNT)
+        return (u32)value;
+
+    msb = histogram_msb(value);
+
+    return ((msb - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS) +
+           ((u32)(value >> (msb - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_COUNT - 1));
+}
+
+/* Midpoint of the bucket's value range */
+static inline u64 histogram_value(u32 index)
+{
+    u32 group = index >> HISTOGRAM_SUB_BITS;
+    u32 shift;
+
+    if (group == 0)
+        return index;
+
+    shift = group - 1;
+
+    return ((u64)(HISTOGRAM_SUB_COUNT + (index & (HISTOGRAM_SUB_COUNT - 1))) << shift) + (((u64)1 << shift) >> 1);
+}
+
+void histogram_reset(struct histogram *histogram)
+{
+    memset(histogram, 0, sizeof(*histogram));
+
+    return;
+}
+
+void histogram_record(struct histogram *histogram, u64 value)
+{
+    if (histogram->count == 0 || value < histogram->min)
+        histogram->min = value;
+    if (value > histogram->max)
+        histogram->max = value;
+
+    histogram->buckets[histogram_index(value)]++;
+    histogram->count++;
+
+    return;
+}
+
+u64 histogram_percentile(const struct histogram *histogram, u32 permyriad)
+{
+    u64 rank;
+    u64 seen = 0;
+    u32 index;
+
+    if (histogram->count == 0)
+        return 0;
+
+    rank = div_u64(histogram->count * permyriad + 9999, 10000);
+
+    for (index = 0; index < HISTOGRAM_BUCKETS; index++)
+    {
+        seen += histogram->buckets[index];
+        if (seen >= rank)
+            return MIN(MAX(histogram_value(index), histogram->min), histogram->max);
+    }
+
+    return histogram->max;
+}
@@ -0,0 +1,52 @@
+#include <types.h>
+#include <bench/ipcbench.h>
+#include <lib/printk.h>
+#include <proc/ipc.h>
+#include <proc/process.h>
+
+int ipcbench_run(void)
+{
+    size_t size = (size_t)(user_image_end - user_image_start);
+    struct process *server = NULL;
+    struct process *client = NULL;
+    int port;
+    int status = -1;
+
+    printk("ipcbench: %u round trips, %u messages per bulk size\n", 1U << IPCBENCH_PING_SHIFT,
+           1U << IPCBENCH_BULK_SHIFT);
+
+    port = ipc_port_create();
+    if (port < 0)
+    {
+        printk("ipcbench: no free port\n");
+        return -1;
+    }
+
+    server = process_create(user_image_start, size, IPCBENCH__SERVER, (u32)port);
+    client = process_create(user_image_start, size, IPCBENCH__CLIENT, (u32)port);
+    if (server == NULL || client == NULL || ipc_port_bind((u32)port, server))
+    {
+        printk("ipcbench: cannot create processes\n");
+        goto out;
+    }
+
+    /* The server runs first and is waiting on the port by the time the client calls */
+    process_start(server);
+    status = process_run(client);
+
+    if (status != 0 || server->state != PROCESS_STATE__EXITED || server->exit_status != 0)
+    {
+        printk("ipcbench: client exited with status %d, server %s\n", status,
+               server->state == PROCESS_STATE__EXITED ? "exited" : "still waiting");
+        status = -1;
+    }
+
+out:
+    if (client != NULL)
+        process_destroy(client);
+    if (server != NULL)
+        process_destroy(server);
+    ipc_port_destroy((u32)port);
+
+    return status;
+}
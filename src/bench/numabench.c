@@ -0,0 +1,163 @@
+#include <types.h>
+#include <acpi/topology.h>
+#include <arch/arch.h>
+#include <arch/cpu.h>
+#include <bench/numabench.h>
+#include <lib/printk.h>
+#include <lib/string.h>
+#include <lib/util.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+#include <time/tsc.h>
+
+#define NUMABENCH_PAGES     2048    /* 8MiB, well past the last-level cache */
+#define NUMABENCH_PASSES    8
+
+enum numabench_placement
+{
+    NUMABENCH__LOCAL,
+    NUMABENCH__INTERLEAVED,
+    NUMABENCH__REMOTE,
+};
+
+static const char *const numabench_names[] = { "local", "interleaved", "remote" };
+
+static void *numabench_pages[NUMABENCH_PAGES];
+
+/* The node with memory farthest from 'node' by SLIT distance */
+static u32 numabench_farthest(u32 node)
+{
+    u32 farthest = node;
+    u32 other;
+
+    for (other = 0; other < frame_node_count(); other++)
+    {
+        struct frame_node_stats stats;
+
+        frame_node_stats(other, &stats);
+        if (stats.total_frames == 0)
+            continue;
+        if (acpi_topology.distance[node][other] > acpi_topology.distance[node][farthest])
+            farthest = other;
+    }
+
+    return farthest;
+}
+
+static u64 numabench_read(void)
+{
+    uintptr_t sum = 0;
+    size_t page;
+    size_t word;
+
+    for (page = 0; page < NUMABENCH_PAGES; page++)
+    {
+        const volatile uintptr_t *words = numabench_pages[page];
+
+        for (word = 0; word < PAGE_SIZE / sizeof(uintptr_t); word++)
+            sum += words[word];
+    }
+
+    return sum;
+}
+
+static void numabench_write(u8 value)
+{
+    size_t page;
+
+    for (page = 0; page < NUMABENCH_PAGES; page++)
+        memset(numabench_pages[page], value, PAGE_SIZE);
+
+    return;
+}
+
+static u64 numabench_mbps(u64 bytes, u64 cycles)
+{
+    u64 us = div_u64(tsc_cycles_to_ns(cycles), 1000);
+
+    /* Bytes per microsecond are MB/s */
+    return div_u64(bytes, (u32)MAX(us, (u64)1));
+}
+
+static int numabench_placement(enum numabench_placement placement, u32 local, u32 remote)
+{
+    u64 bytes = (u64)NUMABENCH_PAGES * PAGE_SIZE * NUMABENCH_PASSES;
+    u32 count = frame_node_count();
+    size_t on_target = 0;
+    size_t page;
+    u64 start;
+    u64 read_cycles;
+    u64 write_cycles;
+    int pass;
+
+    for (page = 0; page < NUMABENCH_PAGES; page++)
+    {
+        u32 target = placement == NUMABENCH__LOCAL ? local :
+                     placement == NUMABENCH__REMOTE ? remote : (u32)(page % count);
+        uintptr_t frame = frame_alloc_node(target, 1);
+
+        if (frame == 0)
+        {
+            while (page-- > 0)
+                frame_free(virt_to_phys(numabench_pages[page]));
+            return -1;
+        }
+
+        if (frame_node_of(frame) == target)
+            on_target++;
+        numabench_pages[page] = phys_to_virt(frame);
+    }
+
+    /* Touch everything once so the timed passes do not include first-access costs */
+    numabench_write(0);
+
+    start = rdtsc();
+    for (pass = 0; pass < NUMABENCH_PASSES; pass++)
+        numabench_write((u8)pass);
+    write_cycles = rdtsc() - start;
+
+    start = rdtsc();
+    for (pass = 0; pass < NUMABENCH_PASSES; pass++)
+        numabench_read();
+    read_cycles = rdtsc() - start;
+
+    printk("%12s read=%llu MB/s write=%llu MB/s (%zu/%u pages on target node)\n", numabench_names[placement],
+           (unsigned long long)numabench_mbps(bytes, read_cycles),
+           (unsigned long long)numabench_mbps(bytes, write_cycles), on_target, NUMABENCH_PAGES);
+
+    for (page = 0; page < NUMABENCH_PAGES; page++)
+        frame_free(virt_to_phys(numabench_pages[page]));
+
+    return 0;
+}
+
+int numabench_run(void)
+{
+    u32 local = frame_current_node();
+    u32 remote = numabench_farthest(local);
+    u32 node;
+
+    printk("numabench: cpu %u on node %u of %u, %u KiB buffer, %u passes\n", cpu_index(), local,
+           frame_node_count(), NUMABENCH_PAGES * (PAGE_SIZE / 1024), NUMABENCH_PASSES);
+
+    if (numabench_placement(NUMABENCH__LOCAL, local, remote))
+        return -1;
+
+    if (frame_node_count() > 1)
+    {
+        numabench_placement(NUMABENCH__INTERLEAVED, local, remote);
+        if (remote != local)
+            numabench_placement(NUMABENCH__REMOTE, local, remote);
+    }
+
+    for (node = 0; node < frame_node_count(); node++)
+    {
+        struct frame_node_stats stats;
+
+        frame_node_stats(node, &stats);
+        printk("node %u: %zu/%zu frames free, %zu local and %zu remote allocations\n", node,
+               stats.free_frames, stats.total_frames, stats.local_allocs, stats.remote_allocs);
+    }
+
+    return 0;
+}
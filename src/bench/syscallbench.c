@@ -0,0 +1,40 @@
+#include <types.h>
+#include <bench/syscallbench.h>
+#include <lib/printk.h>
+#include <proc/process.h>
+
+int syscallbench_run(void)
+{
+    u32 test;
+
+#ifdef __x86_64__
+    printk("syscallbench: SYSCALL/SYSRET, %u iterations per test\n", 1U << SYSCALLBENCH_SHIFT);
+#else
+    printk("syscallbench: SYSENTER/SYSEXIT, %u iterations per test\n", 1U << SYSCALLBENCH_SHIFT);
+#endif
+
+    /* A fresh process per test: each starts from the same cold address space */
+    for (test = 0; test < SYSCALLBENCH_TESTS; test++)
+    {
+        struct process *process = process_create(user_image_start, (size_t)(user_image_end - user_image_start),
+                                                 test, SYSCALLBENCH_SHIFT);
+        int status;
+
+        if (process == NULL)
+        {
+            printk("syscallbench: cannot create process\n");
+            return -1;
+        }
+
+        status = process_run(process);
+        process_destroy(process);
+
+        if (status != 0)
+        {
+            printk("syscallbench: test %u exited with status %d\n", test, status);
+            return -1;
+        }
+    }
+
+    return 0;
+}
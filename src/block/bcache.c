@@ -0,0 +1,1081 @@
+#include <types.h>
+#include <arch/arch.h>
+#include <arch/cpu.h>
+#include <block/bcache.h>
+#include <block/blkdev.h>
+#include <boot/init.h>
+#include <lib/printk.h>
+#include <lib/spinlock.h>
+#include <lib/string.h>
+#include <lib/util.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+
+#define BCACHE_MIN_FRAMES       64
+#define BCACHE_MAX_FRAMES       16384
+#define BCACHE_IO_SLOTS         64
+#define BCACHE_SECTOR_SHIFT     (PAGE_SHIFT - BLK_SECTOR_SHIFT)
+
+/* Read-ahead window in blocks: starts small, doubles on each sequential hit up to the max */
+#define BCACHE_RA_MIN_WINDOW    4
+#define BCACHE_RA_MAX_WINDOW    64
+
+/* Dirty blocks are written back once they exceed 1/BCACHE_DIRTY_RATIO of the cache */
+#define BCACHE_DIRTY_RATIO      4
+
+struct bcache_bucket
+{
+    spinlock_t lock;
+    struct bcache_buf *head;
+};
+
+/* One in-flight request covering up to BLK_MAX_SEGMENTS consecutive blocks */
+struct bcache_io
+{
+    struct blk_request req;
+    struct bcache_buf *bufs[BLK_MAX_SEGMENTS];
+    u16 count;
+    struct bcache_io *next_free;
+};
+
+/* Requests built by one operation, submitted together behind a single doorbell */
+struct bcache_batch
+{
+    struct blk_device *dev;
+    struct blk_request *reqs[BCACHE_IO_SLOTS];
+    size_t count;
+    size_t opened;  /* requests built, including those already submitted */
+    struct bcache_io *current;
+};
+
+/* Updated without bcache.lock on hits: a racing update costs or wastes at most one window */
+struct bcache_readahead
+{
+    struct blk_device *volatile dev;
+    volatile u64 next;      /* block expected if the stream stays sequential */
+    volatile u64 end;       /* first block not yet read ahead */
+    volatile u32 window;
+};
+
+/* Hit counters, bumped by each CPU in its own slot so that hits take no shared lock */
+struct bcache_cpu_stats
+{
+    u64 hits;
+    u64 readahead_hits;
+} __attribute__ ((aligned(64)));
+
+struct bcache
+{
+    size_t capacity;
+    size_t buf_count;
+    struct bcache_buf *bufs;
+    struct bcache_buf *free_bufs;
+    void **free_frames;
+    size_t free_frame_count;
+    struct bcache_bucket *buckets;
+    u32 bucket_shift;
+
+    /* CLOCK-Pro state, protected by 'lock' */
+    struct bcache_buf *hand_hot;
+    struct bcache_buf *hand_cold;
+    struct bcache_buf *hand_test;
+    size_t nr_hot;
+    size_t nr_cold;
+    size_t nr_test;
+    size_t cold_target;
+    spinlock_t lock;
+
+    /* Set by HAND_cold when it passes a dirty page; written back once 'lock' is dropped */
+    struct blk_device *writeback_dev;
+
+    volatile size_t nr_dirty;
+    /* Serialises write-back, which owns 'sort'; taken before 'lock', never while holding it */
+    spinlock_t writeback_lock;
+    struct bcache_buf **sort;
+
+    struct bcache_io ios[BCACHE_IO_SLOTS];
+    struct bcache_io *free_ios;
+    spinlock_t io_lock;
+
+    struct bcache_readahead readahead[BLK_MAX_DEVICES];
+    struct bcache_cpu_stats cpu_stats[NR_CPUS];
+    struct bcache_stats stats;
+};
+
+static struct bcache bcache;
+
+static inline void bcache_set(struct bcache_buf *buf, u32 flags)
+{
+    __atomic_fetch_or(&buf->flags, flags, __ATOMIC_RELEASE);
+}
+
+static inline void bcache_clear(struct bcache_buf *buf, u32 flags)
+{
+    __atomic_fetch_and(&buf->flags, ~flags, __ATOMIC_RELEASE);
+}
+
+static inline u32 bcache_flags(const struct bcache_buf *buf)
+{
+    return __atomic_load_n(&buf->flags, __ATOMIC_ACQUIRE);
+}
+
+static inline struct bcache_bucket *bcache_bucket(const struct blk_device *dev, u64 block)
+{
+    u64 key = block ^ ((u64)(uintptr_t)dev << 24);
+
+    return &bcache.buckets[(u32)((key * 0x9E3779B97F4A7C15ULL) >> (64 - bcache.bucket_shift))];
+}
+
+static struct bcache_buf *bcache_hash_find(struct bcache_bucket *bucket, const struct blk_device *dev, u64 block)
+{
+    struct bcache_buf *buf;
+
+    for (buf = bucket->head; buf != NULL; buf = buf->hash_next)
+        if (buf->dev == dev && buf->block == block)
+            return buf;
+
+    return NULL;
+}
+
+static void bcache_hash_unlink(struct bcache_bucket *bucket, struct bcache_buf *buf)
+{
+    struct bcache_buf **link;
+
+    for (link = &bucket->head; *link != buf; link = &(*link)->hash_next)
+        ;
+    *link = buf->hash_next;
+    buf->hash_next = NULL;
+
+    return;
+}
+
+/* The list head is just behind hand_hot: the position every hand reaches last */
+static void bcache_clock_insert(struct bcache_buf *buf)
+{
+    struct bcache_buf *head = bcache.hand_hot;
+
+    if (head == NULL)
+    {
+        buf->clock_next = buf;
+        buf->clock_prev = buf;
+        bcache.hand_hot = buf;
+        bcache.hand_cold = buf;
+        bcache.hand_test = buf;
+        return;
+    }
+
+    buf->clock_next = head;
+    buf->clock_prev = head->clock_prev;
+    head->clock_prev->clock_next = buf;
+    head->clock_prev = buf;
+
+    return;
+}
+
+static void bcache_clock_unlink(struct bcache_buf *buf)
+{
+    struct bcache_buf *next = buf->clock_next == buf ? NULL : buf->clock_next;
+
+    if (bcache.hand_hot == buf)
+        bcache.hand_hot = next;
+    if (bcache.hand_cold == buf)
+        bcache.hand_cold = next;
+    if (bcache.hand_test == buf)
+        bcache.hand_test = next;
+
+    buf->clock_prev->clock_next = buf->clock_next;
+    buf->clock_next->clock_prev = buf->clock_prev;
+    buf->clock_next = NULL;
+    buf->clock_prev = NULL;
+
+    return;
+}
+
+static void bcache_clock_move_to_head(struct bcache_buf *buf)
+{
+    bcache_clock_unlink(buf);
+    bcache_clock_insert(buf);
+
+    return;
+}
+
+/* Drops a non-resident test entry entirely */
+static void bcache_forget(struct bcache_buf *buf)
+{
+    struct bcache_bucket *bucket = bcache_bucket(buf->dev, buf->block);
+
+    spin_lock(&bucket->lock);
+    bcache_hash_unlink(bucket, buf);
+    spin_unlock(&bucket->lock);
+
+    bcache_clock_unlink(buf);
+    bcache.nr_test--;
+
+    buf->flags = 0;
+    buf->dev = NULL;
+    buf->hash_next = bcache.free_bufs;
+    bcache.free_bufs = buf;
+
+    return;
+}
+
+static inline void bcache_shrink_cold_target(void)
+{
+    if (bcache.cold_target > 1)
+        bcache.cold_target--;
+
+    return;
+}
+
+/*
+ * HAND_hot demotes the first unreferenced hot page it meets. Cold pages
+ * it passes have outlived their test period without a re-reference, so
+ * their test period ends and the cold allocation shrinks.
+ */
+static void bcache_run_hand_hot(void)
+{
+    size_t steps = 2 * bcache.buf_count;
+
+    while (bcache.nr_hot > 0 && bcache.hand_hot != NULL && steps--)
+    {
+        struct bcache_buf *buf = bcache.hand_hot;
+        u32 flags = bcache_flags(buf);
+
+        bcache.hand_hot = buf->clock_next;
+
+        if (flags & BCACHE_F__HOT)
+        {
+            if (flags & BCACHE_F__REFERENCED)
+            {
+                bcache_clear(buf, BCACHE_F__REFERENCED);
+                continue;
+            }
+
+            bcache_clear(buf, BCACHE_F__HOT);
+            bcache.nr_hot--;
+            bcache.nr_cold++;
+            return;
+        }
+
+        if (flags & BCACHE_F__TEST)
+        {
+            bcache_shrink_cold_target();
+            if (flags & BCACHE_F__RESIDENT)
+                bcache_clear(buf, BCACHE_F__TEST);
+            else
+                bcache_forget(buf);
+        }
+    }
+
+    return;
+}
+
+/* HAND_test bounds the non-resident history by reclaiming the oldest test entry */
+static void bcache_run_hand_test(void)
+{
+    size_t steps = 2 * bcache.buf_count;
+
+    while (bcache.nr_test > 0 && bcache.hand_test != NULL && steps--)
+    {
+        struct bcache_buf *buf = bcache.hand_test;
+        u32 flags = bcache_flags(buf);
+
+        bcache.hand_test = buf->clock_next;
+
+        if ((flags & BCACHE_F__HOT) || !(flags & BCACHE_F__TEST))
+            continue;
+
+        bcache_shrink_cold_target();
+        if (flags & BCACHE_F__RESIDENT)
+        {
+            bcache_clear(buf, BCACHE_F__TEST);
+        }
+        else
+        {
+            bcache_forget(buf);
+            return;
+        }
+    }
+
+    return;
+}
+
+static void bcache_balance_hot(void)
+{
+    size_t guard = bcache.capacity;
+
+    while (bcache.nr_hot > bcache.capacity - bcache.cold_target && guard--)
+        bcache_run_hand_hot();
+
+    return;
+}
+
+/*
+ * HAND_cold frees one resident cold page. A referenced cold page in its
+ * test period is promoted to hot; otherwise a reference buys it a new
+ * test period. An unreferenced page is evicted and, if still in its test
+ * period, stays behind as a non-resident test entry. Dirty pages are
+ * passed over and their device noted for bcache_take_writeback().
+ */
+static void *bcache_run_hand_cold(void)
+{
+    size_t steps = 4 * bcache.buf_count;
+
+    while (bcache.hand_cold != NULL && steps--)
+    {
+        struct bcache_buf *buf = bcache.hand_cold;
+        struct bcache_bucket *bucket;
+        u32 flags = bcache_flags(buf);
+        void *data;
+
+        if (!(flags & BCACHE_F__RESIDENT) || (flags & BCACHE_F__HOT) ||
+            (flags & BCACHE_F__IO) || buf->refcount)
+        {
+            bcache.hand_cold = buf->clock_next;
+            continue;
+        }
+
+        if (flags & BCACHE_F__REFERENCED)
+        {
+            bcache_clear(buf, BCACHE_F__REFERENCED);
+            bcache.hand_cold = buf->clock_next;
+            if (flags & BCACHE_F__TEST)
+            {
+                bcache_clear(buf, BCACHE_F__TEST);
+                bcache_set(buf, BCACHE_F__HOT);
+                bcache.nr_cold--;
+                bcache.nr_hot++;
+                bcache_clock_move_to_head(buf);
+                bcache_balance_hot();
+            }
+            else
+            {
+                bcache_set(buf, BCACHE_F__TEST);
+                bcache_clock_move_to_head(buf);
+            }
+            continue;
+        }
+
+        if (flags & BCACHE_F__DIRTY)
+        {
+            /* The I/O must not run under the lock every miss takes */
+            bcache.writeback_dev = buf->dev;
+            bcache.hand_cold = buf->clock_next;
+            continue;
+        }
+
+        bucket = bcache_bucket(buf->dev, buf->block);
+        spin_lock(&bucket->lock);
+        if (buf->refcount)
+        {
+            spin_unlock(&bucket->lock);
+            bcache.hand_cold = buf->clock_next;
+            continue;
+        }
+
+        data = buf->data;
+        buf->data = NULL;
+        if (flags & BCACHE_F__READAHEAD)
+            bcache.stats.readahead_wasted++;
+        bcache_clear(buf, BCACHE_F__RESIDENT | BCACHE_F__VALID | BCACHE_F__READAHEAD | BCACHE_F__ERROR);
+        bcache.hand_cold = buf->clock_next;
+        bcache.nr_cold--;
+        bcache.stats.evictions++;
+
+        if (flags & BCACHE_F__TEST)
+        {
+            spin_unlock(&bucket->lock);
+            bcache.nr_test++;
+            if (bcache.nr_test > bcache.capacity)
+                bcache_run_hand_test();
+        }
+        else
+        {
+            bcache_hash_unlink(bucket, buf);
+            spin_unlock(&bucket->lock);
+            bcache_clock_unlink(buf);
+            buf->flags = 0;
+            buf->dev = NULL;
+            buf->hash_next = bcache.free_bufs;
+            bcache.free_bufs = buf;
+        }
+
+        return data;
+    }
+
+    return NULL;
+}
+
+/*
+ * Makes (dev, block) resident with 'flags' added, without taking a
+ * reference. '*created' tells whether the caller now owns filling it.
+ * A read-ahead block is not an access, so it never promotes a test entry.
+ * Called with bcache.lock held.
+ */
+static struct bcache_buf *bcache_insert(struct blk_device *dev, u64 block, u32 flags, bool *created)
+{
+    struct bcache_bucket *bucket = bcache_bucket(dev, block);
+    struct bcache_buf *buf;
+    void *data;
+
+    *created = false;
+
+    spin_lock(&bucket->lock);
+    buf = bcache_hash_find(bucket, dev, block);
+    spin_unlock(&bucket->lock);
+    if (buf != NULL && (bcache_flags(buf) & BCACHE_F__RESIDENT))
+        return buf;
+
+    if (bcache.free_frame_count)
+        data = bcache.free_frames[--bcache.free_frame_count];
+    else
+        data = bcache_run_hand_cold();
+    if (data == NULL)
+        return NULL;
+
+    /* Eviction may have dropped the test entry found above; look again */
+    spin_lock(&bucket->lock);
+    buf = bcache_hash_find(bucket, dev, block);
+    if (buf != NULL && (flags & BCACHE_F__READAHEAD))
+    {
+        /* Nobody asked for it yet: resident again, but cold and still on test */
+        buf->data = data;
+        bcache_set(buf, BCACHE_F__RESIDENT | flags);
+        spin_unlock(&bucket->lock);
+
+        bcache.nr_test--;
+        bcache.nr_cold++;
+        bcache_clock_move_to_head(buf);
+    }
+    else if (buf != NULL)
+    {
+        /* Re-accessed during its test period: its reuse distance beats the cold pages' */
+        buf->data = data;
+        bcache_set(buf, BCACHE_F__RESIDENT | BCACHE_F__HOT | flags);
+        bcache_clear(buf, BCACHE_F__TEST);
+        spin_unlock(&bucket->lock);
+
+        bcache.stats.test_hits++;
+        bcache.nr_test--;
+        bcache.nr_hot++;
+        bcache.cold_target = MIN(bcache.cold_target + 1, bcache.capacity - 1);
+        bcache_clock_move_to_head(buf);
+        bcache_balance_hot();
+    }
+    else
+    {
+        spin_unlock(&bucket->lock);
+
+        if (bcache.free_bufs == NULL)
+            bcache_run_hand_test();
+        buf = bcache.free_bufs;
+        bcache.free_bufs = buf->hash_next;
+
+        buf->dev = dev;
+        buf->block = block;
+        buf->data = data;
+        buf->refcount = 0;
+        buf->flags = BCACHE_F__RESIDENT | BCACHE_F__TEST | flags;
+
+        spin_lock(&bucket->lock);
+        buf->hash_next = bucket->head;
+        bucket->head = buf;
+        spin_unlock(&bucket->lock);
+
+        bcache.nr_cold++;
+        bcache_clock_insert(buf);
+    }
+
+    *created = true;
+
+    return buf;
+}
+
+static void bcache_end_io(struct blk_request *req)
+{
+    struct bcache_io *io = req->private;
+    u16 index;
+
+    for (index = 0; index < io->count; index++)
+    {
+        struct bcache_buf *buf = io->bufs[index];
+
+        if (req->status != BLK_STATUS__OK)
+        {
+            bcache_set(buf, BCACHE_F__ERROR);
+            if (req->op == BLK_OP__WRITE)
+            {
+                bcache_set(buf, BCACHE_F__DIRTY);
+                __atomic_fetch_add(&bcache.nr_dirty, 1, __ATOMIC_RELAXED);
+            }
+        }
+        else if (req->op == BLK_OP__READ)
+        {
+            bcache_set(buf, BCACHE_F__VALID);
+        }
+
+        bcache_clear(buf, BCACHE_F__IO);
+    }
+
+    spin_lock(&bcache.io_lock);
+    io->next_free = bcache.free_ios;
+    bcache.free_ios = io;
+    spin_unlock(&bcache.io_lock);
+
+    return;
+}
+
+static void bcache_batch_submit(struct bcache_batch *batch)
+{
+    size_t submitted = 0;
+
+    while (submitted < batch->count)
+    {
+        submitted += blk_submit_batch(batch->dev, &batch->reqs[submitted], batch->count - submitted);
+        if (submitted < batch->count)
+            blk_poll(batch->dev);
+    }
+
+    batch->count = 0;
+    batch->current = NULL;
+
+    return;
+}
+
+static struct bcache_io *bcache_io_get(struct bcache_batch *batch)
+{
+    struct bcache_io *io;
+
+    for (;;)
+    {
+        spin_lock(&bcache.io_lock);
+        io = bcache.free_ios;
+        if (io != NULL)
+            bcache.free_ios = io->next_free;
+        spin_unlock(&bcache.io_lock);
+
+        if (io != NULL)
+            return io;
+
+        /* Every slot is in flight or staged: send the staged ones and reap */
+        bcache_batch_submit(batch);
+        if (blk_poll(batch->dev) == 0)
+            cpu_relax();
+    }
+}
+
+/* Appends the block to the open request when contiguous, otherwise opens a new one */
+static void bcache_batch_add(struct bcache_batch *batch, struct bcache_buf *buf, enum blk_op op)
+{
+    struct bcache_io *io = batch->current;
+
+    if (io == NULL || io->req.op != op || io->count == BLK_MAX_SEGMENTS ||
+        io->bufs[io->count - 1]->block + 1 != buf->block)
+    {
+        io = bcache_io_get(batch);
+        io->count = 0;
+        io->req.op = op;
+        io->req.sector = buf->block << BCACHE_SECTOR_SHIFT;
+        io->req.segment_count = 0;
+        io->req.end_io = bcache_end_io;
+        io->req.private = io;
+        batch->reqs[batch->count++] = &io->req;
+        batch->opened++;
+        batch->current = io;
+    }
+
+    io->bufs[io->count] = buf;
+    io->req.segments[io->count].buf = buf->data;
+    io->req.segments[io->count].length = BCACHE_BLOCK_SIZE;
+    io->count++;
+    io->req.segment_count = io->count;
+
+    return;
+}
+
+static void bcache_wait(struct bcache_buf *buf)
+{
+    while (bcache_flags(buf) & BCACHE_F__IO)
+        if (blk_poll(buf->dev) == 0)
+            cpu_relax();
+
+    return;
+}
+
+static void bcache_sort(struct bcache_buf **bufs, size_t count)
+{
+    size_t start;
+    size_t end;
+
+    /* Heapsort by block number: in place and bounded, no allocation */
+    for (start = count / 2; start-- > 0;)
+    {
+        size_t root = start;
+        size_t child;
+
+        while ((child = 2 * root + 1) < count)
+        {
+            struct bcache_buf *tmp;
+
+            if (child + 1 < count && bufs[child + 1]->block > bufs[child]->block)
+                child++;
+            if (bufs[root]->block >= bufs[child]->block)
+                break;
+            tmp = bufs[root];
+            bufs[root] = bufs[child];
+            bufs[child] = tmp;
+            root = child;
+        }
+    }
+
+    for (end = count; end-- > 1;)
+    {
+        struct bcache_buf *tmp = bufs[0];
+        size_t root = 0;
+        size_t child;
+
+        bufs[0] = bufs[end];
+        bufs[end] = tmp;
+
+        while ((child = 2 * root + 1) < end)
+        {
+            if (child + 1 < end && bufs[child + 1]->block > bufs[child]->block)
+                child++;
+            if (bufs[root]->block >= bufs[child]->block)
+                break;
+            tmp = bufs[root];
+            bufs[root] = bufs[child];
+            bufs[child] = tmp;
+            root = child;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Sorts the device's dirty blocks so neighbours merge into multi-segment
+ * writes. They are picked and marked under bcache.lock, which is dropped
+ * for the I/O: marked blocks are in I/O, so HAND_cold leaves them alone.
+ */
+static int bcache_writeback(struct blk_device *dev)
+{
+    struct bcache_batch batch;
+    size_t count = 0;
+    size_t index;
+    int result = 0;
+
+    spin_lock(&bcache.writeback_lock);
+    spin_lock(&bcache.lock);
+
+    for (index = 0; index < bcache.buf_count; index++)
+    {
+        struct bcache_buf *buf = &bcache.bufs[index];
+        u32 flags = bcache_flags(buf);
+
+        if (buf->dev == dev && (flags & BCACHE_F__RESIDENT) && (flags & BCACHE_F__DIRTY) &&
+            !(flags & BCACHE_F__IO))
+            bcache.sort[count++] = buf;
+    }
+
+    for (index = 0; index < count; index++)
+    {
+        bcache_clear(bcache.sort[index], BCACHE_F__DIRTY | BCACHE_F__ERROR);
+        bcache_set(bcache.sort[index], BCACHE_F__IO);
+        __atomic_fetch_sub(&bcache.nr_dirty, 1, __ATOMIC_RELAXED);
+    }
+
+    spin_unlock(&bcache.lock);
+
+    if (count == 0)
+    {
+        spin_unlock(&bcache.writeback_lock);
+        return 0;
+    }
+
+    bcache_sort(bcache.sort, count);
+
+    batch.dev = dev;
+    batch.count = 0;
+    batch.opened = 0;
+    batch.current = NULL;
+
+    for (index = 0; index < count; index++)
+        bcache_batch_add(&batch, bcache.sort[index], BLK_OP__WRITE);
+    bcache_batch_submit(&batch);
+
+    for (index = 0; index < count; index++)
+    {
+        bcache_wait(bcache.sort[index]);
+        if (bcache_flags(bcache.sort[index]) & BCACHE_F__ERROR)
+            result = -1;
+    }
+
+    spin_lock(&bcache.lock);
+    bcache.stats.writeback_blocks += count;
+    bcache.stats.writeback_requests += batch.opened;
+    spin_unlock(&bcache.lock);
+
+    spin_unlock(&bcache.writeback_lock);
+
+    return result;
+}
+
+/* Called with bcache.lock held; the caller writes the device back after dropping it */
+static struct blk_device *bcache_take_writeback(void)
+{
+    struct blk_device *dev = bcache.writeback_dev;
+
+    bcache.writeback_dev = NULL;
+
+    return dev;
+}
+
+static struct bcache_readahead *bcache_readahead_state(struct blk_device *dev)
+{
+    size_t index;
+
+    for (index = 0; index < BLK_MAX_DEVICES; index++)
+    {
+        struct bcache_readahead *ra = &bcache.readahead[index];
+        struct blk_device *owner = ra->dev;
+
+        /* Claimed without bcache.lock, so two devices never share a slot */
+        if (owner == NULL && __atomic_compare_exchange_n(&ra->dev, &owner, dev, false,
+                                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            return ra;
+        if (owner == dev)
+            return ra;
+    }
+
+    return &bcache.readahead[0];
+}
+
+/*
+ * Sequential streams get an asynchronous window ahead of the reader that
+ * doubles each time the reader gets within half a window of its end;
+ * any non-sequential access collapses it back to the minimum. This part
+ * only follows the stream, without bcache.lock, and tells whether the
+ * window is due to move.
+ */
+static bool bcache_readahead_due(struct bcache_readahead *ra, u64 block)
+{
+    if (block != ra->next || ra->window == 0)
+    {
+        ra->window = BCACHE_RA_MIN_WINDOW;
+        ra->end = block + 1;
+        ra->next = block + 1;
+        return false;
+    }
+
+    ra->next = block + 1;
+
+    return block + ra->window / 2 >= ra->end;
+}
+
+/* Moves the window; called with bcache.lock held */
+static void bcache_readahead(struct bcache_batch *batch, struct bcache_readahead *ra, struct blk_device *dev,
+                             u64 block)
+{
+    u64 device_blocks = dev->sector_count >> BCACHE_SECTOR_SHIFT;
+    u64 start;
+    u64 end;
+
+    start = MAX(ra->end, block + 1);
+    end = MIN(block + 1 + ra->window, device_blocks);
+    ra->window = MIN(ra->window * 2, (u32)BCACHE_RA_MAX_WINDOW);
+
+    for (; start < end; start++)
+    {
+        bool created;
+        struct bcache_buf *buf = bcache_insert(dev, start, BCACHE_F__IO | BCACHE_F__READAHEAD, &created);
+
+        if (buf == NULL)
+            break;
+        if (created)
+        {
+            bcache_batch_add(batch, buf, BLK_OP__READ);
+            bcache.stats.readahead_blocks++;
+        }
+    }
+    ra->end = MAX(start, ra->end);
+
+    return;
+}
+
+/*
+ * Hit path: only the bucket lock is taken. The first demand access of a
+ * read-ahead block is no re-reference, so it clears READAHEAD rather than
+ * setting REFERENCED, and '*readahead' tells the caller.
+ */
+static struct bcache_buf *bcache_lookup(struct blk_device *dev, u64 block, bool *readahead)
+{
+    struct bcache_bucket *bucket = bcache_bucket(dev, block);
+    struct bcache_buf *buf;
+
+    *readahead = false;
+
+    spin_lock(&bucket->lock);
+    buf = bcache_hash_find(bucket, dev, block);
+    if (buf != NULL && (bcache_flags(buf) & BCACHE_F__RESIDENT))
+    {
+        buf->refcount++;
+        if (bcache_flags(buf) & BCACHE_F__READAHEAD)
+        {
+            bcache_clear(buf, BCACHE_F__READAHEAD | BCACHE_F__REFERENCED);
+            *readahead = true;
+        }
+        else
+        {
+            bcache_set(buf, BCACHE_F__REFERENCED);
+        }
+    }
+    else
+    {
+        buf = NULL;
+    }
+    spin_unlock(&bucket->lock);
+
+    return buf;
+}
+
+static inline void bcache_hold(struct bcache_buf *buf)
+{
+    struct bcache_bucket *bucket = bcache_bucket(buf->dev, buf->block);
+
+    spin_lock(&bucket->lock);
+    buf->refcount++;
+    spin_unlock(&bucket->lock);
+
+    return;
+}
+
+/* bcache.lock is taken only to insert: on a miss, or when a hit moves the read-ahead window */
+static struct bcache_buf *bcache_access(struct blk_device *dev, u64 block, bool read)
+{
+    struct bcache_readahead *ra;
+    struct blk_device *writeback = NULL;
+    struct bcache_batch batch;
+    struct bcache_buf *buf;
+    bool readahead_hit;
+    bool created = false;
+
+    if (bcache.capacity == 0 || block >= dev->sector_count >> BCACHE_SECTOR_SHIFT)
+        return NULL;
+
+    batch.dev = dev;
+    batch.count = 0;
+    batch.opened = 0;
+    batch.current = NULL;
+
+    ra = bcache_readahead_state(dev);
+    buf = bcache_lookup(dev, block, &readahead_hit);
+
+    if (buf != NULL)
+    {
+        struct bcache_cpu_stats *cpu_stats = &bcache.cpu_stats[cpu_index()];
+
+        cpu_stats->hits++;
+        if (readahead_hit)
+            cpu_stats->readahead_hits++;
+
+        if (read && bcache_readahead_due(ra, block))
+        {
+            spin_lock(&bcache.lock);
+            bcache_readahead(&batch, ra, dev, block);
+            writeback = bcache_take_writeback();
+            spin_unlock(&bcache.lock);
+        }
+    }
+    else
+    {
+        spin_lock(&bcache.lock);
+        bcache.stats.misses++;
+        buf = bcache_insert(dev, block, read ? BCACHE_F__IO : 0, &created);
+        if (buf == NULL && (writeback = bcache_take_writeback()) != NULL)
+        {
+            /* Every evictable page was dirty: write them back unlocked and try once more */
+            spin_unlock(&bcache.lock);
+            bcache_writeback(writeback);
+            writeback = NULL;
+            spin_lock(&bcache.lock);
+            buf = bcache_insert(dev, block, read ? BCACHE_F__IO : 0, &created);
+        }
+        if (buf == NULL)
+        {
+            spin_unlock(&bcache.lock);
+            return NULL;
+        }
+        bcache_hold(buf);
+        if (created && read)
+            bcache_batch_add(&batch, buf, BLK_OP__READ);
+        if (read && bcache_readahead_due(ra, block))
+            bcache_readahead(&batch, ra, dev, block);
+        writeback = bcache_take_writeback();
+        spin_unlock(&bcache.lock);
+    }
+
+    bcache_batch_submit(&batch);
+    if (writeback != NULL)
+        bcache_writeback(writeback);
+
+    if (read)
+    {
+        bcache_wait(buf);
+        if (bcache_flags(buf) & BCACHE_F__ERROR)
+        {
+            bcache_release(buf);
+            return NULL;
+        }
+    }
+
+    return buf;
+}
+
+struct bcache_buf *bcache_read(struct blk_device *dev, u64 block)
+{
+    return bcache_access(dev, block, true);
+}
+
+struct bcache_buf *bcache_get(struct blk_device *dev, u64 block)
+{
+    return bcache_access(dev, block, false);
+}
+
+void bcache_mark_dirty(struct bcache_buf *buf)
+{
+    if (bcache_flags(buf) & BCACHE_F__DIRTY)
+        return;
+
+    bcache_set(buf, BCACHE_F__DIRTY | BCACHE_F__VALID);
+
+    if (__atomic_add_fetch(&bcache.nr_dirty, 1, __ATOMIC_RELAXED) * BCACHE_DIRTY_RATIO > bcache.capacity)
+        bcache_sync(buf->dev);
+
+    return;
+}
+
+void bcache_release(struct bcache_buf *buf)
+{
+    struct bcache_bucket *bucket = bcache_bucket(buf->dev, buf->block);
+
+    spin_lock(&bucket->lock);
+    buf->refcount--;
+    spin_unlock(&bucket->lock);
+
+    return;
+}
+
+int bcache_sync(struct blk_device *dev)
+{
+    return bcache_writeback(dev);
+}
+
+static void *__init bcache_alloc_table(size_t size)
+{
+    size_t frames = ALIGN_UP(size, PAGE_SIZE) / PAGE_SIZE;
+    uintptr_t table = frame_alloc_contig(frames);
+
+    if (table == 0)
+        return NULL;
+
+    memset(phys_to_virt(table), 0, frames * PAGE_SIZE);
+
+    return phys_to_virt(table);
+}
+
+int __init bcache_init(size_t frames)
+{
+    size_t index;
+
+    if (frames == 0)
+        frames = frame_free_count() / 8;
+    frames = MIN(MAX(frames, (size_t)BCACHE_MIN_FRAMES), (size_t)BCACHE_MAX_FRAMES);
+
+    /* Room for every resident page plus as many non-resident test entries */
+    bcache.buf_count = 2 * frames + 1;
+    for (bcache.bucket_shift = 1; ((size_t)1 << bcache.bucket_shift) < frames; bcache.bucket_shift++)
+        ;
+
+    bcache.bufs = bcache_alloc_table(bcache.buf_count * sizeof(struct bcache_buf));
+    bcache.buckets = bcache_alloc_table(((size_t)1 << bcache.bucket_shift) * sizeof(struct bcache_bucket));
+    bcache.free_frames = bcache_alloc_table(frames * sizeof(void *));
+    bcache.sort = bcache_alloc_table(frames * sizeof(struct bcache_buf *));
+    if (bcache.bufs == NULL || bcache.buckets == NULL || bcache.free_frames == NULL || bcache.sort == NULL)
+        return -1;
+
+    for (index = 0; index < bcache.buf_count; index++)
+    {
+        bcache.bufs[index].hash_next = bcache.free_bufs;
+        bcache.free_bufs = &bcache.bufs[index];
+    }
+
+    for (bcache.free_frame_count = 0; bcache.free_frame_count < frames; bcache.free_frame_count++)
+    {
+        uintptr_t frame = frame_alloc();
+
+        if (frame == 0)
+            break;
+        bcache.free_frames[bcache.free_frame_count] = phys_to_virt(frame);
+    }
+    if (bcache.free_frame_count < BCACHE_MIN_FRAMES)
+        return -1;
+
+    for (index = 0; index < BCACHE_IO_SLOTS; index++)
+    {
+        bcache.ios[index].next_free = bcache.free_ios;
+        bcache.free_ios = &bcache.ios[index];
+    }
+
+    spin_lock_init(&bcache.lock);
+    spin_lock_init(&bcache.writeback_lock);
+    spin_lock_init(&bcache.io_lock);
+    bcache.capacity = bcache.free_frame_count;
+    bcache.cold_target = MAX(bcache.capacity / 8, (size_t)1);
+
+    printk("bcache: %zu blocks of %u bytes\n", bcache.capacity, BCACHE_BLOCK_SIZE);
+
+    return 0;
+}
+
+void bcache_get_stats(struct bcache_stats *stats)
+{
+    u32 cpu;
+
+    spin_lock(&bcache.lock);
+    *stats = bcache.stats;
+    for (cpu = 0; cpu < NR_CPUS; cpu++)
+    {
+        stats->hits += bcache.cpu_stats[cpu].hits;
+        stats->readahead_hits += bcache.cpu_stats[cpu].readahead_hits;
+    }
+    stats->capacity = bcache.capacity;
+    stats->hot = bcache.nr_hot;
+    stats->cold = bcache.nr_cold;
+    stats->test = bcache.nr_test;
+    stats->dirty = bcache.nr_dirty;
+    stats->cold_target = bcache.cold_target;
+    spin_unlock(&bcache.lock);
+
+    return;
+}
+
+void bcache_print_stats(void)
+{
+    struct bcache_stats stats;
+
+    bcache_get_stats(&stats);
+
+    printk("bcache: hits=%llu misses=%llu test_hits=%llu evictions=%llu\n",
+           (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+           (unsigned long long)stats.test_hits, (unsigned long long)stats.evictions);
+    printk("bcache: readahead blocks=%llu hits=%llu wasted=%llu\n",
+           (unsigned long long)stats.readahead_blocks, (unsigned long long)stats.readahead_hits,
+           (unsigned long long)stats.readahead_wasted);
+    printk("bcache: writeback blocks=%llu requests=%llu\n",
+           (unsigned long long)stats.writeback_blocks, (unsigned long long)stats.writeback_requests);
+    printk("bcache: hot=%zu cold=%zu/%zu test=%zu dirty=%zu of %zu\n",
+           stats.hot, stats.cold, stats.cold_target, stats.test, stats.dirty, stats.capacity);
+
+    return;
+}
@@ -0,0 +1,108 @@
+#include <types.h>
+#include <arch/cpu.h>
+#include <block/blkdev.h>
+#include <lib/printk.h>
+#include <lib/util.h>
+#include <trace/trace.h>
+
+static struct blk_device *blk_devices[BLK_MAX_DEVICES];
+static size_t blk_devices_count;
+
+int blk_register(struct blk_device *dev)
+{
+    if (blk_devices_count == BLK_MAX_DEVICES)
+        return -1;
+
+    blk_devices[blk_devices_count++] = dev;
+
+    printk("blk: %s: %llu sectors, %u queue(s) x %u\n", dev->name,
+           (unsigned long long)dev->sector_count, dev->queue_count, dev->queue_depth);
+
+    return 0;
+}
+
+size_t blk_device_count(void)
+{
+    return blk_devices_count;
+}
+
+struct blk_device *blk_get(size_t index)
+{
+    return index < blk_devices_count ? blk_devices[index] : NULL;
+}
+
+int blk_submit(struct blk_device *dev, struct blk_request *req)
+{
+    int result;
+
+    req->submit_tsc = rdtsc();
+    result = dev->ops->submit(dev, req);
+    if (result == 0)
+        trace_point(TRACE_EVENT__BLOCK_SUBMIT, req->sector, (uintptr_t)req);
+    dev->ops->commit(dev);
+
+    return result;
+}
+
+size_t blk_submit_batch(struct blk_device *dev, struct blk_request **reqs, size_t count)
+{
+    size_t submitted;
+
+    for (submitted = 0; submitted < count; submitted++)
+    {
+        reqs[submitted]->submit_tsc = rdtsc();
+        if (dev->ops->submit(dev, reqs[submitted]))
+            break;
+        trace_point(TRACE_EVENT__BLOCK_SUBMIT, reqs[submitted]->sector, (uintptr_t)reqs[submitted]);
+    }
+
+    if (submitted)
+        dev->ops->commit(dev);
+
+    return submitted;
+}
+
+size_t blk_poll(struct blk_device *dev)
+{
+    return dev->ops->poll(dev);
+}
+
+void blk_end_request(struct blk_request *req)
+{
+    trace_point(TRACE_EVENT__BLOCK_COMPLETE, req->status, (uintptr_t)req);
+    req->end_io(req);
+
+    return;
+}
+
+static void blk_sync_end_io(struct blk_request *req)
+{
+    *(volatile bool *)req->private = true;
+
+    return;
+}
+
+int blk_rw_sync(struct blk_device *dev, enum blk_op op, u64 sector, void *buf, u32 length)
+{
+    struct blk_request req;
+    volatile bool done = false;
+
+    req.op = op;
+    req.sector = sector;
+    req.segment_count = op == BLK_OP__FLUSH ? 0 : 1;
+    req.segments[0].buf = buf;
+    req.segments[0].length = length;
+    req.end_io = blk_sync_end_io;
+    req.private = (void *)&done;
+
+    while (blk_submit(dev, &req))
+        blk_poll(dev);
+
+    while (!done)
+    {
+        if (blk_poll(dev) == 0)
+            cpu_relax();
+    }
+
+    return req.status;
+}
@@ -1,6 +1,13 @@
 #include <types.h>
 #include <boot/multiboot2.h>
 #include <boot/bootloader.h>
+#include <boot/init.h>
+#include <lib/string.h>
+#include <lib/util.h>
+
+struct boot_info boot_info;
+
+static char boot_command_line[BOOT_INFO__COMMAND_LINE_SIZE];
 
 static inline struct mb2_info_tag *command_line(struct mb2_info_tag__boot_command_line *tag);
 static inline struct mb2_info_tag *boot_loader_name(struct mb2_info_tag__boot_loader_name *tag);
@@ -24,16 +31,19 @@ static inline struct mb2_info_tag *efi_32bit_image_handler(struct mb2_info_tag__
 static inline struct mb2_info_tag *efi_64bit_image_handler(struct mb2_info_tag__efi_64bit_image_handler *tag);
 static inline struct mb2_info_tag *load_base_addr(struct mb2_info_tag__load_base_addr *tag);
 
-int bootloader(u32 multiboot2_magic_number, struct mb2_info_tag *multboot2_info_tag)
+int __init bootloader(u32 multiboot2_magic_number, struct mb2_info *mb2_info)
 {
     struct mb2_info_tag *tag;
     struct mb2_info_tag *next_tag;
 
     if (multiboot2_magic_number != MB2_INFO__MAGIC ||
-        multboot2_info_tag == NULL)
+        mb2_info == NULL)
         return -1;
 
-    for (tag = multboot2_info_tag; tag->type != MB2_INFO_TAG__TYPE__END; tag = next_tag)
+    boot_info.mb2_info_start = (uintptr_t)mb2_info;
+    boot_info.mb2_info_end = (uintptr_t)mb2_info + mb2_info->total_size;
+
+    for (tag = mb2_info->tags; tag->type != MB2_INFO_TAG__TYPE__END; tag = next_tag)
     {
         next_tag = NULL;
         
@@ -109,7 +119,8 @@ int bootloader(u32 multiboot2_magic_number, struct mb2_info_tag *multboot2_info_
         }
         
         // Vérification de sécurité pour éviter les pointeurs invalides
-        if (next_tag == NULL || (u8*)next_tag < (u8*)tag) {
+        if (next_tag == NULL || (u8*)next_tag <= (u8*)tag ||
+            (uintptr_t)next_tag >= boot_info.mb2_info_end) {
             return -1;
         }
     }
@@ -117,24 +128,57 @@ int bootloader(u32 multiboot2_magic_number, struct mb2_info_tag *multboot2_info_
     return 0;
 }
 
+bool boot_info_has_option(const char *option)
+{
+    const char *cursor = boot_info.command_line;
+    size_t length = strlen(option);
+
+    if (cursor == NULL)
+        return false;
+
+    while (*cursor != '\0')
+    {
+        while (*cursor == ' ')
+            cursor++;
+        if (strncmp(cursor, option, length) == 0 &&
+            (cursor[length] == ' ' || cursor[length] == '\0' || cursor[length] == '='))
+            return true;
+        while (*cursor != ' ' && *cursor != '\0')
+            cursor++;
+    }
+
+    return false;
+}
+
 static inline struct mb2_info_tag *command_line(struct mb2_info_tag__boot_command_line *tag)
 {
-    /* TODO */
+    /* Copied: the option checks outlive the Multiboot2 information */
+    size_t length = MIN(strlen((const char *)tag->string), sizeof(boot_command_line) - 1);
+
+    memcpy(boot_command_line, tag->string, length);
+    boot_command_line[length] = '\0';
+    boot_info.command_line = boot_command_line;
 
     return (struct mb2_info_tag *)((u8 *)tag + ((tag->size + 7) & ~7));
 }
 
 static inline struct mb2_info_tag *boot_loader_name(struct mb2_info_tag__boot_loader_name *tag)
 {
-    /* TODO */
-    
+    boot_info.boot_loader_name = tag->string;
+
     return (struct mb2_info_tag *)((u8 *)tag + ((tag->size + 7) & ~7));
 }
 
 static inline struct mb2_info_tag *module(struct mb2_info_tag__module *tag)
 {
-    /* TODO */
-    
+    if (boot_info.module_count < BOOT_INFO__MAX_MODULES)
+    {
+        boot_info.modules[boot_info.module_count].start = tag->mod_start;
+        boot_info.modules[boot_info.module_count].end = tag->mod_end;
+        boot_info.modules[boot_info.module_count].string = (const char *)tag->string;
+        boot_info.module_count++;
+    }
+
     return (struct mb2_info_tag *)((u8 *)tag + ((tag->size + 7) & ~7));
 }
 
@@ -154,8 +198,8 @@ static inline struct mb2_info_tag *boot_device(struct mb2_info_tag__boot_device
 
 static inline struct mb2_info_tag *memory_map(struct mb2_info_tag__memory_map *tag)
 {
-    /* TODO */
-    
+    boot_info.memory_map = tag;
+
     return (struct mb2_info_tag *)((u8 *)tag + ((tag->size + 7) & ~7));
 }
 
@@ -210,15 +254,17 @@ static inline struct mb2_info_tag *smbios(struct mb2_info_tag__smbios *tag)
 
 static inline struct mb2_info_tag *acpi_old(struct mb2_info_tag__acpi_old *tag)
 {
-    /* TODO */
-    
+    /* An ACPI 2.0 RSDP supersedes the 1.0 one whatever the tag order */
+    if (boot_info.acpi_rsdp == NULL)
+        boot_info.acpi_rsdp = tag->rsdp;
+
     return (struct mb2_info_tag *)((u8 *)tag + ((tag->size + 7) & ~7));
 }
 
 static inline struct mb2_info_tag *acpi_new(struct mb2_info_tag__acpi_new *tag)
 {
-    /* TODO */
-    
+    boot_info.acpi_rsdp = tag->rsdp;
+
     return (struct mb2_info_tag *)((u8 *)tag + ((tag->size + 7) & ~7));
 }
 
@@ -231,15 +277,15 @@ static inline struct mb2_info_tag *network(struct mb2_info_tag__network *tag)
 
 static inline struct mb2_info_tag *efi_memory_map(struct mb2_info_tag__efi_memory_map *tag)
 {
-    /* TODO */
-    
+    boot_info.efi_memory_map = tag;
+
     return (struct mb2_info_tag *)((u8 *)tag + ((tag->size + 7) & ~7));
 }
 
 static inline struct mb2_info_tag *efi_boot_service(struct mb2_info_tag__efi_boot_service *tag)
 {
-    /* TODO */
-    
+    boot_info.efi_boot_services = true;
+
     return (struct mb2_info_tag *)((u8 *)tag + ((tag->size + 7) & ~7));
 }
 
@@ -0,0 +1,111 @@
+#include <types.h>
+#include <arch/cpu.h>
+#include <arch/interrupt.h>
+#include <boot/init.h>
+#include <irq/irq.h>
+#include <irq/pic.h>
+#include <lib/printk.h>
+#include <proc/process.h>
+#include <trace/trace.h>
+
+static irq_handler_t irq_handlers[INTERRUPT_VECTORS];
+static bool irq_fatal_nested;
+
+static const char *const irq_exception_names[INTERRUPT_VECTOR__EXCEPTIONS] =
+{
+    "divide error", "debug", "NMI", "breakpoint", "overflow", "bound range exceeded",
+    "invalid opcode", "device not available", "double fault", "coprocessor segment overrun",
+    "invalid TSS", "segment not present", "stack-segment fault", "general protection fault",
+    "page fault", "reserved", "x87 floating-point error", "alignment check", "machine check",
+    "SIMD floating-point error", "virtualization exception", "control protection exception",
+};
+
+/* An exception nobody handles: report it, keep the trace of what led there and stop */
+static void irq_fatal(struct interrupt_frame *frame)
+{
+    const char *name = irq_exception_names[frame->vector];
+
+    interrupts_disable();
+
+    printk("irq: %s (vector %u), error %llx at ip %llx\n", name != NULL ? name : "reserved",
+           (u32)frame->vector, (unsigned long long)frame->error_code, (unsigned long long)frame->ip);
+    if (frame->vector == INTERRUPT_VECTOR__PAGE_FAULT)
+        printk("irq: faulting address %llx\n", (unsigned long long)read_cr2());
+
+    /* A fault while dumping must not recurse into another dump */
+    if (!irq_fatal_nested)
+    {
+        irq_fatal_nested = true;
+        trace_dump();
+    }
+
+    while (1)
+        cpu_halt();
+}
+
+/* An exception raised in user mode only ends the process that raised it */
+static void irq_user_fault(struct interrupt_frame *frame)
+{
+    const char *name = irq_exception_names[frame->vector];
+
+    printk("irq: %s (vector %u) in process %u at ip %llx\n", name != NULL ? name : "reserved",
+           (u32)frame->vector, process_current()->pid, (unsigned long long)frame->ip);
+    if (frame->vector == INTERRUPT_VECTOR__PAGE_FAULT)
+        printk("irq: faulting address %llx\n", (unsigned long long)read_cr2());
+
+    trace_point(TRACE_EVENT__IRQ_EXIT, (u32)frame->vector, 0);
+    process_exit(-1);
+}
+
+void irq_exception(struct interrupt_frame *frame)
+{
+    if ((frame->cs & 3) && process_current() != NULL)
+        irq_user_fault(frame);
+    else
+        irq_fatal(frame);
+
+    return;
+}
+
+void interrupt_dispatch(struct interrupt_frame *frame)
+{
+    u32 vector = (u32)frame->vector;
+    irq_handler_t handler = irq_handlers[vector];
+    bool legacy = vector >= IRQ_VECTOR_BASE && vector < IRQ_VECTOR_BASE + PIC_LINES;
+
+    trace_point(TRACE_EVENT__IRQ_ENTRY, vector, frame->ip);
+
+    /* Spurious PIC interrupts run nothing and are not acknowledged; other stray vectors are ignored */
+    if (legacy && pic_spurious((u8)(vector - IRQ_VECTOR_BASE)))
+        legacy = false;
+    else if (handler != NULL)
+        handler(frame);
+    else if (vector < INTERRUPT_VECTOR__EXCEPTIONS)
+        irq_exception(frame);
+
+    if (legacy)
+        pic_eoi((u8)(vector - IRQ_VECTOR_BASE));
+
+    trace_point(TRACE_EVENT__IRQ_EXIT, vector, 0);
+
+    return;
+}
+
+int irq_register(u32 vector, irq_handler_t handler)
+{
+    if (vector >= INTERRUPT_VECTORS)
+        return -1;
+
+    irq_handlers[vector] = handler;
+
+    return 0;
+}
+
+int __init irq_init(void)
+{
+    idt_init();
+    pic_init(IRQ_VECTOR_BASE);
+    interrupts_enable();
+
+    return 0;
+}
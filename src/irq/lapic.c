@@ -0,0 +1,125 @@
+#include <types.h>
+#include <acpi/topology.h>
+#include <arch/cpu.h>
+#include <arch/interrupt.h>
+#include <boot/init.h>
+#include <irq/lapic.h>
+#include <lib/printk.h>
+#include <mm/mmu.h>
+
+#define MSR_APIC_BASE               0x1B
+#define MSR_APIC_BASE__ENABLE       ((u64)1 << 11)
+#define MSR_APIC_BASE__ADDRESS      0xFFFFFF000ULL
+
+#define LAPIC_REGISTERS_SIZE        0x1000
+
+#define LAPIC_ID                    0x020
+#define LAPIC_EOI                   0x0B0
+#define LAPIC_SVR                   0x0F0
+#define LAPIC_ESR                   0x280
+#define LAPIC_ICR_LOW               0x300
+#define LAPIC_ICR_HIGH              0x310
+
+#define LAPIC_SVR__ENABLE           ((u32)1 << 8)
+
+#define LAPIC_ICR__FIXED            ((u32)0 << 8)
+#define LAPIC_ICR__INIT             ((u32)5 << 8)
+#define LAPIC_ICR__STARTUP          ((u32)6 << 8)
+#define LAPIC_ICR__PENDING          ((u32)1 << 12)
+#define LAPIC_ICR__ASSERT           ((u32)1 << 14)
+
+/* Polls of the delivery status before giving up on an IPI; a few microseconds in practice */
+#define LAPIC_ICR_POLLS             1000000
+
+static volatile u32 *lapic_registers;
+
+static inline u32 lapic_read(u32 reg)
+{
+    return lapic_registers[reg / 4];
+}
+
+static inline void lapic_write(u32 reg, u32 value)
+{
+    lapic_registers[reg / 4] = value;
+}
+
+void lapic_enable(void)
+{
+    lapic_write(LAPIC_SVR, LAPIC_SVR__ENABLE | LAPIC_VECTOR_SPURIOUS);
+
+    /* Writing the ESR latches (and so clears) errors from before */
+    lapic_write(LAPIC_ESR, 0);
+
+    return;
+}
+
+int __init lapic_init(void)
+{
+    u64 base = rdmsr(MSR_APIC_BASE);
+    u64 address = acpi_topology.local_apic_address;
+
+    if (!(base & MSR_APIC_BASE__ENABLE))
+        wrmsr(MSR_APIC_BASE, base | MSR_APIC_BASE__ENABLE);
+    if (address == 0)
+        address = base & MSR_APIC_BASE__ADDRESS;
+
+    lapic_registers = mmu_map_io(address, LAPIC_REGISTERS_SIZE);
+    if (lapic_registers == NULL)
+    {
+        printk("lapic: cannot map registers at %llx\n", (unsigned long long)address);
+        return -1;
+    }
+
+    lapic_enable();
+
+    return 0;
+}
+
+u32 lapic_id(void)
+{
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+void lapic_eoi(void)
+{
+    lapic_write(LAPIC_EOI, 0);
+
+    return;
+}
+
+/* One ICR write; the high half (destination) must go first, the low half sends */
+static int lapic_send(u32 apic_id, u32 command)
+{
+    /* Nothing may send its own IPI between the two halves */
+    uintptr_t flags = interrupts_save();
+    u32 poll;
+
+    lapic_write(LAPIC_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, command);
+
+    for (poll = 0; poll < LAPIC_ICR_POLLS; poll++)
+    {
+        if (!(lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR__PENDING))
+            break;
+        cpu_relax();
+    }
+
+    interrupts_restore(flags);
+
+    return poll < LAPIC_ICR_POLLS ? 0 : -1;
+}
+
+int lapic_send_ipi(u32 apic_id, u8 vector)
+{
+    return lapic_send(apic_id, LAPIC_ICR__FIXED | LAPIC_ICR__ASSERT | vector);
+}
+
+int lapic_send_init(u32 apic_id)
+{
+    return lapic_send(apic_id, LAPIC_ICR__INIT | LAPIC_ICR__ASSERT);
+}
+
+int lapic_send_startup(u32 apic_id, u8 page)
+{
+    return lapic_send(apic_id, LAPIC_ICR__STARTUP | LAPIC_ICR__ASSERT | page);
+}
@@ -0,0 +1,94 @@
+#include <types.h>
+#include <arch/io.h>
+#include <boot/init.h>
+#include <irq/pic.h>
+
+#define PIC_MASTER_COMMAND      0x20
+#define PIC_MASTER_DATA         0x21
+#define PIC_SLAVE_COMMAND       0xA0
+#define PIC_SLAVE_DATA          0xA1
+
+#define PIC_ICW1__ICW4          0x01
+#define PIC_ICW1__INIT          0x10
+#define PIC_ICW4__8086          0x01
+#define PIC_OCW3__READ_ISR      0x0B
+#define PIC_EOI                 0x20
+
+/* The slave is wired to master line 2 */
+#define PIC_CASCADE_LINE        2
+
+static inline void pic_io_wait(void)
+{
+    outb(0x80, 0);
+}
+
+void __init pic_init(u8 vector_base)
+{
+    outb(PIC_MASTER_COMMAND, PIC_ICW1__INIT | PIC_ICW1__ICW4);
+    pic_io_wait();
+    outb(PIC_SLAVE_COMMAND, PIC_ICW1__INIT | PIC_ICW1__ICW4);
+    pic_io_wait();
+    outb(PIC_MASTER_DATA, vector_base);
+    pic_io_wait();
+    outb(PIC_SLAVE_DATA, vector_base + 8);
+    pic_io_wait();
+    outb(PIC_MASTER_DATA, 1 << PIC_CASCADE_LINE);
+    pic_io_wait();
+    outb(PIC_SLAVE_DATA, PIC_CASCADE_LINE);
+    pic_io_wait();
+    outb(PIC_MASTER_DATA, PIC_ICW4__8086);
+    pic_io_wait();
+    outb(PIC_SLAVE_DATA, PIC_ICW4__8086);
+    pic_io_wait();
+
+    /* Everything masked except the cascade; drivers unmask their own line */
+    outb(PIC_MASTER_DATA, (u8)~(1 << PIC_CASCADE_LINE));
+    outb(PIC_SLAVE_DATA, 0xFF);
+
+    return;
+}
+
+void pic_mask(u8 line)
+{
+    u16 port = line < 8 ? PIC_MASTER_DATA : PIC_SLAVE_DATA;
+
+    outb(port, inb(port) | (u8)(1 << (line & 7)));
+
+    return;
+}
+
+void pic_unmask(u8 line)
+{
+    u16 port = line < 8 ? PIC_MASTER_DATA : PIC_SLAVE_DATA;
+
+    outb(port, inb(port) & (u8)~(1 << (line & 7)));
+
+    return;
+}
+
+void pic_eoi(u8 line)
+{
+    if (line >= 8)
+        outb(PIC_SLAVE_COMMAND, PIC_EOI);
+    outb(PIC_MASTER_COMMAND, PIC_EOI);
+
+    return;
+}
+
+bool pic_spurious(u8 line)
+{
+    u16 command = line < 8 ? PIC_MASTER_COMMAND : PIC_SLAVE_COMMAND;
+
+    if ((line & 7) != 7)
+        return false;
+
+    outb(command, PIC_OCW3__READ_ISR);
+    if (inb(command) & 0x80)
+        return false;
+
+    /* The master did see the cascade line go active and expects an EOI for it */
+    if (line >= 8)
+        outb(PIC_MASTER_COMMAND, PIC_EOI);
+
+    return true;
+}
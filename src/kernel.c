@@ -1,26 +1,102 @@
 #include <types.h>
+#include <acpi/acpi.h>
+#include <acpi/topology.h>
+#include <arch/arch.h>
+#include <arch/cpu.h>
+#include <arch/gdt.h>
+#include <arch/syscall.h>
+#include <bench/bcachebench.h>
+#include <bench/blkbench.h>
+#include <bench/ipcbench.h>
+#include <bench/numabench.h>
+#include <bench/syscallbench.h>
+#include <block/bcache.h>
+#include <block/blkdev.h>
 #include <boot/bootloader.h>
 #include <boot/multiboot2.h>
+#include <drivers/block/virtio_blk.h>
 #include <drivers/display/vga.h>
-
-#ifdef __x86_64__
-    #include <arch/x86_64/arch_types.h>
-#else
-    #include <arch/i386/arch_types.h>
-#endif
+#include <drivers/pci/pci.h>
+#include <irq/irq.h>
+#include <irq/lapic.h>
+#include <lib/printk.h>
+#include <lib/util.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+#include <mm/prezero.h>
+#include <mm/reclaim.h>
+#include <proc/process.h>
+#include <smp/smp.h>
+#include <time/hpet.h>
+#include <time/tsc.h>
+#include <time/vdso.h>
+#include <trace/profile.h>
+#include <trace/trace.h>
 
 void kernel_main(u32 multiboot2_magic_number, uintptr_t multiboot2_info_addr)
 {
-    struct mb2_info_tag *mb2_info_tag = (struct mb2_info_tag *)multiboot2_info_addr;
-    char str[] = "Hello, World!";
+    struct mb2_info *mb2_info = (struct mb2_info *)multiboot2_info_addr;
+    char str[] = "Hello, World!\n";
+    u64 boot_start = rdtsc();
 
     vga_init();
-    vga_write(str, 14);
+    vga_write(str, 15);
     
-    if (bootloader(multiboot2_magic_number, mb2_info_tag))
+    if (bootloader(multiboot2_magic_number, mb2_info))
+        return;
+
+    gdt_init();
+    irq_init();
+
+    if (mmu_init())
+        return;
+
+    if (frame_init(&boot_info))
         return;
 
-    while (1);
+    acpi_init(&boot_info);
+    acpi_topology_init();
+    frame_numa_init(&boot_info);
+    trace_init();
+    hpet_init();
+    tsc_init();
+    vdso_init();
+    /* After calibration, which the timer interrupts would otherwise disturb */
+    profile_init();
+    if (lapic_init() == 0)
+        smp_init(&boot_info);
+    frame_init_parallel();
+    prezero_init();
+    syscall_init();
+    process_init();
+    pci_ecam_init();
+    pci_init();
+    virtio_blk_init();
+    /* Sized from free memory, which is wasted without a disk */
+    if (blk_device_count() > 0)
+        bcache_init(0);
+
+    /* Last use of the Multiboot2 information and of every __init function */
+    reclaim_boot_memory(&boot_info);
+
+    /* From kernel entry, for comparing build profiles; firmware and the boot loader come on top */
+    printk("boot: initialised in %llu us\n",
+           (unsigned long long)div_u64(tsc_cycles_to_ns(rdtsc() - boot_start), 1000));
+
+    if (boot_info_has_option("blkbench"))
+        blkbench_run(blk_get(0));
+    if (boot_info_has_option("bcachebench"))
+        bcachebench_run(blk_get(0));
+    if (boot_info_has_option("numabench"))
+        numabench_run();
+    if (boot_info_has_option("syscallbench"))
+        syscallbench_run();
+    if (boot_info_has_option("ipcbench"))
+        ipcbench_run();
+
+    profile_dump();
+    if (trace_events())
+        trace_dump();
 
-    return;
-}
\ No newline at end of file
+    smp_idle();
+}
@@ -0,0 +1,174 @@
+#include <types.h>
+#include <lib/printk.h>
+#include <lib/stdarg.h>
+#include <lib/util.h>
+#include <lib/string.h>
+#include <drivers/display/vga.h>
+
+#define PRINTK_BUFFER_SIZE 256
+
+struct printk_out
+{
+    char *buf;
+    size_t size;
+    size_t length;
+};
+
+static inline void out_char(struct printk_out *out, char c)
+{
+    if (out->length + 1 < out->size)
+        out->buf[out->length] = c;
+    out->length++;
+
+    return;
+}
+
+static void out_number(struct printk_out *out, u64 value, u32 base, bool upper, bool negative,
+                       size_t width, char pad)
+{
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char tmp[24];
+    size_t length = 0;
+    u32 digit;
+
+    do
+    {
+        value = div_u64_rem(value, base, &digit);
+        tmp[length++] = digits[digit];
+    } while (value);
+
+    if (negative && pad == '0')
+        out_char(out, '-');
+    for (; width > length + (negative ? 1 : 0); width--)
+        out_char(out, pad);
+    if (negative && pad != '0')
+        out_char(out, '-');
+    while (length)
+        out_char(out, tmp[--length]);
+
+    return;
+}
+
+int vsnprintk(char *buf, size_t size, const char *fmt, va_list args)
+{
+    struct printk_out out = { buf, size, 0 };
+
+    for (; *fmt; fmt++)
+    {
+        char pad = ' ';
+        size_t width = 0;
+        int longs = 0;
+        u64 value;
+        const char *str;
+
+        if (*fmt != '%')
+        {
+            out_char(&out, *fmt);
+            continue;
+        }
+
+        fmt++;
+        if (*fmt == '0')
+        {
+            pad = '0';
+            fmt++;
+        }
+        for (; *fmt >= '0' && *fmt <= '9'; fmt++)
+            width = width * 10 + (size_t)(*fmt - '0');
+        for (; *fmt == 'l'; fmt++)
+            longs++;
+        if (*fmt == 'z')
+        {
+            longs = sizeof(size_t) == sizeof(u64) ? 2 : 0;
+            fmt++;
+        }
+
+        switch (*fmt)
+        {
+            case 'd':
+            case 'i':
+            {
+                s64 svalue;
+
+                if (longs >= 2)
+                    svalue = va_arg(args, s64);
+                else if (longs == 1)
+                    svalue = va_arg(args, long);
+                else
+                    svalue = va_arg(args, int);
+                out_number(&out, svalue < 0 ? (u64)-svalue : (u64)svalue, 10, false, svalue < 0, width, pad);
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X':
+                if (longs >= 2)
+                    value = va_arg(args, u64);
+                else if (longs == 1)
+                    value = va_arg(args, unsigned long);
+                else
+                    value = va_arg(args, unsigned int);
+                out_number(&out, value, *fmt == 'u' ? 10 : 16, *fmt == 'X', false, width, pad);
+                break;
+            case 'p':
+                out_char(&out, '0');
+                out_char(&out, 'x');
+                out_number(&out, (uintptr_t)va_arg(args, void *), 16, false, false, sizeof(void *) * 2, '0');
+                break;
+            case 's':
+                str = va_arg(args, const char *);
+                if (str == NULL)
+                    str = "(null)";
+                for (; width > strlen(str); width--)
+                    out_char(&out, ' ');
+                for (; *str; str++)
+                    out_char(&out, *str);
+                break;
+            case 'c':
+                out_char(&out, (char)va_arg(args, int));
+                break;
+            case '%':
+                out_char(&out, '%');
+                break;
+            case '\0':
+                fmt--;
+                break;
+            default:
+                out_char(&out, '%');
+                out_char(&out, *fmt);
+                break;
+        }
+    }
+
+    if (size)
+        buf[out.length < size ? out.length : size - 1] = '\0';
+
+    return (int)out.length;
+}
+
+int snprintk(char *buf, size_t size, const char *fmt, ...)
+{
+    va_list args;
+    int length;
+
+    va_start(args, fmt);
+    length = vsnprintk(buf, size, fmt, args);
+    va_end(args);
+
+    return length;
+}
+
+int printk(const char *fmt, ...)
+{
+    char buf[PRINTK_BUFFER_SIZE];
+    va_list args;
+    int length;
+
+    va_start(args, fmt);
+    length = vsnprintk(buf, sizeof(buf), fmt, args);
+    va_end(args);
+
+    vga_write(buf, MIN((size_t)length, sizeof(buf) - 1));
+
+    return length;
+}
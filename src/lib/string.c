@@ -0,0 +1,72 @@
+#include <types.h>
+#include <lib/string.h>
+
+void *memset(void *dest, int value, size_t count)
+{
+    u8 *d = dest;
+
+    while (count--)
+        *d++ = (u8)value;
+
+    return dest;
+}
+
+void *memcpy(void *dest, const void *src, size_t count)
+{
+    u8 *d = dest;
+    const u8 *s = src;
+
+    while (count--)
+        *d++ = *s++;
+
+    return dest;
+}
+
+void *memmove(void *dest, const void *src, size_t count)
+{
+    u8 *d = dest;
+    const u8 *s = src;
+
+    if (d < s)
+        return memcpy(dest, src, count);
+
+    while (count--)
+        d[count] = s[count];
+
+    return dest;
+}
+
+int memcmp(const void *lhs, const void *rhs, size_t count)
+{
+    const u8 *l = lhs;
+    const u8 *r = rhs;
+
+    for (; count; count--, l++, r++)
+        if (*l != *r)
+            return *l - *r;
+
+    return 0;
+}
+
+size_t strlen(const char *str)
+{
+    size_t length = 0;
+
+    while (str[length] != '\0')
+        length++;
+
+    return length;
+}
+
+int strncmp(const char *lhs, const char *rhs, size_t count)
+{
+    for (; count; count--, lhs++, rhs++)
+    {
+        if (*lhs != *rhs)
+            return (u8)*lhs - (u8)*rhs;
+        if (*lhs == '\0')
+            break;
+    }
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include <types.h>
+#include <lib/util.h>
+
+#ifdef __x86_64__
+
+u64 div_u64_rem(u64 dividend, u32 divisor, u32 *remainder)
+{
+    *remainder = (u32)(dividend % divisor);
+
+    return dividend / divisor;
+}
+
+#else
+
+/* Two-step long division so only 64/32 'divl' instructions are emitted */
+u64 div_u64_rem(u64 dividend, u32 divisor, u32 *remainder)
+{
+    u32 high = (u32)(dividend >> 32);
+    u32 low = (u32)dividend;
+    u32 quotient_high = high / divisor;
+    u32 quotient_low;
+    u32 rem = high % divisor;
+
+    __asm__ ("divl %4" : "=a"(quotient_low), "=d"(rem) : "a"(low), "d"(rem), "rm"(divisor));
+
+    *remainder = rem;
+
+    return ((u64)quotient_high << 32) | quotient_low;
+}
+
+#endif
@@ -0,0 +1,122 @@
+#include <types.h>
+#include <arch/arch.h>
+#include <lib/spinlock.h>
+#include <mm/cow.h>
+
+/* Open addressing with linear probing; deletion shifts the run back so lookups need no tombstones */
+struct cow_slot
+{
+    uintptr_t frame;    /* 0 when free: frame 0 is never handed out */
+    u32 count;
+};
+
+static struct cow_slot cow_slots[COW_SLOTS];
+static size_t cow_used;
+static spinlock_t cow_lock = SPINLOCK_INIT;
+
+static inline u32 cow_hash(uintptr_t frame)
+{
+    return ((u32)(frame >> PAGE_SHIFT) * 0x9E3779B1U) & (COW_SLOTS - 1);
+}
+
+/* Slot holding 'frame', or the free slot ending its probe run; call with cow_lock held */
+static struct cow_slot *cow_lookup(uintptr_t frame)
+{
+    u32 index = cow_hash(frame);
+
+    while (cow_slots[index].frame != 0 && cow_slots[index].frame != frame)
+        index = (index + 1) & (COW_SLOTS - 1);
+
+    return &cow_slots[index];
+}
+
+static void cow_remove(struct cow_slot *slot)
+{
+    u32 hole = (u32)(slot - cow_slots);
+    u32 index = hole;
+
+    /* Move back every later entry of the run whose home slot does not lie between the hole and itself */
+    while (1)
+    {
+        u32 home;
+
+        index = (index + 1) & (COW_SLOTS - 1);
+        if (cow_slots[index].frame == 0)
+            break;
+
+        home = cow_hash(cow_slots[index].frame);
+        if (((index - home) & (COW_SLOTS - 1)) >= ((index - hole) & (COW_SLOTS - 1)))
+        {
+            cow_slots[hole] = cow_slots[index];
+            hole = index;
+        }
+    }
+
+    cow_slots[hole].frame = 0;
+    cow_slots[hole].count = 0;
+    cow_used--;
+
+    return;
+}
+
+int cow_share(uintptr_t frame)
+{
+    struct cow_slot *slot;
+    int result = 0;
+
+    spin_lock(&cow_lock);
+
+    slot = cow_lookup(frame);
+    if (slot->frame == frame)
+    {
+        slot->count++;
+    }
+    else if (cow_used < COW_SLOTS - 1)
+    {
+        /* At least one slot stays free so every probe run terminates */
+        slot->frame = frame;
+        slot->count = 2;
+        cow_used++;
+    }
+    else
+    {
+        result = -1;
+    }
+
+    spin_unlock(&cow_lock);
+
+    return result;
+}
+
+bool cow_release(uintptr_t frame)
+{
+    struct cow_slot *slot;
+    bool last = true;
+
+    spin_lock(&cow_lock);
+
+    slot = cow_lookup(frame);
+    if (slot->frame == frame)
+    {
+        last = false;
+        if (--slot->count == 1)
+            cow_remove(slot);
+    }
+
+    spin_unlock(&cow_lock);
+
+    return last;
+}
+
+u32 cow_count(uintptr_t frame)
+{
+    struct cow_slot *slot;
+    u32 count;
+
+    spin_lock(&cow_lock);
+    slot = cow_lookup(frame);
+    count = slot->frame == frame ? slot->count : 1;
+    spin_unlock(&cow_lock);
+
+    return count;
+}
@@ -0,0 +1,1065 @@
+#include <types.h>
+#include <acpi/topology.h>
+#include <arch/arch.h>
+#include <arch/cpu.h>
+#include <arch/interrupt.h>
+#include <boot/bootloader.h>
+#include <boot/init.h>
+#include <boot/multiboot2.h>
+#include <lib/printk.h>
+#include <lib/spinlock.h>
+#include <lib/string.h>
+#include <lib/util.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+#include <smp/smp.h>
+#include <time/tsc.h>
+#include <trace/trace.h>
+
+#define FRAME_MAX_RESERVED   (BOOT_INFO__MAX_MODULES + 3)
+#define FRAME_MAX_RANGES     32
+
+/* Deferred initialisation works on 128MB chunks, which are whole bitmap words in every pool */
+#define FRAME_CHUNK_SHIFT    15
+#define FRAME_CHUNK_FRAMES   ((uintptr_t)1 << FRAME_CHUNK_SHIFT)
+#define FRAME_MAX_CHUNKS     ((MEMORY_END_PFN + FRAME_CHUNK_FRAMES - 1) >> FRAME_CHUNK_SHIFT)
+
+/* Chunks each CPU initialises during boot; idle time and allocations that need them do the rest */
+#define FRAME_BOOT_CHUNKS    8
+
+#define FRAME_CHUNK__DONE    0
+#define FRAME_CHUNK__PENDING 1
+#define FRAME_CHUNK__BUSY    2
+#define FRAME_CHUNK__EAGER   3      /* frame_init() only: holds something, released at once */
+
+struct frame_range
+{
+    uintptr_t start;
+    uintptr_t end;
+};
+
+/* SRAT memory range in frames */
+struct frame_node_range
+{
+    uintptr_t start_pfn;
+    uintptr_t end_pfn;
+    u32 node;
+};
+
+struct frame_node
+{
+    struct frame_pool pool;
+    size_t total_frames;
+    u32 fallback[FRAME_MAX_NODES];  /* nodes by increasing distance, this one first */
+    u32 fallback_count;
+    volatile size_t local_allocs;
+    volatile size_t remote_allocs;
+};
+
+extern u8 _kernel_start[];
+extern u8 _kernel_end[];
+
+/* Until frame_numa_init() everything is node 0, whose pool covers all managed memory */
+static struct frame_node frame_nodes[FRAME_MAX_NODES] =
+{
+    [0] = { .fallback = { 0 }, .fallback_count = 1 },
+};
+static u32 frame_nodes_count = 1;
+static struct frame_node_range frame_node_ranges[ACPI_MAX_MEMORY_RANGES];
+static size_t frame_node_ranges_count;
+static uintptr_t frame_managed_end_pfn;
+static u32 frame_cpu_nodes[NR_CPUS];
+static bool frame_cpu_nodes_valid[NR_CPUS];
+
+/* Available memory in frames, kept for chunks initialised after the Multiboot2 information is gone */
+static struct frame_range frame_ranges[FRAME_MAX_RANGES];
+static size_t frame_ranges_count;
+
+static volatile u8 frame_chunks[FRAME_MAX_CHUNKS];
+static u16 frame_chunk_frames[FRAME_MAX_CHUNKS];   /* available frames of a pending chunk */
+static size_t frame_chunks_count;
+static volatile size_t frame_chunk_cursor;
+static volatile size_t frame_pending_frames;
+
+static inline u32 frame_hweight32(u32 word)
+{
+    word = word - ((word >> 1) & 0x55555555U);
+    word = (word & 0x33333333U) + ((word >> 2) & 0x33333333U);
+    word = (word + (word >> 4)) & 0x0F0F0F0FU;
+
+    return (word * 0x01010101U) >> 24;
+}
+
+/* 'count' bits from bit 'shift' up, with shift + count <= 32 */
+static inline u32 frame_bits(uintptr_t shift, uintptr_t count)
+{
+    return (count == 32 ? 0xFFFFFFFFU : ((u32)1 << count) - 1) << shift;
+}
+
+static inline bool frame_test(const struct frame_pool *pool, uintptr_t pfn)
+{
+    uintptr_t bit = pfn - pool->start_pfn;
+
+    return (pool->bitmap[bit / 32] >> (bit % 32)) & 1;
+}
+
+static inline void frame_set(struct frame_pool *pool, uintptr_t pfn)
+{
+    uintptr_t bit = pfn - pool->start_pfn;
+
+    pool->bitmap[bit / 32] |= (u32)1 << (bit % 32);
+}
+
+static inline void frame_clear(struct frame_pool *pool, uintptr_t pfn)
+{
+    uintptr_t bit = pfn - pool->start_pfn;
+
+    pool->bitmap[bit / 32] &= ~((u32)1 << (bit % 32));
+}
+
+size_t frame_pool_bitmap_size(uintptr_t start_pfn, uintptr_t end_pfn)
+{
+    if (start_pfn >= end_pfn)
+        return 0;
+
+    return (ALIGN_UP(end_pfn, 32) - ALIGN_DOWN(start_pfn, 32)) / 8;
+}
+
+void frame_pool_init(struct frame_pool *pool, uintptr_t start_pfn, uintptr_t end_pfn, u32 *bitmap)
+{
+    size_t words = frame_pool_bitmap_size(start_pfn, end_pfn) / 4;
+    size_t word;
+
+    /* Word-aligned, so the same pfn range is the same whole words in every pool */
+    pool->start_pfn = ALIGN_DOWN(start_pfn, 32);
+    pool->end_pfn = end_pfn;
+    pool->bitmap = bitmap;
+    pool->free_frames = 0;
+    pool->next_pfn = start_pfn;
+    spin_lock_init(&pool->lock);
+
+    for (word = 0; word < words; word++)
+        bitmap[word] = 0xFFFFFFFFU;
+
+    return;
+}
+
+size_t frame_pool_release(struct frame_pool *pool, uintptr_t start_pfn, uintptr_t end_pfn)
+{
+    size_t released = 0;
+    uintptr_t pfn;
+
+    start_pfn = MAX(start_pfn, pool->start_pfn);
+    end_pfn = MIN(end_pfn, pool->end_pfn);
+
+    spin_lock(&pool->lock);
+    for (pfn = start_pfn; pfn < end_pfn; pfn++)
+    {
+        uintptr_t bit = pfn - pool->start_pfn;
+
+        if (bit % 32 == 0 && pfn + 32 <= end_pfn)
+        {
+            u32 used = frame_hweight32(pool->bitmap[bit / 32]);
+
+            pool->bitmap[bit / 32] = 0;
+            pool->free_frames += used;
+            released += used;
+            pfn += 31;
+        }
+        else if (frame_test(pool, pfn))
+        {
+            frame_clear(pool, pfn);
+            pool->free_frames++;
+            released++;
+        }
+    }
+    spin_unlock(&pool->lock);
+
+    return released;
+}
+
+void frame_pool_reserve(struct frame_pool *pool, uintptr_t start_pfn, uintptr_t end_pfn)
+{
+    uintptr_t pfn;
+
+    start_pfn = MAX(start_pfn, pool->start_pfn);
+    end_pfn = MIN(end_pfn, pool->end_pfn);
+
+    spin_lock(&pool->lock);
+    for (pfn = start_pfn; pfn < end_pfn; pfn++)
+    {
+        if (!frame_test(pool, pfn))
+        {
+            frame_set(pool, pfn);
+            pool->free_frames--;
+        }
+    }
+    spin_unlock(&pool->lock);
+
+    return;
+}
+
+/* Finds 'count' consecutive free frames in [from, to); returns the first pfn or 0 */
+static uintptr_t frame_pool_search(const struct frame_pool *pool, uintptr_t from, uintptr_t to, size_t count)
+{
+    uintptr_t pfn = from;
+    size_t run = 0;
+
+    while (pfn < to)
+    {
+        uintptr_t bit = pfn - pool->start_pfn;
+
+        if (run == 0 && bit % 32 == 0 && pool->bitmap[bit / 32] == 0xFFFFFFFFU)
+        {
+            pfn += 32;
+            continue;
+        }
+
+        if (frame_test(pool, pfn))
+        {
+            run = 0;
+        }
+        else if (++run == count)
+        {
+            return pfn + 1 - count;
+        }
+
+        pfn++;
+    }
+
+    return 0;
+}
+
+uintptr_t frame_pool_alloc(struct frame_pool *pool, size_t count)
+{
+    uintptr_t pfn;
+    size_t index;
+
+    if (count == 0)
+        return 0;
+
+    spin_lock(&pool->lock);
+
+    if (pool->free_frames < count)
+    {
+        spin_unlock(&pool->lock);
+        return 0;
+    }
+
+    pfn = frame_pool_search(pool, pool->next_pfn, pool->end_pfn, count);
+    if (pfn == 0)
+        pfn = frame_pool_search(pool, pool->start_pfn, MIN(pool->next_pfn + count, pool->end_pfn), count);
+
+    if (pfn != 0)
+    {
+        for (index = 0; index < count; index++)
+            frame_set(pool, pfn + index);
+        pool->free_frames -= count;
+        pool->next_pfn = pfn + count < pool->end_pfn ? pfn + count : pool->start_pfn;
+    }
+
+    spin_unlock(&pool->lock);
+
+    return pfn;
+}
+
+void frame_pool_free(struct frame_pool *pool, uintptr_t pfn, size_t count)
+{
+    size_t already_free = 0;
+    size_t index;
+
+    spin_lock(&pool->lock);
+    for (index = 0; index < count; index++)
+    {
+        if (frame_test(pool, pfn + index))
+        {
+            frame_clear(pool, pfn + index);
+            pool->free_frames++;
+        }
+        else
+        {
+            already_free++;
+        }
+    }
+    spin_unlock(&pool->lock);
+
+    /* The bitmap is left consistent, but whoever freed it twice may still be using it */
+    if (already_free)
+        printk("frame: double free of %zu of %zu frames at pfn %lx\n", already_free, count, (unsigned long)pfn);
+
+    return;
+}
+
+static inline bool frame_range_overlaps(const struct frame_range *range, uintptr_t start, uintptr_t end)
+{
+    return start < range->end && range->start < end;
+}
+
+/* Places the bitmap in the first available region hole that avoids every reserved range */
+static uintptr_t __init frame_bitmap_place(const struct mb2_info_tag__memory_map *memory_map, uintptr_t limit,
+                                    const struct frame_range *reserved, size_t reserved_count, size_t size)
+{
+    const struct mb2_info_tag__memory_map__entry *entry;
+
+    for (entry = memory_map->entries;
+         (const u8 *)entry < (const u8 *)memory_map + memory_map->size;
+         entry = (const struct mb2_info_tag__memory_map__entry *)((const u8 *)entry + memory_map->entry_size))
+    {
+        u64 start = MAX(ALIGN_UP(entry->base_addr, (u64)PAGE_SIZE), (u64)FRAME_LOW_MEMORY_END);
+        u64 end = MIN(ALIGN_DOWN(entry->base_addr + entry->length, (u64)PAGE_SIZE), (u64)limit);
+        uintptr_t candidate;
+        size_t index;
+
+        if (entry->type != MB2_INFO_TAG__MEMORY_MAP__ENTRY__TYPE__MEMORY_AVAILABLE || start >= end)
+            continue;
+
+        candidate = (uintptr_t)start;
+        for (index = 0; index < reserved_count; index++)
+        {
+            if (frame_range_overlaps(&reserved[index], candidate, candidate + size))
+            {
+                candidate = ALIGN_UP(reserved[index].end, PAGE_SIZE);
+                index = (size_t)-1;
+            }
+        }
+
+        if ((u64)candidate + size <= end)
+            return candidate;
+    }
+
+    return 0;
+}
+
+/* Gives every chunk touching [start_pfn, end_pfn) 'state' */
+static void __init frame_chunks_mark(uintptr_t start_pfn, uintptr_t end_pfn, u8 state)
+{
+    uintptr_t chunk;
+
+    for (chunk = start_pfn >> FRAME_CHUNK_SHIFT; chunk < frame_chunks_count && chunk << FRAME_CHUNK_SHIFT < end_pfn;
+         chunk++)
+        frame_chunks[chunk] = state;
+
+    return;
+}
+
+/* Releases the available memory of the eager chunks in [from_pfn, to_pfn) into the boot pool */
+static void __init frame_release_eager(const struct mb2_info_tag__memory_map *memory_map, uintptr_t from_pfn,
+                                       uintptr_t to_pfn)
+{
+    const struct mb2_info_tag__memory_map__entry *entry;
+
+    for (entry = memory_map->entries;
+         (const u8 *)entry < (const u8 *)memory_map + memory_map->size;
+         entry = (const struct mb2_info_tag__memory_map__entry *)((const u8 *)entry + memory_map->entry_size))
+    {
+        u64 start_pfn = MAX((entry->base_addr + PAGE_SIZE - 1) >> PAGE_SHIFT, (u64)from_pfn);
+        u64 end_pfn = MIN((entry->base_addr + entry->length) >> PAGE_SHIFT, (u64)to_pfn);
+        uintptr_t pfn;
+
+        if (entry->type != MB2_INFO_TAG__MEMORY_MAP__ENTRY__TYPE__MEMORY_AVAILABLE || start_pfn >= end_pfn)
+            continue;
+
+        for (pfn = (uintptr_t)start_pfn; pfn < (uintptr_t)end_pfn;)
+        {
+            uintptr_t next = MIN(ALIGN_UP(pfn + 1, FRAME_CHUNK_FRAMES), (uintptr_t)end_pfn);
+
+            if (frame_chunks[pfn >> FRAME_CHUNK_SHIFT] == FRAME_CHUNK__EAGER)
+                frame_pool_release(&frame_nodes[0].pool, pfn, next);
+            pfn = next;
+        }
+    }
+
+    return;
+}
+
+static void __init frame_reserve_boot(const struct frame_range *reserved, size_t reserved_count)
+{
+    size_t index;
+
+    frame_pool_reserve(&frame_nodes[0].pool, 0, FRAME_LOW_MEMORY_END >> PAGE_SHIFT);
+    for (index = 0; index < reserved_count; index++)
+        frame_pool_reserve(&frame_nodes[0].pool, reserved[index].start >> PAGE_SHIFT,
+                           (reserved[index].end + PAGE_SIZE - 1) >> PAGE_SHIFT);
+
+    return;
+}
+
+/*
+ * Maps the available memory above the boot mapping, with page tables
+ * from the memory released so far. Returns where managed memory ends:
+ * at the first range that cannot be mapped, if any.
+ */
+static uintptr_t __init frame_map_high(uintptr_t end_pfn)
+{
+    size_t index;
+    size_t kept = 0;
+
+    for (index = 0; index < frame_ranges_count; index++)
+    {
+        uintptr_t start = MAX(frame_ranges[index].start, (uintptr_t)DIRECT_MAP_END_PFN);
+
+        if (start >= frame_ranges[index].end || start >= end_pfn)
+            continue;
+
+        if (mmu_map((u64)start << PAGE_SHIFT, (size_t)(frame_ranges[index].end - start) << PAGE_SHIFT) == NULL)
+        {
+            printk("frame: cannot map memory from pfn %lx, ignoring it\n", (unsigned long)start);
+            end_pfn = start;
+        }
+    }
+
+    for (index = 0; index < frame_ranges_count; index++)
+    {
+        if (frame_ranges[index].start >= end_pfn)
+            continue;
+        frame_ranges[kept].start = frame_ranges[index].start;
+        frame_ranges[kept++].end = MIN(frame_ranges[index].end, end_pfn);
+    }
+    frame_ranges_count = kept;
+
+    return end_pfn;
+}
+
+/* Available frames of 'chunk' */
+static size_t __init frame_chunk_available(uintptr_t chunk)
+{
+    uintptr_t start = chunk << FRAME_CHUNK_SHIFT;
+    uintptr_t end = start + FRAME_CHUNK_FRAMES;
+    size_t frames = 0;
+    size_t index;
+
+    for (index = 0; index < frame_ranges_count; index++)
+    {
+        uintptr_t from = MAX(frame_ranges[index].start, start);
+        uintptr_t to = MIN(frame_ranges[index].end, end);
+
+        if (from < to)
+            frames += to - from;
+    }
+
+    return frames;
+}
+
+int __init frame_init(const struct boot_info *info)
+{
+    const struct mb2_info_tag__memory_map *memory_map = info->memory_map;
+    const struct mb2_info_tag__memory_map__entry *entry;
+    struct frame_range reserved[FRAME_MAX_RESERVED];
+    size_t reserved_count = 0;
+    uintptr_t end_pfn = 0;
+    uintptr_t direct_end_pfn;
+    uintptr_t bitmap;
+    size_t bitmap_size;
+    uintptr_t chunk;
+    size_t index;
+
+    if (memory_map == NULL)
+        return -1;
+
+    for (entry = memory_map->entries;
+         (const u8 *)entry < (const u8 *)memory_map + memory_map->size;
+         entry = (const struct mb2_info_tag__memory_map__entry *)((const u8 *)entry + memory_map->entry_size))
+    {
+        u64 entry_end_pfn = (entry->base_addr + entry->length) >> PAGE_SHIFT;
+
+        if (entry->type == MB2_INFO_TAG__MEMORY_MAP__ENTRY__TYPE__MEMORY_AVAILABLE)
+            end_pfn = MAX(end_pfn, (uintptr_t)MIN(entry_end_pfn, (u64)MEMORY_END_PFN));
+    }
+    direct_end_pfn = MIN(end_pfn, (uintptr_t)DIRECT_MAP_END_PFN);
+
+    reserved[reserved_count].start = (uintptr_t)_kernel_start;
+    reserved[reserved_count++].end = (uintptr_t)_kernel_end;
+    reserved[reserved_count].start = info->mb2_info_start;
+    reserved[reserved_count++].end = info->mb2_info_end;
+    for (index = 0; index < info->module_count; index++)
+    {
+        reserved[reserved_count].start = info->modules[index].start;
+        reserved[reserved_count++].end = info->modules[index].end;
+    }
+
+    /* The bitmap covers all managed memory but must itself be reachable from the start */
+    bitmap_size = frame_pool_bitmap_size(0, end_pfn);
+    bitmap = frame_bitmap_place(memory_map, direct_end_pfn << PAGE_SHIFT, reserved, reserved_count, bitmap_size);
+    if (bitmap == 0)
+        return -1;
+
+    frame_pool_init(&frame_nodes[0].pool, 0, end_pfn, (u32 *)bitmap);
+
+    /*
+     * Chunks holding something are released now, and so is memory the
+     * range table has no room for; the rest is left to frame_init_parallel()
+     * and later. Reserving the bitmap with the rest keeps it out of the pool.
+     */
+    reserved[reserved_count].start = bitmap;
+    reserved[reserved_count++].end = bitmap + bitmap_size;
+
+    frame_chunks_count = (end_pfn + FRAME_CHUNK_FRAMES - 1) >> FRAME_CHUNK_SHIFT;
+    frame_chunks_mark(0, FRAME_LOW_MEMORY_END >> PAGE_SHIFT, FRAME_CHUNK__EAGER);
+    for (index = 0; index < reserved_count; index++)
+        frame_chunks_mark(reserved[index].start >> PAGE_SHIFT, (reserved[index].end + PAGE_SIZE - 1) >> PAGE_SHIFT,
+                          FRAME_CHUNK__EAGER);
+
+    for (entry = memory_map->entries;
+         (const u8 *)entry < (const u8 *)memory_map + memory_map->size;
+         entry = (const struct mb2_info_tag__memory_map__entry *)((const u8 *)entry + memory_map->entry_size))
+    {
+        u64 start_pfn = (entry->base_addr + PAGE_SIZE - 1) >> PAGE_SHIFT;
+        u64 entry_end_pfn = MIN((entry->base_addr + entry->length) >> PAGE_SHIFT, (u64)end_pfn);
+
+        if (entry->type != MB2_INFO_TAG__MEMORY_MAP__ENTRY__TYPE__MEMORY_AVAILABLE || start_pfn >= entry_end_pfn)
+            continue;
+
+        if (frame_ranges_count < FRAME_MAX_RANGES)
+        {
+            frame_ranges[frame_ranges_count].start = (uintptr_t)start_pfn;
+            frame_ranges[frame_ranges_count++].end = (uintptr_t)entry_end_pfn;
+        }
+        else
+        {
+            frame_chunks_mark((uintptr_t)start_pfn, (uintptr_t)entry_end_pfn, FRAME_CHUNK__EAGER);
+        }
+    }
+
+    /* Memory above the boot mapping needs page tables, which come from below it */
+    frame_release_eager(memory_map, 0, direct_end_pfn);
+    frame_reserve_boot(reserved, reserved_count);
+    frame_managed_end_pfn = direct_end_pfn;
+    if (end_pfn > direct_end_pfn)
+    {
+        frame_managed_end_pfn = frame_map_high(end_pfn);
+        frame_release_eager(memory_map, direct_end_pfn, frame_managed_end_pfn);
+        frame_reserve_boot(reserved, reserved_count);
+    }
+
+    for (chunk = 0; chunk < frame_chunks_count; chunk++)
+    {
+        size_t frames = frame_chunks[chunk] == FRAME_CHUNK__EAGER ? 0 : frame_chunk_available(chunk);
+
+        frame_chunks[chunk] = frames != 0 ? FRAME_CHUNK__PENDING : FRAME_CHUNK__DONE;
+        frame_chunk_frames[chunk] = (u16)frames;
+        frame_pending_frames += frames;
+    }
+
+    frame_nodes[0].total_frames = frame_nodes[0].pool.free_frames;
+
+    printk("frame: %zu free frames (%zu KiB) below pfn %lx, %zu MiB left for later\n",
+           frame_nodes[0].pool.free_frames, frame_nodes[0].pool.free_frames * (PAGE_SIZE / 1024),
+           (unsigned long)end_pfn, frame_pending_frames >> (20 - PAGE_SHIFT));
+
+    return 0;
+}
+
+/* Returns the node owning 'pfn' and sets '*run_end' to where, before 'end', that may change */
+static u32 frame_pfn_node_run(uintptr_t pfn, uintptr_t end, uintptr_t *run_end)
+{
+    u32 node = 0;
+    bool found = false;
+    size_t index;
+
+    for (index = 0; index < frame_node_ranges_count; index++)
+    {
+        const struct frame_node_range *range = &frame_node_ranges[index];
+
+        if (pfn >= range->start_pfn && pfn < range->end_pfn)
+        {
+            if (!found)
+                node = range->node;
+            found = true;
+            end = MIN(end, range->end_pfn);
+        }
+        else if (range->start_pfn > pfn)
+        {
+            end = MIN(end, range->start_pfn);
+        }
+    }
+
+    *run_end = end;
+
+    /* Memory the SRAT does not describe belongs to node 0 */
+    return node;
+}
+
+/* Pool that owns 'pfn' right now: node 0 until the node pools are installed */
+static inline u32 frame_pfn_node(uintptr_t pfn)
+{
+    uintptr_t run_end;
+    u32 node = frame_pfn_node_run(pfn, pfn + 1, &run_end);
+
+    return node < frame_nodes_count ? node : 0;
+}
+
+/* Bits for the available frames of 'node''s pool in the bitmap word starting at 'pfn', below 'end' */
+static u32 frame_chunk_word(u32 node, uintptr_t pfn, uintptr_t end)
+{
+    u32 mask = 0;
+    size_t index;
+
+    end = MIN(end, pfn + 32);
+    for (index = 0; index < frame_ranges_count; index++)
+    {
+        uintptr_t from = MAX(frame_ranges[index].start, pfn);
+        uintptr_t to = MIN(frame_ranges[index].end, end);
+
+        while (from < to)
+        {
+            uintptr_t run_end;
+            u32 owner = frame_pfn_node_run(from, to, &run_end);
+
+            if ((owner < frame_nodes_count ? owner : 0) == node)
+                mask |= frame_bits(from - pfn, run_end - from);
+            from = run_end;
+        }
+    }
+
+    return mask;
+}
+
+/*
+ * Releases the available frames of a pending chunk. Nothing has touched
+ * its bits since frame_pool_init() set them all, so each word is computed
+ * and stored once without the pool lock: allocators may take the frames
+ * as soon as they see them, and only the counts need the lock.
+ */
+static void frame_chunk_release(uintptr_t chunk)
+{
+    uintptr_t start = chunk << FRAME_CHUNK_SHIFT;
+    uintptr_t end = start + FRAME_CHUNK_FRAMES;
+    u32 node;
+
+    for (node = 0; node < frame_nodes_count; node++)
+    {
+        struct frame_node *home = &frame_nodes[node];
+        struct frame_pool *pool = &home->pool;
+        uintptr_t last = MIN(end, pool->end_pfn);
+        size_t released = 0;
+        uintptr_t pfn;
+
+        for (pfn = MAX(start, pool->start_pfn); pfn < last; pfn += 32)
+        {
+            u32 mask = frame_chunk_word(node, pfn, last);
+
+            if (mask != 0)
+            {
+                __atomic_store_n(&pool->bitmap[(pfn - pool->start_pfn) / 32], ~mask, __ATOMIC_RELAXED);
+                released += frame_hweight32(mask);
+            }
+        }
+
+        if (released != 0)
+        {
+            spin_lock(&pool->lock);
+            pool->free_frames += released;
+            home->total_frames += released;
+            spin_unlock(&pool->lock);
+        }
+    }
+
+    return;
+}
+
+/* Initialises 'chunk' if it is still pending; false when it was not */
+static bool frame_chunk_init(uintptr_t chunk)
+{
+    u8 expected = FRAME_CHUNK__PENDING;
+    uintptr_t flags;
+
+    if (!__atomic_compare_exchange_n(&frame_chunks[chunk], &expected, FRAME_CHUNK__BUSY, false, __ATOMIC_ACQUIRE,
+                                     __ATOMIC_RELAXED))
+        return false;
+
+    /* An allocation from an interrupt handler on this CPU must not wait for the chunk */
+    flags = interrupts_save();
+    frame_chunk_release(chunk);
+    __atomic_fetch_sub(&frame_pending_frames, frame_chunk_frames[chunk], __ATOMIC_RELEASE);
+    __atomic_store_n(&frame_chunks[chunk], FRAME_CHUNK__DONE, __ATOMIC_RELEASE);
+    interrupts_restore(flags);
+
+    return true;
+}
+
+/* Makes sure no chunk touching [start_pfn, end_pfn) is pending, for bitmap changes outside allocation */
+static void frame_chunks_settle(uintptr_t start_pfn, uintptr_t end_pfn)
+{
+    uintptr_t chunk;
+
+    for (chunk = start_pfn >> FRAME_CHUNK_SHIFT; chunk < frame_chunks_count && chunk << FRAME_CHUNK_SHIFT < end_pfn;
+         chunk++)
+    {
+        while (!frame_chunk_init(chunk) && __atomic_load_n(&frame_chunks[chunk], __ATOMIC_ACQUIRE) != FRAME_CHUNK__DONE)
+            cpu_relax();
+    }
+
+    return;
+}
+
+bool frame_init_deferred(void)
+{
+    uintptr_t chunk;
+
+    if (__atomic_load_n(&frame_pending_frames, __ATOMIC_ACQUIRE) == 0)
+        return false;
+
+    while ((chunk = __atomic_fetch_add(&frame_chunk_cursor, 1, __ATOMIC_RELAXED)) < frame_chunks_count)
+        if (frame_chunk_init(chunk))
+            return true;
+
+    return false;
+}
+
+static void __init frame_init_boot_chunks(void *data)
+{
+    size_t chunks;
+
+    (void)data;
+
+    for (chunks = 0; chunks < FRAME_BOOT_CHUNKS && frame_init_deferred(); chunks++)
+        ;
+
+    return;
+}
+
+void __init frame_init_parallel(void)
+{
+    size_t pending = frame_pending_frames;
+    u64 start = rdtsc();
+
+    smp_run(frame_init_boot_chunks, NULL);
+    smp_idle_register(frame_init_deferred);
+
+    printk("frame: %zu MiB initialised on %u CPUs in %llu us, %zu MiB deferred\n",
+           (pending - frame_pending_frames) >> (20 - PAGE_SHIFT), smp_cpus_online(),
+           (unsigned long long)div_u64(tsc_cycles_to_ns(rdtsc() - start), 1000),
+           frame_pending_frames >> (20 - PAGE_SHIFT));
+
+    return;
+}
+
+/* Orders every node by its SLIT distance from 'node'; ties keep node order */
+static void __init frame_node_fallback(u32 node)
+{
+    struct frame_node *home = &frame_nodes[node];
+    u32 index;
+
+    home->fallback_count = 0;
+    for (index = 0; index < frame_nodes_count; index++)
+    {
+        u32 position = home->fallback_count++;
+        u8 distance = index == node ? 0 : acpi_topology.distance[node][index];
+
+        while (position > 0)
+        {
+            u32 previous = home->fallback[position - 1];
+            u8 previous_distance = previous == node ? 0 : acpi_topology.distance[node][previous];
+
+            if (previous_distance <= distance)
+                break;
+            home->fallback[position] = previous;
+            position--;
+        }
+        home->fallback[position] = index;
+    }
+
+    return;
+}
+
+/* Calls 'visit' for every run of available memory below the managed limit, with its node */
+static void __init frame_numa_walk(const struct boot_info *info, uintptr_t end_pfn,
+                            void (*visit)(u32 node, uintptr_t start_pfn, uintptr_t end_pfn, void *data), void *data)
+{
+    const struct mb2_info_tag__memory_map *memory_map = info->memory_map;
+    const struct mb2_info_tag__memory_map__entry *entry;
+
+    for (entry = memory_map->entries;
+         (const u8 *)entry < (const u8 *)memory_map + memory_map->size;
+         entry = (const struct mb2_info_tag__memory_map__entry *)((const u8 *)entry + memory_map->entry_size))
+    {
+        u64 start = (entry->base_addr + PAGE_SIZE - 1) >> PAGE_SHIFT;
+        u64 end = MIN((entry->base_addr + entry->length) >> PAGE_SHIFT, (u64)end_pfn);
+        uintptr_t pfn;
+
+        if (entry->type != MB2_INFO_TAG__MEMORY_MAP__ENTRY__TYPE__MEMORY_AVAILABLE || start >= end)
+            continue;
+
+        for (pfn = (uintptr_t)start; pfn < (uintptr_t)end;)
+        {
+            uintptr_t run_end;
+            u32 node = frame_pfn_node_run(pfn, (uintptr_t)end, &run_end);
+
+            visit(node, pfn, run_end, data);
+            pfn = run_end;
+        }
+    }
+
+    return;
+}
+
+static void __init frame_numa_span(u32 node, uintptr_t start_pfn, uintptr_t end_pfn, void *data)
+{
+    struct frame_range *spans = data;
+
+    spans[node].start = MIN(spans[node].start, start_pfn);
+    spans[node].end = MAX(spans[node].end, end_pfn);
+
+    return;
+}
+
+/* Hands the frames still free in the boot pool over to the owning node's pool */
+static void __init frame_numa_copy(u32 node, uintptr_t start_pfn, uintptr_t end_pfn, void *data)
+{
+    const struct frame_pool *boot = data;
+    struct frame_pool *pool = &frame_nodes[node].pool;
+    uintptr_t pfn;
+
+    for (pfn = start_pfn; pfn < end_pfn; pfn++)
+    {
+        /* Pending chunks are still all used in both bitmaps, as frame_chunk_release() expects */
+        if (frame_chunks[pfn >> FRAME_CHUNK_SHIFT] != FRAME_CHUNK__DONE)
+        {
+            pfn = ALIGN_UP(pfn + 1, FRAME_CHUNK_FRAMES) - 1;
+            continue;
+        }
+
+        if (!frame_test(boot, pfn))
+        {
+            frame_clear(pool, pfn);
+            pool->free_frames++;
+        }
+    }
+
+    return;
+}
+
+int __init frame_numa_init(const struct boot_info *info)
+{
+    struct frame_pool boot = frame_nodes[0].pool;
+    struct frame_pool pools[FRAME_MAX_NODES];
+    struct frame_range spans[FRAME_MAX_NODES];
+    u32 node_count = MIN(acpi_topology.node_count, (u32)FRAME_MAX_NODES);
+    size_t boot_bitmap_frames = ALIGN_UP(frame_pool_bitmap_size(boot.start_pfn, boot.end_pfn), PAGE_SIZE) / PAGE_SIZE;
+    size_t index;
+    u32 node;
+
+    /* frame_current_node() may have cached node 0 from before the topology was known */
+    memset(frame_cpu_nodes_valid, 0, sizeof(frame_cpu_nodes_valid));
+
+    if (node_count <= 1 || acpi_topology.memory_count == 0)
+        return 0;
+
+    for (index = 0; index < acpi_topology.memory_count; index++)
+    {
+        const struct acpi_topology__memory *memory = &acpi_topology.memory[index];
+        u64 start_pfn = memory->base >> PAGE_SHIFT;
+        u64 end_pfn = MIN((memory->base + memory->length) >> PAGE_SHIFT, (u64)boot.end_pfn);
+
+        if (start_pfn >= end_pfn || memory->node >= node_count)
+            continue;
+
+        frame_node_ranges[frame_node_ranges_count].start_pfn = (uintptr_t)start_pfn;
+        frame_node_ranges[frame_node_ranges_count].end_pfn = (uintptr_t)end_pfn;
+        frame_node_ranges[frame_node_ranges_count].node = memory->node;
+        frame_node_ranges_count++;
+    }
+
+    for (node = 0; node < node_count; node++)
+    {
+        spans[node].start = ~(uintptr_t)0;
+        spans[node].end = 0;
+    }
+    frame_numa_walk(info, boot.end_pfn, frame_numa_span, spans);
+
+    /* Node bitmaps come out of the boot pool, so the copy below sees them as used */
+    for (node = 0; node < node_count; node++)
+    {
+        uintptr_t bitmap;
+
+        if (spans[node].start >= spans[node].end)
+        {
+            /* A node with CPUs but no memory: every allocation falls back */
+            frame_pool_init(&pools[node], 0, 0, NULL);
+            continue;
+        }
+
+        bitmap = frame_pool_alloc(&frame_nodes[0].pool,
+                                  ALIGN_UP(frame_pool_bitmap_size(spans[node].start, spans[node].end),
+                                           PAGE_SIZE) / PAGE_SIZE);
+        if (bitmap == 0)
+        {
+            frame_node_ranges_count = 0;
+            return -1;
+        }
+
+        frame_pool_init(&pools[node], spans[node].start, spans[node].end, phys_to_virt(bitmap << PAGE_SHIFT));
+    }
+
+    boot = frame_nodes[0].pool;
+    frame_nodes_count = node_count;
+    for (node = 0; node < node_count; node++)
+        frame_nodes[node].pool = pools[node];
+
+    frame_numa_walk(info, boot.end_pfn, frame_numa_copy, &boot);
+
+    for (node = 0; node < node_count; node++)
+    {
+        frame_node_fallback(node);
+        frame_nodes[node].total_frames = frame_nodes[node].pool.free_frames;
+    }
+
+    /* The boot pool's bitmap is now ordinary free memory */
+    frame_free_contig(virt_to_phys(boot.bitmap), boot_bitmap_frames);
+
+    for (node = 0; node < node_count; node++)
+        printk("frame: node %u pfn %lx-%lx, %zu free frames\n", node,
+               (unsigned long)frame_nodes[node].pool.start_pfn, (unsigned long)frame_nodes[node].pool.end_pfn,
+               frame_nodes[node].pool.free_frames);
+
+    return 0;
+}
+
+u32 frame_node_count(void)
+{
+    return frame_nodes_count;
+}
+
+u32 frame_node_of(uintptr_t addr)
+{
+    return frame_pfn_node(addr >> PAGE_SHIFT);
+}
+
+u32 frame_current_node(void)
+{
+    u32 cpu = cpu_index();
+    u32 apic_id;
+    size_t index;
+
+    if (frame_cpu_nodes_valid[cpu])
+        return frame_cpu_nodes[cpu];
+
+    apic_id = cpu_apic_id();
+    frame_cpu_nodes[cpu] = 0;
+    for (index = 0; index < acpi_topology.cpu_count; index++)
+        if (acpi_topology.cpus[index].apic_id == apic_id && acpi_topology.cpus[index].node < frame_nodes_count)
+            frame_cpu_nodes[cpu] = acpi_topology.cpus[index].node;
+    frame_cpu_nodes_valid[cpu] = true;
+
+    return frame_cpu_nodes[cpu];
+}
+
+uintptr_t frame_alloc_node(u32 node, size_t count)
+{
+    struct frame_node *home = &frame_nodes[node < frame_nodes_count ? node : 0];
+    u32 index;
+
+    for (;;)
+    {
+        for (index = 0; index < home->fallback_count; index++)
+        {
+            u32 target = home->fallback[index];
+            uintptr_t pfn = frame_pool_alloc(&frame_nodes[target].pool, count);
+
+            if (pfn != 0)
+            {
+                if (target == (u32)(home - frame_nodes))
+                    __atomic_fetch_add(&home->local_allocs, 1, __ATOMIC_RELAXED);
+                else
+                    __atomic_fetch_add(&home->remote_allocs, 1, __ATOMIC_RELAXED);
+                trace_point(TRACE_EVENT__PAGE_ALLOC, count, pfn << PAGE_SHIFT);
+                return pfn << PAGE_SHIFT;
+            }
+        }
+
+        /* Out of initialised memory: do a deferred chunk, or wait for the CPU doing the last ones */
+        if (__atomic_load_n(&frame_pending_frames, __ATOMIC_ACQUIRE) == 0)
+            return 0;
+        if (!frame_init_deferred())
+            cpu_relax();
+    }
+}
+
+uintptr_t frame_alloc(void)
+{
+    return frame_alloc_node(frame_current_node(), 1);
+}
+
+uintptr_t frame_alloc_contig(size_t count)
+{
+    return frame_alloc_node(frame_current_node(), count);
+}
+
+void frame_free(uintptr_t addr)
+{
+    uintptr_t pfn = addr >> PAGE_SHIFT;
+
+    trace_point(TRACE_EVENT__PAGE_FREE, 1, addr);
+    frame_pool_free(&frame_nodes[frame_pfn_node(pfn)].pool, pfn, 1);
+
+    return;
+}
+
+void frame_free_contig(uintptr_t addr, size_t count)
+{
+    uintptr_t pfn = addr >> PAGE_SHIFT;
+    uintptr_t end = pfn + count;
+
+    trace_point(TRACE_EVENT__PAGE_FREE, count, addr);
+
+    while (pfn < end)
+    {
+        uintptr_t run_end;
+        u32 node = frame_pfn_node_run(pfn, end, &run_end);
+
+        frame_pool_free(&frame_nodes[node < frame_nodes_count ? node : 0].pool, pfn, run_end - pfn);
+        pfn = run_end;
+    }
+
+    return;
+}
+
+size_t frame_release(uintptr_t start, uintptr_t end)
+{
+    uintptr_t pfn = ALIGN_UP(start, PAGE_SIZE) >> PAGE_SHIFT;
+    uintptr_t end_pfn = MIN(end >> PAGE_SHIFT, frame_managed_end_pfn);
+    size_t released = 0;
+
+    if (pfn < end_pfn)
+        frame_chunks_settle(pfn, end_pfn);
+
+    while (pfn < end_pfn)
+    {
+        uintptr_t run_end;
+        u32 node = frame_pfn_node_run(pfn, end_pfn, &run_end);
+
+        released += frame_pool_release(&frame_nodes[node < frame_nodes_count ? node : 0].pool, pfn, run_end);
+        pfn = run_end;
+    }
+
+    return released;
+}
+
+uintptr_t frame_managed_end(void)
+{
+    return frame_managed_end_pfn << PAGE_SHIFT;
+}
+
+size_t frame_free_count(void)
+{
+    size_t free_frames = frame_pending_frames;
+    u32 node;
+
+    for (node = 0; node < frame_nodes_count; node++)
+        free_frames += frame_nodes[node].pool.free_frames;
+
+    return free_frames;
+}
+
+int frame_node_stats(u32 node, struct frame_node_stats *stats)
+{
+    if (node >= frame_nodes_count)
+        return -1;
+
+    stats->total_frames = frame_nodes[node].total_frames;
+    stats->free_frames = frame_nodes[node].pool.free_frames;
+    stats->local_allocs = frame_nodes[node].local_allocs;
+    stats->remote_allocs = frame_nodes[node].remote_allocs;
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <types.h>
+#include <arch/arch.h>
+#include <arch/cpu.h>
+#include <boot/init.h>
+#include <lib/printk.h>
+#include <lib/spinlock.h>
+#include <lib/string.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+#include <mm/prezero.h>
+#include <smp/smp.h>
+
+#define CPUID_1_EDX__SSE2   ((u32)1 << 26)
+
+struct prezero_stack
+{
+    spinlock_t lock;
+    size_t count;
+    uintptr_t frames[PREZERO_FRAMES];
+};
+
+static struct prezero_stack prezero_stacks[FRAME_MAX_NODES];
+static bool prezero_nontemporal;
+static bool prezero_enabled;
+
+/* MOVNTI goes around the cache; the SFENCE orders it before the frame is handed out */
+static void prezero_clear(void *page)
+{
+    uintptr_t *word = page;
+    uintptr_t *end = word + PAGE_SIZE / sizeof(*word);
+
+    if (!prezero_nontemporal)
+    {
+        memset(page, 0, PAGE_SIZE);
+        return;
+    }
+
+    for (; word < end; word++)
+        __asm__ volatile ("movnti %1, %0" : "=m"(*word) : "r"((uintptr_t)0));
+    __asm__ volatile ("sfence" : : : "memory");
+
+    return;
+}
+
+/* Idle work: zeroes one more frame for this CPU's node */
+static bool prezero_refill(void)
+{
+    struct prezero_stack *stack = &prezero_stacks[frame_current_node()];
+    uintptr_t frame;
+
+    if (__atomic_load_n(&stack->count, __ATOMIC_RELAXED) >= PREZERO_FRAMES)
+        return false;
+
+    frame = frame_alloc();
+    if (frame == 0)
+        return false;
+
+    prezero_clear(phys_to_virt(frame));
+
+    spin_lock(&stack->lock);
+    if (stack->count < PREZERO_FRAMES)
+    {
+        stack->frames[stack->count++] = frame;
+        frame = 0;
+    }
+    spin_unlock(&stack->lock);
+
+    if (frame != 0)
+        frame_free(frame);
+
+    return true;
+}
+
+int __init prezero_init(void)
+{
+    u32 eax, ebx, ecx, edx;
+
+    /* Every x86_64 CPU has SSE2 */
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    prezero_nontemporal = ARCH_BITS == 64 || (edx & CPUID_1_EDX__SSE2);
+
+    if (smp_idle_register(prezero_refill))
+        return -1;
+    prezero_enabled = true;
+
+    printk("prezero: %u frames per node, %s stores\n", PREZERO_FRAMES,
+           prezero_nontemporal ? "non-temporal" : "cached");
+
+    return 0;
+}
+
+uintptr_t prezero_alloc(void)
+{
+    struct prezero_stack *stack = &prezero_stacks[frame_current_node()];
+    uintptr_t frame = 0;
+    size_t count;
+
+    spin_lock(&stack->lock);
+    if (stack->count != 0)
+        frame = stack->frames[--stack->count];
+    count = stack->count;
+    spin_unlock(&stack->lock);
+
+    if (prezero_enabled && count < PREZERO_LOW)
+        smp_wake_idle();
+    if (frame != 0)
+        return frame;
+
+    frame = frame_alloc();
+    if (frame != 0)
+        memset(phys_to_virt(frame), 0, PAGE_SIZE);
+
+    return frame;
+}
@@ -0,0 +1,117 @@
+#include <types.h>
+#include <arch/arch.h>
+#include <boot/bootloader.h>
+#include <boot/init.h>
+#include <boot/multiboot2.h>
+#include <lib/printk.h>
+#include <lib/util.h>
+#include <mm/frame.h>
+#include <mm/reclaim.h>
+
+extern u8 _kernel_start[];
+extern u8 _kernel_end[];
+
+static inline size_t reclaim_kib(size_t frames)
+{
+    return frames * (PAGE_SIZE / 1024);
+}
+
+/*
+ * Releases [start, end) minus low memory, the kernel image and anything
+ * the Multiboot2 map already reported as available: that memory has been
+ * in the allocator since frame_init() and may be in use.
+ */
+static size_t reclaim_range(const struct mb2_info_tag__memory_map *memory_map,
+                            const struct mb2_info_tag__memory_map__entry *from, u64 start, u64 end)
+{
+    const struct mb2_info_tag__memory_map__entry *entry;
+
+    /* Nothing below 1MB or past the managed end, which also keeps "end" representable in a uintptr_t */
+    start = MAX(start, (u64)FRAME_LOW_MEMORY_END);
+    end = MIN(end, (u64)frame_managed_end());
+    if (start >= end)
+        return 0;
+
+    if (start < (uintptr_t)_kernel_end && (uintptr_t)_kernel_start < end)
+        return reclaim_range(memory_map, from, start, (uintptr_t)_kernel_start) +
+               reclaim_range(memory_map, from, (uintptr_t)_kernel_end, end);
+
+    for (entry = from;
+         (const u8 *)entry < (const u8 *)memory_map + memory_map->size;
+         entry = (const struct mb2_info_tag__memory_map__entry *)((const u8 *)entry + memory_map->entry_size))
+    {
+        const struct mb2_info_tag__memory_map__entry *next =
+            (const struct mb2_info_tag__memory_map__entry *)((const u8 *)entry + memory_map->entry_size);
+
+        if (entry->type != MB2_INFO_TAG__MEMORY_MAP__ENTRY__TYPE__MEMORY_AVAILABLE ||
+            entry->base_addr >= end || entry->base_addr + entry->length <= start)
+            continue;
+
+        return reclaim_range(memory_map, next, start, entry->base_addr) +
+               reclaim_range(memory_map, next, entry->base_addr + entry->length, end);
+    }
+
+    return frame_release((uintptr_t)start, (uintptr_t)end);
+}
+
+/* EFI boot-services and loader memory is dead once ExitBootServices() has run */
+static size_t reclaim_efi(const struct boot_info *info)
+{
+    const struct mb2_info_tag__efi_memory_map *efi_map = info->efi_memory_map;
+    const u8 *cursor;
+    size_t released = 0;
+
+    if (efi_map == NULL || info->memory_map == NULL || info->efi_boot_services || efi_map->descriptor_size == 0)
+        return 0;
+
+    for (cursor = efi_map->efi_memory_map;
+         cursor + sizeof(struct mb2_info_tag__efi_memory_map__descriptor) <= (const u8 *)efi_map + efi_map->size;
+         cursor += efi_map->descriptor_size)
+    {
+        const struct mb2_info_tag__efi_memory_map__descriptor *descriptor = (const void *)cursor;
+        u64 end = descriptor->physical_start + (descriptor->page_count << MB2_INFO_TAG__EFI_MEMORY_MAP__PAGE_SHIFT);
+
+        switch (descriptor->type)
+        {
+            case MB2_INFO_TAG__EFI_MEMORY_MAP__TYPE__BOOT_SERVICES_CODE:
+            case MB2_INFO_TAG__EFI_MEMORY_MAP__TYPE__BOOT_SERVICES_DATA:
+            case MB2_INFO_TAG__EFI_MEMORY_MAP__TYPE__LOADER_DATA:
+                released += reclaim_range(info->memory_map, info->memory_map->entries,
+                                          descriptor->physical_start, end);
+                break;
+            default:
+                break;
+        }
+    }
+
+    return released;
+}
+
+void reclaim_boot_memory(struct boot_info *info)
+{
+    size_t efi = reclaim_efi(info);
+    size_t modules = 0;
+    size_t mb2_info;
+    size_t init;
+    size_t index;
+
+    for (index = 0; index < info->module_count; index++)
+        modules += frame_release(info->modules[index].start, info->modules[index].end);
+    info->module_count = 0;
+
+    /* Everything below points into the Multiboot2 information */
+    info->boot_loader_name = NULL;
+    info->memory_map = NULL;
+    info->efi_memory_map = NULL;
+    info->acpi_rsdp = NULL;
+    mb2_info = frame_release(info->mb2_info_start, info->mb2_info_end);
+    info->mb2_info_start = 0;
+    info->mb2_info_end = 0;
+
+    init = frame_release((uintptr_t)_init_start, (uintptr_t)_init_end);
+
+    printk("reclaim: %zu KiB efi, %zu KiB boot information, %zu KiB modules, %zu KiB init\n",
+           reclaim_kib(efi), reclaim_kib(mb2_info), reclaim_kib(modules), reclaim_kib(init));
+
+    return;
+}
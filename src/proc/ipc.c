@@ -0,0 +1,463 @@
+#include <types.h>
+#include <arch/arch.h>
+#include <lib/spinlock.h>
+#include <lib/string.h>
+#include <lib/util.h>
+#include <mm/cow.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+#include <mm/prezero.h>
+#include <proc/ipc.h>
+#include <proc/process.h>
+
+struct ipc_port
+{
+    bool used;
+    struct process *owner;
+    struct process *receiver;           /* the owner, while blocked waiting for a call */
+    struct ipc_message *receive_buffer;
+    struct process *reply_to;           /* caller whose message the owner took and has not answered */
+    struct process *callers;            /* callers that found the owner busy, FIFO by 'next' */
+    struct process *callers_tail;
+    uintptr_t window;
+    size_t window_size;
+};
+
+static struct ipc_port ipc_ports[IPC_PORTS];
+static spinlock_t ipc_lock = SPINLOCK_INIT;
+
+static struct ipc_port *ipc_port(u32 port)
+{
+    if (port >= IPC_PORTS || !ipc_ports[port].used)
+        return NULL;
+
+    return &ipc_ports[port];
+}
+
+/* Port 'port' if the running process owns it */
+static struct ipc_port *ipc_owned_port(u32 port)
+{
+    struct ipc_port *entry = ipc_port(port);
+
+    if (entry == NULL || entry->owner == NULL || entry->owner != process_current())
+        return NULL;
+
+    return entry;
+}
+
+int ipc_port_create(void)
+{
+    int port = -1;
+    u32 index;
+
+    spin_lock(&ipc_lock);
+    for (index = 0; index < IPC_PORTS; index++)
+    {
+        if (!ipc_ports[index].used)
+        {
+            memset(&ipc_ports[index], 0, sizeof(ipc_ports[index]));
+            ipc_ports[index].used = true;
+            port = (int)index;
+            break;
+        }
+    }
+    spin_unlock(&ipc_lock);
+
+    return port;
+}
+
+int ipc_port_bind(u32 port, struct process *owner)
+{
+    struct ipc_port *entry = ipc_port(port);
+
+    if (entry == NULL || entry->owner != NULL)
+        return -1;
+
+    entry->owner = owner;
+
+    return 0;
+}
+
+static void ipc_fail(struct process *process)
+{
+    process->ipc_status = -1;
+    process_wake(process);
+
+    return;
+}
+
+/* Fails the pending caller and everyone queued, and forgets the owner */
+static void ipc_port_reset(struct ipc_port *entry)
+{
+    struct process *caller;
+
+    if (entry->reply_to != NULL)
+        ipc_fail(entry->reply_to);
+
+    while ((caller = entry->callers) != NULL)
+    {
+        entry->callers = caller->next;
+        caller->next = NULL;
+        ipc_fail(caller);
+    }
+
+    entry->callers_tail = NULL;
+    entry->reply_to = NULL;
+    entry->receiver = NULL;
+    entry->receive_buffer = NULL;
+    entry->owner = NULL;
+
+    return;
+}
+
+void ipc_port_destroy(u32 port)
+{
+    struct ipc_port *entry = ipc_port(port);
+
+    if (entry == NULL)
+        return;
+
+    if (entry->receiver != NULL)
+        ipc_fail(entry->receiver);
+    ipc_port_reset(entry);
+
+    spin_lock(&ipc_lock);
+    entry->used = false;
+    spin_unlock(&ipc_lock);
+
+    return;
+}
+
+void ipc_process_gone(struct process *process)
+{
+    u32 index;
+
+    for (index = 0; index < IPC_PORTS; index++)
+    {
+        struct ipc_port *entry = &ipc_ports[index];
+        struct process **link;
+        struct process *prev = NULL;
+
+        if (!entry->used)
+            continue;
+
+        if (entry->owner == process)
+        {
+            ipc_port_reset(entry);
+            continue;
+        }
+
+        if (entry->reply_to == process)
+            entry->reply_to = NULL;
+
+        for (link = &entry->callers; *link != NULL; prev = *link, link = &(*link)->next)
+        {
+            if (*link == process)
+            {
+                *link = process->next;
+                if (entry->callers_tail == process)
+                    entry->callers_tail = prev;
+                process->next = NULL;
+                break;
+            }
+        }
+    }
+
+    return;
+}
+
+/* Drops whatever the owner has mapped at window page 'virt' */
+static void ipc_window_clear(struct process *owner, uintptr_t virt)
+{
+    uintptr_t frame;
+    u32 flags;
+
+    frame = mmu_unmap_user(&owner->space, virt, &flags);
+    if (frame != 0 && (flags & MMU_USER__OWNED) && cow_release(frame))
+        frame_free(frame);
+
+    return;
+}
+
+/* Frame of a writable page private to the owner at window page 'virt', mapping a zeroed one if needed */
+static uintptr_t ipc_window_frame(struct process *owner, uintptr_t virt)
+{
+    uintptr_t frame;
+    u32 flags;
+
+    frame = mmu_translate_user(&owner->space, virt, &flags);
+    if (frame != 0 && (flags & MMU_USER__COW) && process_cow_break(owner, virt) == 0)
+        frame = mmu_translate_user(&owner->space, virt, &flags);
+    if (frame != 0)
+        return (flags & MMU_USER__WRITABLE) ? frame : 0;
+
+    frame = prezero_alloc();
+    if (frame == 0)
+        return 0;
+
+    if (mmu_map_user(&owner->space, virt, frame, MMU_USER__WRITABLE | MMU_USER__OWNED))
+    {
+        frame_free(frame);
+        return 0;
+    }
+
+    return frame;
+}
+
+/* Whether the buffer [addr, addr + length) of a transfer fits 'size' bytes of window from 'addr''s page offset */
+static bool ipc_buffer_ok(uintptr_t addr, size_t length, size_t offset, size_t size)
+{
+    if (length == 0 || addr < USER_BASE || addr >= USER_END || length > USER_END - addr)
+        return false;
+
+    return offset + length <= size;
+}
+
+/*
+ * Shares the caller's pages under the buffer with the owner: both
+ * mappings become read-only copy-on-write, so neither side sees the
+ * other's later writes and no data moves until one of them writes.
+ */
+static int ipc_map(struct ipc_port *entry, struct process *sender, struct ipc_message *message)
+{
+    struct process *owner = entry->owner;
+    uintptr_t first = ALIGN_DOWN(message->w0, (uintptr_t)PAGE_SIZE);
+    uintptr_t end = message->w0 + message->w1;
+    uintptr_t page;
+
+    if (!ipc_buffer_ok(message->w0, message->w1, message->w0 & PAGE_MASK, entry->window_size))
+        return -1;
+
+    for (page = first; page < end; page += PAGE_SIZE)
+    {
+        uintptr_t dest = entry->window + (page - first);
+        uintptr_t frame;
+        u32 flags;
+
+        /* Only memory the process owns can be shared: not the time page */
+        frame = mmu_translate_user(&sender->space, page, &flags);
+        if (frame == 0 || !(flags & MMU_USER__OWNED) || cow_share(frame))
+            return -1;
+
+        ipc_window_clear(owner, dest);
+        if (mmu_map_user(&owner->space, dest, frame, MMU_USER__OWNED | MMU_USER__COW))
+        {
+            cow_release(frame);
+            return -1;
+        }
+
+        mmu_map_user(&sender->space, page, frame, MMU_USER__OWNED | MMU_USER__COW);
+    }
+
+    message->w0 = entry->window + (message->w0 & PAGE_MASK);
+
+    return 0;
+}
+
+/* Copies the buffer to the start of the window through the direct map, page by page on both sides */
+static int ipc_copy(struct ipc_port *entry, struct process *sender, struct ipc_message *message)
+{
+    struct process *owner = entry->owner;
+    size_t length = message->w1;
+    size_t done;
+
+    if (!ipc_buffer_ok(message->w0, length, 0, entry->window_size))
+        return -1;
+
+    for (done = 0; done < length; )
+    {
+        uintptr_t source = message->w0 + done;
+        size_t source_offset = source & PAGE_MASK;
+        size_t dest_offset = done & PAGE_MASK;
+        size_t chunk = MIN(MIN(PAGE_SIZE - source_offset, PAGE_SIZE - dest_offset), length - done);
+        uintptr_t from = mmu_translate_user(&sender->space, source - source_offset, NULL);
+        uintptr_t to = ipc_window_frame(owner, entry->window + done - dest_offset);
+
+        if (from == 0 || to == 0)
+            return -1;
+
+        memcpy((u8 *)phys_to_virt(to) + dest_offset, (const u8 *)phys_to_virt(from) + source_offset, chunk);
+        done += chunk;
+    }
+
+    message->w0 = entry->window;
+
+    return 0;
+}
+
+/* Hands the caller's message to the owner's 'buffer', moving the data it names; the owner then owes a reply */
+static int ipc_deliver(struct ipc_port *entry, struct process *caller, struct ipc_message *buffer)
+{
+    uintptr_t transfer = caller->ipc_message->tag & (IPC_TAG__MAP | IPC_TAG__COPY);
+    int result = 0;
+
+    *buffer = *caller->ipc_message;
+
+    if (transfer == IPC_TAG__MAP)
+        result = ipc_map(entry, caller, buffer);
+    else if (transfer == IPC_TAG__COPY)
+        result = ipc_copy(entry, caller, buffer);
+    else if (transfer != 0)
+        result = -1;
+
+    if (result == 0)
+        entry->reply_to = caller;
+
+    return result;
+}
+
+int ipc_call(u32 port, struct ipc_message *message)
+{
+    struct process *self = process_current();
+    struct ipc_port *entry = ipc_port(port);
+    struct process *receiver;
+
+    if (entry == NULL || entry->owner == NULL || entry->owner == self)
+        return -1;
+
+    self->ipc_message = message;
+    self->ipc_status = 0;
+
+    receiver = entry->receiver;
+    if (receiver != NULL)
+    {
+        /* Fast path: the owner is waiting, so it gets the message and this CPU right away */
+        if (ipc_deliver(entry, self, entry->receive_buffer))
+            return -1;
+
+        entry->receiver = NULL;
+        entry->receive_buffer = NULL;
+        process_block(receiver);
+    }
+    else
+    {
+        self->next = NULL;
+        if (entry->callers_tail != NULL)
+            entry->callers_tail->next = self;
+        else
+            entry->callers = self;
+        entry->callers_tail = self;
+
+        process_block(NULL);
+    }
+
+    /* The owner's reply (or a failure) switched back here */
+    return self->ipc_status;
+}
+
+int ipc_receive(u32 port, struct ipc_message *message)
+{
+    struct process *self = process_current();
+    struct ipc_port *entry = ipc_owned_port(port);
+    struct process *caller;
+
+    /* The caller received last still waits for its reply */
+    if (entry == NULL || entry->reply_to != NULL)
+        return -1;
+
+    while ((caller = entry->callers) != NULL)
+    {
+        entry->callers = caller->next;
+        if (entry->callers == NULL)
+            entry->callers_tail = NULL;
+        caller->next = NULL;
+
+        if (ipc_deliver(entry, caller, message) == 0)
+            return 0;
+
+        ipc_fail(caller);
+    }
+
+    self->ipc_status = 0;
+    entry->receiver = self;
+    entry->receive_buffer = message;
+    process_block(NULL);
+
+    return self->ipc_status;
+}
+
+/* Writes the reply into the blocked caller's message; it still has to be woken or switched to */
+static struct process *ipc_answer(struct ipc_port *entry, const struct ipc_message *message)
+{
+    struct process *caller = entry->reply_to;
+
+    if (caller == NULL || (message->tag & (IPC_TAG__MAP | IPC_TAG__COPY)))
+        return NULL;
+
+    *caller->ipc_message = *message;
+    caller->ipc_status = 0;
+    entry->reply_to = NULL;
+
+    return caller;
+}
+
+int ipc_reply(u32 port, const struct ipc_message *message)
+{
+    struct ipc_port *entry = ipc_owned_port(port);
+    struct process *caller;
+
+    if (entry == NULL)
+        return -1;
+
+    caller = ipc_answer(entry, message);
+    if (caller == NULL)
+        return -1;
+
+    process_wake(caller);
+
+    return 0;
+}
+
+int ipc_reply_wait(u32 port, struct ipc_message *message)
+{
+    struct process *self = process_current();
+    struct ipc_port *entry = ipc_owned_port(port);
+    struct process *caller;
+
+    if (entry == NULL)
+        return -1;
+    if (entry->reply_to == NULL)
+        return ipc_receive(port, message);
+
+    caller = ipc_answer(entry, message);
+    if (caller == NULL)
+        return -1;
+
+    /* Others are queued: the caller goes back on the run queue and the next call is taken right away */
+    if (entry->callers != NULL)
+    {
+        process_wake(caller);
+        return ipc_receive(port, message);
+    }
+
+    /* Fast path: wait for the next call and give this CPU straight back to the caller */
+    self->ipc_status = 0;
+    entry->receiver = self;
+    entry->receive_buffer = message;
+    process_block(caller);
+
+    return self->ipc_status;
+}
+
+int ipc_set_window(u32 port, uintptr_t addr, size_t length)
+{
+    struct process *self = process_current();
+    struct ipc_port *entry = ipc_owned_port(port);
+    uintptr_t page;
+
+    if (entry == NULL || length == 0 || (addr & PAGE_MASK) || addr < USER_BASE || addr >= USER_STACK_TOP ||
+        length > USER_STACK_TOP - addr)
+        return -1;
+
+    length = ALIGN_UP(length, (size_t)PAGE_SIZE);
+    for (page = addr; page < addr + length; page += PAGE_SIZE)
+    {
+        if (mmu_translate_user(&self->space, page, NULL) != 0)
+            return -1;
+    }
+
+    entry->window = addr;
+    entry->window_size = length;
+
+    return 0;
+}
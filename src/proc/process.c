@@ -0,0 +1,429 @@
+#include <types.h>
+#include <arch/arch.h>
+#include <arch/context.h>
+#include <arch/cpu.h>
+#include <arch/gdt.h>
+#include <arch/interrupt.h>
+#include <arch/syscall.h>
+#include <boot/init.h>
+#include <irq/irq.h>
+#include <lib/spinlock.h>
+#include <lib/string.h>
+#include <lib/util.h>
+#include <mm/cow.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+#include <mm/prezero.h>
+#include <proc/ipc.h>
+#include <proc/process.h>
+#include <time/vdso.h>
+#include <trace/trace.h>
+
+#define PROCESS_KERNEL_STACK_SIZE   (PROCESS_KERNEL_STACK_FRAMES * PAGE_SIZE)
+#define PROCESS_IMAGE_MAX           (USER_STACK_TOP - USER_STACK_PAGES * PAGE_SIZE - USER_IMAGE_BASE)
+
+struct process_cpu
+{
+    struct process *current;
+    uintptr_t kernel_sp;        /* process_run(), suspended while a process runs */
+    struct process *run_head;   /* runnable processes in FIFO order, linked by 'next' */
+    struct process *run_tail;
+};
+
+static struct process processes[PROCESS_MAX];
+static struct process_cpu process_cpus[NR_CPUS];
+static spinlock_t process_lock = SPINLOCK_INIT;
+static u32 process_next_pid = 1;
+
+struct process *process_current(void)
+{
+    return process_cpus[cpu_index()].current;
+}
+
+/* Maps 'pages' fresh writable pages at 'virt', the first 'size' bytes copied from 'data' and the rest zeroed */
+static int process_map_pages(struct process *process, uintptr_t virt, const void *data, size_t size,
+                             size_t pages)
+{
+    size_t page;
+
+    for (page = 0; page < pages; page++)
+    {
+        uintptr_t frame = prezero_alloc();
+        size_t offset = page * PAGE_SIZE;
+        u8 *dest;
+
+        if (frame == 0)
+            return -1;
+
+        dest = (u8 *)phys_to_virt(frame);
+        if (offset < size)
+            memcpy(dest, (const u8 *)data + offset, MIN(size - offset, (size_t)PAGE_SIZE));
+
+        if (mmu_map_user(&process->space, virt + offset, frame, MMU_USER__WRITABLE | MMU_USER__OWNED))
+        {
+            frame_free(frame);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * The first context_switch() to a process pops zeroed flags and registers
+ * and returns into interrupt_return, whose IRET drops to user mode at the
+ * image's entry point.
+ */
+static void process_prepare_stack(struct process *process, uintptr_t arg0, uintptr_t arg1)
+{
+    struct interrupt_frame *frame;
+    uintptr_t *sp;
+
+    frame = (struct interrupt_frame *)(process->kernel_stack + PROCESS_KERNEL_STACK_SIZE - sizeof(*frame));
+    memset(frame, 0, sizeof(*frame));
+#ifdef __x86_64__
+    frame->rdi = arg0;
+    frame->rsi = arg1;
+#else
+    frame->eax = arg0;
+    frame->edx = arg1;
+    frame->ds = GDT_USER_DS;
+    frame->es = GDT_USER_DS;
+#endif
+    frame->ip = USER_IMAGE_BASE;
+    frame->cs = GDT_USER_CS;
+    frame->flags = EFLAGS__IF | EFLAGS__FIXED;
+    frame->sp = USER_STACK_TOP;
+    frame->ss = GDT_USER_DS;
+
+    sp = (uintptr_t *)frame;
+    *--sp = (uintptr_t)interrupt_return;
+    sp -= CONTEXT_SAVED_WORDS;
+    memset(sp, 0, CONTEXT_SAVED_WORDS * sizeof(uintptr_t));
+    process->kernel_sp = (uintptr_t)sp;
+
+    return;
+}
+
+struct process *process_create(const void *image, size_t size, uintptr_t arg0, uintptr_t arg1)
+{
+    struct process *process = NULL;
+    uintptr_t stack_base = USER_STACK_TOP - USER_STACK_PAGES * PAGE_SIZE;
+    u32 slot;
+
+    if (size == 0 || size > PROCESS_IMAGE_MAX || vdso_time_page() == 0)
+        return NULL;
+
+    spin_lock(&process_lock);
+    for (slot = 0; slot < PROCESS_MAX; slot++)
+    {
+        if (processes[slot].state == PROCESS_STATE__FREE)
+        {
+            process = &processes[slot];
+            process->state = PROCESS_STATE__NEW;
+            process->pid = process_next_pid++;
+            break;
+        }
+    }
+    spin_unlock(&process_lock);
+
+    if (process == NULL)
+        return NULL;
+
+    process->space.root = 0;
+    process->kernel_stack = 0;
+    process->exit_status = 0;
+    process->next = NULL;
+    process->ipc_message = NULL;
+
+    if (mmu_space_create(&process->space))
+        goto fail;
+
+    process->kernel_stack = frame_alloc_contig(PROCESS_KERNEL_STACK_FRAMES);
+    if (process->kernel_stack == 0)
+        goto fail;
+
+    if (process_map_pages(process, USER_IMAGE_BASE, image, size, ALIGN_UP(size, (size_t)PAGE_SIZE) / PAGE_SIZE))
+        goto fail;
+    if (process_map_pages(process, stack_base, NULL, 0, USER_STACK_PAGES))
+        goto fail;
+
+    /* Shared by every process, so not owned: it outlives them all */
+    if (mmu_map_user(&process->space, USER_TIME_PAGE, vdso_time_page(), 0))
+        goto fail;
+
+    process_prepare_stack(process, arg0, arg1);
+
+    return process;
+
+fail:
+    process_destroy(process);
+
+    return NULL;
+}
+
+static void process_enqueue(struct process_cpu *cpu, struct process *process)
+{
+    process->state = PROCESS_STATE__READY;
+    process->next = NULL;
+
+    if (cpu->run_tail != NULL)
+        cpu->run_tail->next = process;
+    else
+        cpu->run_head = process;
+    cpu->run_tail = process;
+
+    return;
+}
+
+static struct process *process_dequeue(struct process_cpu *cpu)
+{
+    struct process *process = cpu->run_head;
+
+    if (process != NULL)
+    {
+        cpu->run_head = process->next;
+        if (cpu->run_head == NULL)
+            cpu->run_tail = NULL;
+        process->next = NULL;
+    }
+
+    return process;
+}
+
+static void process_unqueue(struct process_cpu *cpu, struct process *process)
+{
+    struct process **link = &cpu->run_head;
+    struct process *prev = NULL;
+
+    while (*link != NULL && *link != process)
+    {
+        prev = *link;
+        link = &prev->next;
+    }
+
+    if (*link == NULL)
+        return;
+
+    *link = process->next;
+    if (cpu->run_tail == process)
+        cpu->run_tail = prev;
+    process->next = NULL;
+
+    return;
+}
+
+/*
+ * Leaves the running process, or process_run() when there is none, for
+ * 'next', or for process_run() when NULL. Kernel stacks are in the shared
+ * kernel mapping, so the address space can change before the stack does.
+ */
+static void process_switch(struct process_cpu *cpu, struct process *next)
+{
+    struct process *prev = cpu->current;
+    uintptr_t *save = prev != NULL ? &prev->kernel_sp : &cpu->kernel_sp;
+
+    cpu->current = next;
+
+    if (next == NULL)
+    {
+        mmu_space_switch(NULL);
+        trace_point(TRACE_EVENT__SCHED_SWITCH, prev->pid, 0);
+        context_switch(save, cpu->kernel_sp);
+        return;
+    }
+
+    next->state = PROCESS_STATE__RUNNING;
+
+    /* Where the CPU lands on an interrupt from user mode, and on a system call */
+    tss_set_kernel_stack(next->kernel_stack + PROCESS_KERNEL_STACK_SIZE);
+    syscall_set_kernel_stack(next->kernel_stack + PROCESS_KERNEL_STACK_SIZE);
+    mmu_space_switch(&next->space);
+
+    trace_point(TRACE_EVENT__SCHED_SWITCH, prev != NULL ? prev->pid : 0, next->pid);
+    context_switch(save, next->kernel_sp);
+
+    return;
+}
+
+void process_start(struct process *process)
+{
+    if (process->state == PROCESS_STATE__NEW)
+        process_enqueue(&process_cpus[cpu_index()], process);
+
+    return;
+}
+
+int process_run(struct process *process)
+{
+    struct process_cpu *cpu = &process_cpus[cpu_index()];
+
+    process_start(process);
+
+    while (process->state != PROCESS_STATE__EXITED)
+    {
+        struct process *next = process_dequeue(cpu);
+
+        /* The rest are blocked on each other */
+        if (next == NULL)
+            return -1;
+
+        /* Returns once nothing on this CPU is runnable */
+        process_switch(cpu, next);
+    }
+
+    return process->exit_status;
+}
+
+void process_block(struct process *next)
+{
+    struct process_cpu *cpu = &process_cpus[cpu_index()];
+
+    cpu->current->state = PROCESS_STATE__BLOCKED;
+    if (next == NULL)
+        next = process_dequeue(cpu);
+
+    process_switch(cpu, next);
+
+    return;
+}
+
+void process_wake(struct process *process)
+{
+    if (process->state == PROCESS_STATE__BLOCKED)
+        process_enqueue(&process_cpus[cpu_index()], process);
+
+    return;
+}
+
+void process_exit(int status)
+{
+    struct process_cpu *cpu = &process_cpus[cpu_index()];
+    struct process *process = cpu->current;
+
+    process->exit_status = status;
+    process->state = PROCESS_STATE__EXITED;
+
+    /* Whoever waits on its ports gets an error instead of a reply */
+    ipc_process_gone(process);
+
+    process_switch(cpu, process_dequeue(cpu));
+
+    /* Nothing switches back to an exited process */
+    while (1)
+        cpu_halt();
+}
+
+void process_destroy(struct process *process)
+{
+    if (process->state == PROCESS_STATE__READY)
+        process_unqueue(&process_cpus[cpu_index()], process);
+    if (process->state != PROCESS_STATE__EXITED)
+        ipc_process_gone(process);
+
+    if (process->space.root != 0)
+        mmu_space_destroy(&process->space);
+    if (process->kernel_stack != 0)
+        frame_free_contig(process->kernel_stack, PROCESS_KERNEL_STACK_FRAMES);
+
+    process->kernel_stack = 0;
+
+    spin_lock(&process_lock);
+    process->state = PROCESS_STATE__FREE;
+    spin_unlock(&process_lock);
+
+    return;
+}
+
+bool process_access_ok(uintptr_t addr, size_t length, bool write)
+{
+    struct process *process = process_current();
+    uintptr_t page;
+    u32 flags;
+
+    if (process == NULL || addr + length < addr)
+        return false;
+
+    for (page = ALIGN_DOWN(addr, (uintptr_t)PAGE_SIZE); page < addr + length; page += PAGE_SIZE)
+    {
+        if (mmu_translate_user(&process->space, page, &flags) == 0)
+            return false;
+        if (write && !(flags & MMU_USER__WRITABLE) && process_cow_break(process, page))
+            return false;
+    }
+
+    return true;
+}
+
+int process_map_anonymous(uintptr_t addr, size_t length)
+{
+    struct process *process = process_current();
+    uintptr_t page;
+
+    /* Never over the guard page above the stack */
+    if (process == NULL || length == 0 || (addr & PAGE_MASK) || addr < USER_BASE || addr >= USER_STACK_TOP ||
+        length > USER_STACK_TOP - addr)
+        return -1;
+
+    for (page = addr; page < addr + length; page += PAGE_SIZE)
+    {
+        if (mmu_translate_user(&process->space, page, NULL) != 0)
+            return -1;
+    }
+
+    return process_map_pages(process, addr, NULL, 0, ALIGN_UP(length, (size_t)PAGE_SIZE) / PAGE_SIZE);
+}
+
+int process_cow_break(struct process *process, uintptr_t virt)
+{
+    uintptr_t frame;
+    uintptr_t copy;
+    u32 flags;
+
+    frame = mmu_translate_user(&process->space, virt, &flags);
+    if (frame == 0 || !(flags & MMU_USER__COW))
+        return -1;
+
+    /* The last mapping of a shared frame takes it over without copying */
+    if (cow_count(frame) == 1)
+        return mmu_map_user(&process->space, virt, frame, MMU_USER__WRITABLE | MMU_USER__OWNED);
+
+    copy = frame_alloc();
+    if (copy == 0)
+        return -1;
+
+    memcpy(phys_to_virt(copy), phys_to_virt(frame), PAGE_SIZE);
+    if (mmu_map_user(&process->space, virt, copy, MMU_USER__WRITABLE | MMU_USER__OWNED))
+    {
+        frame_free(copy);
+        return -1;
+    }
+
+    if (cow_release(frame))
+        frame_free(frame);
+
+    return 0;
+}
+
+/* Writes from user mode to copy-on-write pages; every other fault takes the default path */
+static void process_page_fault(struct interrupt_frame *frame)
+{
+    const uintptr_t cow_fault = PAGE_FAULT__PRESENT | PAGE_FAULT__WRITE | PAGE_FAULT__USER;
+    struct process *process = process_current();
+    uintptr_t addr = read_cr2();
+
+    if (process != NULL && (frame->error_code & cow_fault) == cow_fault &&
+        process_cow_break(process, ALIGN_DOWN(addr, (uintptr_t)PAGE_SIZE)) == 0)
+        return;
+
+    irq_exception(frame);
+
+    return;
+}
+
+void __init process_init(void)
+{
+    irq_register(INTERRUPT_VECTOR__PAGE_FAULT, process_page_fault);
+
+    return;
+}
@@ -0,0 +1,162 @@
+#include <types.h>
+#include <arch/syscall.h>
+#include <lib/printk.h>
+#include <lib/string.h>
+#include <lib/util.h>
+#include <proc/ipc.h>
+#include <proc/process.h>
+#include <proc/syscall.h>
+#include <time/vdso.h>
+
+/* SYS_WRITE copies through a bounce buffer of this size, NUL-terminated for printk() */
+#define SYSCALL_WRITE_CHUNK 128
+
+typedef uintptr_t (*syscall_handler_t)(struct syscall_frame *frame);
+
+static uintptr_t sys_exit(struct syscall_frame *frame)
+{
+    process_exit((int)frame->arg0);
+}
+
+static uintptr_t sys_nop(struct syscall_frame *frame)
+{
+    (void)frame;
+
+    return 0;
+}
+
+static uintptr_t sys_clock_ns(struct syscall_frame *frame)
+{
+    u64 now = vdso_clock_ns();
+
+    if (!process_access_ok(frame->arg0, sizeof(u64), true))
+        return SYSCALL_ERROR;
+
+    memcpy((void *)frame->arg0, &now, sizeof(now));
+
+    return 0;
+}
+
+static uintptr_t sys_write(struct syscall_frame *frame)
+{
+    char chunk[SYSCALL_WRITE_CHUNK + 1];
+    uintptr_t buffer = frame->arg0;
+    size_t length = frame->arg1;
+    size_t done;
+
+    if (!process_access_ok(buffer, length, false))
+        return SYSCALL_ERROR;
+
+    for (done = 0; done < length; done += SYSCALL_WRITE_CHUNK)
+    {
+        size_t count = MIN(length - done, (size_t)SYSCALL_WRITE_CHUNK);
+
+        memcpy(chunk, (const char *)buffer + done, count);
+        chunk[count] = '\0';
+        printk("%s", chunk);
+    }
+
+    return length;
+}
+
+static uintptr_t sys_map(struct syscall_frame *frame)
+{
+    return process_map_anonymous(frame->arg0, frame->arg1) ? SYSCALL_ERROR : 0;
+}
+
+static void syscall_get_message(const struct syscall_frame *frame, struct ipc_message *message)
+{
+    message->tag = frame->arg1;
+    message->w0 = frame->arg2;
+    message->w1 = frame->arg3;
+
+    return;
+}
+
+/* The entry code reloads the argument registers from the frame on the way out */
+static void syscall_put_message(struct syscall_frame *frame, const struct ipc_message *message)
+{
+    frame->arg1 = message->tag;
+    frame->arg2 = message->w0;
+    frame->arg3 = message->w1;
+
+    return;
+}
+
+static uintptr_t sys_ipc_call(struct syscall_frame *frame)
+{
+    struct ipc_message message;
+
+    syscall_get_message(frame, &message);
+    if (ipc_call((u32)frame->arg0, &message))
+        return SYSCALL_ERROR;
+    syscall_put_message(frame, &message);
+
+    return 0;
+}
+
+static uintptr_t sys_ipc_receive(struct syscall_frame *frame)
+{
+    struct ipc_message message;
+
+    if (ipc_receive((u32)frame->arg0, &message))
+        return SYSCALL_ERROR;
+    syscall_put_message(frame, &message);
+
+    return 0;
+}
+
+static uintptr_t sys_ipc_reply(struct syscall_frame *frame)
+{
+    struct ipc_message message;
+
+    syscall_get_message(frame, &message);
+
+    return ipc_reply((u32)frame->arg0, &message) ? SYSCALL_ERROR : 0;
+}
+
+static uintptr_t sys_ipc_reply_wait(struct syscall_frame *frame)
+{
+    struct ipc_message message;
+
+    syscall_get_message(frame, &message);
+    if (ipc_reply_wait((u32)frame->arg0, &message))
+        return SYSCALL_ERROR;
+    syscall_put_message(frame, &message);
+
+    return 0;
+}
+
+static uintptr_t sys_ipc_window(struct syscall_frame *frame)
+{
+    return ipc_set_window((u32)frame->arg0, frame->arg1, frame->arg2) ? SYSCALL_ERROR : 0;
+}
+
+static const syscall_handler_t syscall_table[SYSCALLS] =
+{
+    [SYS_EXIT] = sys_exit,
+    [SYS_NOP] = sys_nop,
+    [SYS_CLOCK_NS] = sys_clock_ns,
+    [SYS_WRITE] = sys_write,
+    [SYS_MAP] = sys_map,
+    [SYS_IPC_CALL] = sys_ipc_call,
+    [SYS_IPC_RECEIVE] = sys_ipc_receive,
+    [SYS_IPC_REPLY] = sys_ipc_reply,
+    [SYS_IPC_REPLY_WAIT] = sys_ipc_reply_wait,
+    [SYS_IPC_WINDOW] = sys_ipc_window,
+};
+
+void syscall_dispatch(struct syscall_frame *frame)
+{
+    uintptr_t number = frame->value;
+
+    if (number >= SYSCALLS || syscall_table[number] == NULL)
+    {
+        frame->value = SYSCALL_ERROR;
+        return;
+    }
+
+    frame->value = syscall_table[number](frame);
+
+    return;
+}
@@ -0,0 +1,413 @@
+#include <types.h>
+#include <acpi/topology.h>
+#include <arch/arch.h>
+#include <arch/cpu.h>
+#include <arch/gdt.h>
+#include <arch/interrupt.h>
+#include <boot/bootloader.h>
+#include <boot/init.h>
+#include <boot/multiboot2.h>
+#include <irq/irq.h>
+#include <irq/lapic.h>
+#include <lib/printk.h>
+#include <lib/string.h>
+#include <lib/util.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+#include <smp/smp.h>
+#include <time/tsc.h>
+
+/*
+ * Real-mode code must sit below 1MB; the STARTUP IPI takes its page number.
+ * Each CPU gets the page at its cpu_index() from here, so one that starts
+ * late never finds another CPU's data block.
+ */
+#define SMP_TRAMPOLINE          0x8000UL
+#define SMP_STACK_FRAMES        4
+#define SMP_MAX_IDLE_WORK       4
+
+/* xAPIC destinations are 8 bits wide and 0xFF is the broadcast */
+#define SMP_MAX_APIC_ID         0xFE
+
+/* INIT-SIPI-SIPI timing from the MultiProcessor Specification */
+#define SMP_INIT_DELAY_US       10000
+#define SMP_STARTUP_DELAY_US    200
+#define SMP_ONLINE_TIMEOUT_US   100000
+
+/* Idle work is short: a CPU that takes longer than this to park is stuck */
+#define SMP_PAUSE_TIMEOUT_US    100000
+
+/* smp_cpu_state[]: the AP and the boot CPU race to move it out of STARTING */
+#define SMP_CPU__OFFLINE        0
+#define SMP_CPU__STARTING       1
+#define SMP_CPU__ONLINE         2
+#define SMP_CPU__ABANDONED      3
+
+/* The data block at the end of the trampoline (src/arch/ARCH/trampoline.s) */
+struct smp_trampoline
+{
+    u64 cr3;
+    u64 stack;
+    u64 entry;
+    u32 cpu;
+    u32 reserved;
+};
+
+extern u8 smp_trampoline_start[];
+extern u8 smp_trampoline_end[];
+
+/* Counted by the boot CPU once it has seen a CPU come online */
+static volatile u32 smp_online = 1;
+static volatile u32 smp_cpu_state[NR_CPUS];
+static volatile bool smp_cpu_sleeping[NR_CPUS];
+
+static bool (*smp_idle_work[SMP_MAX_IDLE_WORK])(void);
+static u32 smp_idle_work_count;
+
+/* Bumped by smp_wake_idle(): a CPU that saw no idle work before it does not halt */
+static volatile u32 smp_idle_kicks;
+
+/* Work posted by smp_run(): a new generation is run once by every application processor */
+static void (*volatile smp_work)(void *data);
+static void *volatile smp_work_data;
+static volatile u32 smp_work_generation;
+static volatile u32 smp_work_pending;
+
+/* smp_pause(): held by the pausing CPU; the others park while smp_parking is set */
+static volatile bool smp_pause_owned;
+static volatile bool smp_parking;
+static volatile u32 smp_parked;
+
+static u64 smp_deadline(u32 us)
+{
+    return rdtsc() + div_u64((u64)tsc_khz() * us, 1000);
+}
+
+static void smp_delay_us(u32 us)
+{
+    u64 end = smp_deadline(us);
+
+    while (rdtsc() < end)
+        cpu_relax();
+
+    return;
+}
+
+static void smp_wake_interrupt(struct interrupt_frame *frame)
+{
+    (void)frame;
+
+    lapic_eoi();
+
+    return;
+}
+
+/* Out of every other piece of kernel code, with interrupts off, until smp_resume() */
+static void smp_park(void)
+{
+    u32 eax, ebx, ecx, edx;
+
+    interrupts_disable();
+    __atomic_fetch_add(&smp_parked, 1, __ATOMIC_RELEASE);
+
+    while (__atomic_load_n(&smp_parking, __ATOMIC_ACQUIRE))
+        cpu_relax();
+
+    /* The code may have been patched meanwhile: CPUID serialises before any of it runs */
+    cpuid(0, 0, &eax, &ebx, &ecx, &edx);
+
+    __atomic_fetch_sub(&smp_parked, 1, __ATOMIC_RELEASE);
+    interrupts_enable();
+
+    return;
+}
+
+/* 'generation' is the last smp_run() work this CPU is not expected to run */
+static void __attribute__ ((noreturn)) smp_idle_loop(u32 generation)
+{
+    u32 cpu = cpu_index();
+
+    for (;;)
+    {
+        u32 kicks = __atomic_load_n(&smp_idle_kicks, __ATOMIC_SEQ_CST);
+        bool busy = false;
+        u32 index;
+
+        if (__atomic_load_n(&smp_parking, __ATOMIC_ACQUIRE))
+        {
+            smp_park();
+            continue;
+        }
+
+        if (__atomic_load_n(&smp_work_generation, __ATOMIC_ACQUIRE) != generation)
+        {
+            generation = smp_work_generation;
+            smp_work(smp_work_data);
+            __atomic_fetch_sub(&smp_work_pending, 1, __ATOMIC_RELEASE);
+            continue;
+        }
+
+        for (index = 0; index < smp_idle_work_count; index++)
+            busy |= smp_idle_work[index]();
+        if (busy)
+            continue;
+
+        /*
+         * Announce the halt before looking for a wake-up that came after the
+         * checks above: smp_wake_idle() bumps the kicks before it reads the
+         * flag, so one of the two sides always sees the other.
+         */
+        interrupts_disable();
+        __atomic_store_n(&smp_cpu_sleeping[cpu], true, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&smp_idle_kicks, __ATOMIC_SEQ_CST) == kicks &&
+            __atomic_load_n(&smp_work_generation, __ATOMIC_ACQUIRE) == generation)
+            interrupts_enable_halt();
+        else
+            interrupts_enable();
+        __atomic_store_n(&smp_cpu_sleeping[cpu], false, __ATOMIC_RELAXED);
+    }
+}
+
+void smp_idle(void)
+{
+    smp_idle_loop(__atomic_load_n(&smp_work_generation, __ATOMIC_ACQUIRE));
+}
+
+/* C entry of an application processor, called by the trampoline on its own stack */
+static void smp_ap_entry(u32 cpu)
+{
+    /* Read before the boot CPU can count this one, so no later smp_run() is missed */
+    u32 generation = __atomic_load_n(&smp_work_generation, __ATOMIC_ACQUIRE);
+    u32 starting = SMP_CPU__STARTING;
+
+    /* Too late: the boot CPU gave up waiting and does not count this CPU */
+    if (!__atomic_compare_exchange_n(&smp_cpu_state[cpu], &starting, SMP_CPU__ONLINE, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        for (;;)
+        {
+            interrupts_disable();
+            cpu_halt();
+        }
+    }
+
+    gdt_load(cpu);
+    idt_load();
+    lapic_enable();
+
+    smp_idle_loop(generation);
+}
+
+/* The trampoline pages must be RAM that nothing from the boot loader occupies */
+static bool __init smp_trampoline_usable(const struct boot_info *info, size_t pages)
+{
+    const struct mb2_info_tag__memory_map *memory_map = info->memory_map;
+    const struct mb2_info_tag__memory_map__entry *entry;
+    uintptr_t end = SMP_TRAMPOLINE + pages * PAGE_SIZE;
+    bool available = false;
+    size_t index;
+
+    if (memory_map == NULL)
+        return false;
+
+    for (entry = memory_map->entries;
+         (const u8 *)entry < (const u8 *)memory_map + memory_map->size;
+         entry = (const struct mb2_info_tag__memory_map__entry *)((const u8 *)entry + memory_map->entry_size))
+    {
+        if (entry->type == MB2_INFO_TAG__MEMORY_MAP__ENTRY__TYPE__MEMORY_AVAILABLE &&
+            entry->base_addr <= SMP_TRAMPOLINE && entry->base_addr + entry->length >= end)
+            available = true;
+    }
+
+    if (info->mb2_info_start < end && SMP_TRAMPOLINE < info->mb2_info_end)
+        return false;
+    for (index = 0; index < info->module_count; index++)
+        if (info->modules[index].start < end && SMP_TRAMPOLINE < info->modules[index].end)
+            return false;
+
+    return available;
+}
+
+static void __init smp_start(u32 cpu)
+{
+    u32 apic_id = acpi_topology.cpus[cpu].apic_id;
+    uintptr_t page = SMP_TRAMPOLINE + cpu * PAGE_SIZE;
+    size_t size = smp_trampoline_end - smp_trampoline_start;
+    struct smp_trampoline *trampoline;
+    u32 starting = SMP_CPU__STARTING;
+    uintptr_t stack;
+    u64 deadline;
+
+    if (apic_id > SMP_MAX_APIC_ID)
+    {
+        printk("smp: cpu %u has APIC id %u, out of xAPIC reach\n", cpu, apic_id);
+        return;
+    }
+
+    stack = frame_alloc_contig(SMP_STACK_FRAMES);
+    if (stack == 0)
+        return;
+
+    memcpy(phys_to_virt(page), smp_trampoline_start, size);
+    trampoline = (struct smp_trampoline *)((u8 *)phys_to_virt(page) + size - sizeof(*trampoline));
+    trampoline->cr3 = read_cr3();
+    trampoline->stack = (uintptr_t)phys_to_virt(stack) + SMP_STACK_FRAMES * PAGE_SIZE;
+    trampoline->entry = (uintptr_t)smp_ap_entry;
+    trampoline->cpu = cpu;
+    __atomic_store_n(&smp_cpu_state[cpu], SMP_CPU__STARTING, __ATOMIC_RELEASE);
+
+    lapic_send_init(apic_id);
+    smp_delay_us(SMP_INIT_DELAY_US);
+    lapic_send_startup(apic_id, page >> PAGE_SHIFT);
+    smp_delay_us(SMP_STARTUP_DELAY_US);
+    /* A CPU that already left the wait-for-SIPI state ignores the second one */
+    if (__atomic_load_n(&smp_cpu_state[cpu], __ATOMIC_ACQUIRE) == SMP_CPU__STARTING)
+        lapic_send_startup(apic_id, page >> PAGE_SHIFT);
+
+    deadline = smp_deadline(SMP_ONLINE_TIMEOUT_US);
+    while (__atomic_load_n(&smp_cpu_state[cpu], __ATOMIC_ACQUIRE) == SMP_CPU__STARTING && rdtsc() < deadline)
+        cpu_relax();
+
+    /*
+     * Whichever of the two moves the state out of STARTING decides: a CPU
+     * that arrives after this halts in smp_ap_entry(). Its page, data block
+     * and stack are left as they are, since it may still be reading them.
+     */
+    if (__atomic_compare_exchange_n(&smp_cpu_state[cpu], &starting, SMP_CPU__ABANDONED, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        printk("smp: cpu %u (APIC id %u) did not start\n", cpu, apic_id);
+        return;
+    }
+
+    smp_online++;
+
+    return;
+}
+
+int __init smp_init(const struct boot_info *info)
+{
+    size_t size = smp_trampoline_end - smp_trampoline_start;
+    u32 boot_apic_id = cpu_apic_id();
+    u32 cpu;
+
+    if (acpi_topology.cpu_count <= 1)
+        return 0;
+
+    /* cpu_index() 0 is the boot CPU's own TSS: that slot cannot go to another CPU */
+    if (acpi_topology.cpus[0].apic_id != boot_apic_id)
+    {
+        printk("smp: boot CPU (APIC id %u) is not in the MADT, not starting the others\n", boot_apic_id);
+        return -1;
+    }
+
+    /* The top of each page is the trampoline's stack until it switches to the kernel's */
+    if (tsc_khz() == 0 || size + 64 > PAGE_SIZE || !smp_trampoline_usable(info, acpi_topology.cpu_count))
+    {
+        printk("smp: cannot start the other %zu CPUs\n", acpi_topology.cpu_count - 1);
+        return -1;
+    }
+
+    irq_register(SMP_VECTOR_WAKE, smp_wake_interrupt);
+
+    /* One at a time, so each is counted before smp_run() can need it */
+    for (cpu = 0; cpu < acpi_topology.cpu_count; cpu++)
+    {
+        if (acpi_topology.cpus[cpu].apic_id == boot_apic_id)
+            continue;
+        smp_start(cpu);
+    }
+
+    printk("smp: %u of %zu CPUs online\n", smp_online, acpi_topology.cpu_count);
+
+    return 0;
+}
+
+u32 smp_cpus_online(void)
+{
+    return smp_online;
+}
+
+void smp_run(void (*work)(void *data), void *data)
+{
+    smp_work = work;
+    smp_work_data = data;
+    __atomic_store_n(&smp_work_pending, smp_online - 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&smp_work_generation, 1, __ATOMIC_RELEASE);
+    smp_wake_idle();
+
+    work(data);
+
+    while (__atomic_load_n(&smp_work_pending, __ATOMIC_ACQUIRE) != 0)
+        cpu_relax();
+
+    return;
+}
+
+int smp_pause(void)
+{
+    u64 deadline;
+
+    if (smp_online == 1)
+        return 0;
+    if (__atomic_exchange_n(&smp_pause_owned, true, __ATOMIC_ACQUIRE))
+        return -1;
+
+    /* smp_wake_idle() bumps the kicks after this, so no CPU halts without seeing it */
+    __atomic_store_n(&smp_parking, true, __ATOMIC_SEQ_CST);
+    smp_wake_idle();
+
+    deadline = smp_deadline(SMP_PAUSE_TIMEOUT_US);
+    while (__atomic_load_n(&smp_parked, __ATOMIC_ACQUIRE) != smp_online - 1)
+    {
+        if (rdtsc() >= deadline)
+        {
+            smp_resume();
+            return -1;
+        }
+        cpu_relax();
+    }
+
+    return 0;
+}
+
+void smp_resume(void)
+{
+    if (smp_online == 1)
+        return;
+
+    __atomic_store_n(&smp_parking, false, __ATOMIC_RELEASE);
+    /* The next smp_pause() must not count CPUs that are still on their way out */
+    while (__atomic_load_n(&smp_parked, __ATOMIC_ACQUIRE) != 0)
+        cpu_relax();
+    __atomic_store_n(&smp_pause_owned, false, __ATOMIC_RELEASE);
+
+    return;
+}
+
+int smp_idle_register(bool (*work)(void))
+{
+    if (smp_idle_work_count == SMP_MAX_IDLE_WORK)
+        return -1;
+
+    smp_idle_work[smp_idle_work_count++] = work;
+
+    return 0;
+}
+
+void smp_wake_idle(void)
+{
+    u32 cpu;
+
+    __atomic_fetch_add(&smp_idle_kicks, 1, __ATOMIC_SEQ_CST);
+
+    /* Whoever clears the flag sends the IPI, so a halted CPU gets one */
+    for (cpu = 0; cpu < NR_CPUS; cpu++)
+    {
+        if (__atomic_load_n(&smp_cpu_sleeping[cpu], __ATOMIC_SEQ_CST) &&
+            __atomic_exchange_n(&smp_cpu_sleeping[cpu], false, __ATOMIC_SEQ_CST))
+            lapic_send_ipi(acpi_topology.cpus[cpu].apic_id, SMP_VECTOR_WAKE);
+    }
+
+    return;
+}
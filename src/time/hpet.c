@@ -0,0 +1,109 @@
+#include <types.h>
+#include <acpi/acpi.h>
+#include <acpi/tables.h>
+#include <arch/io.h>
+#include <boot/init.h>
+#include <lib/printk.h>
+#include <lib/util.h>
+#include <mm/mmu.h>
+#include <time/hpet.h>
+
+#define HPET_REGISTERS_SIZE         0x400
+
+#define HPET_REG__CAPABILITIES      0x000
+#define HPET_REG__PERIOD            0x004
+#define HPET_REG__CONFIGURATION     0x010
+#define HPET_REG__COUNTER           0x0F0
+
+#define HPET_CAPABILITIES__COUNTER_64   ((u32)1 << 13)
+#define HPET_CONFIGURATION__ENABLE      ((u32)1 << 0)
+
+/* The specification caps the tick period at 100ns */
+#define HPET_MAX_PERIOD_FS          100000000U
+
+/* ns = ticks * mult >> HPET_SHIFT, same split multiplication as the TSC */
+#define HPET_SHIFT 22
+
+static volatile u8 *hpet_registers;
+static u32 hpet_period;
+static u64 hpet_mask;
+static u64 hpet_mult;
+
+int __init hpet_init(void)
+{
+    const struct acpi_hpet *table = (const struct acpi_hpet *)acpi_find_table(ACPI_SIGNATURE__HPET, 0);
+    u32 capabilities;
+    u32 khz;
+
+    if (table == NULL || table->base_address.address_space != ACPI_GAS__SPACE__MEMORY)
+        return -1;
+
+    hpet_registers = mmu_map_io(table->base_address.address, HPET_REGISTERS_SIZE);
+    if (hpet_registers == NULL)
+        return -1;
+
+    capabilities = mmio_read32(hpet_registers + HPET_REG__CAPABILITIES);
+    hpet_period = mmio_read32(hpet_registers + HPET_REG__PERIOD);
+    if (hpet_period == 0 || hpet_period > HPET_MAX_PERIOD_FS)
+    {
+        hpet_registers = NULL;
+        return -1;
+    }
+
+    hpet_mask = capabilities & HPET_CAPABILITIES__COUNTER_64 ? ~(u64)0 : 0xFFFFFFFFU;
+    hpet_mult = div_u64((u64)hpet_period << HPET_SHIFT, 1000000);
+
+    mmio_write32(hpet_registers + HPET_REG__CONFIGURATION,
+                 mmio_read32(hpet_registers + HPET_REG__CONFIGURATION) | HPET_CONFIGURATION__ENABLE);
+
+    khz = (u32)div_u64(1000000000000ULL, hpet_period);
+    printk("hpet: %u.%03u MHz, %u-bit counter\n", khz / 1000, khz % 1000, hpet_mask == 0xFFFFFFFFU ? 32 : 64);
+
+    return 0;
+}
+
+bool hpet_available(void)
+{
+    return hpet_registers != NULL;
+}
+
+u32 hpet_period_fs(void)
+{
+    return hpet_period;
+}
+
+u64 hpet_read(void)
+{
+    u32 high;
+    u32 low;
+
+    if (hpet_mask == 0xFFFFFFFFU)
+        return mmio_read32(hpet_registers + HPET_REG__COUNTER);
+
+    /* Two 32-bit reads: retry if the low half carried in between */
+    do
+    {
+        high = mmio_read32(hpet_registers + HPET_REG__COUNTER + 4);
+        low = mmio_read32(hpet_registers + HPET_REG__COUNTER);
+    } while (high != mmio_read32(hpet_registers + HPET_REG__COUNTER + 4));
+
+    return (u64)high << 32 | low;
+}
+
+u64 hpet_delta(u64 start, u64 end)
+{
+    return (end - start) & hpet_mask;
+}
+
+u64 hpet_ticks_to_ns(u64 ticks)
+{
+    u64 high = ticks >> 32;
+    u64 low = ticks & 0xFFFFFFFFU;
+
+    return ((high * hpet_mult) << (32 - HPET_SHIFT)) + ((low * hpet_mult) >> HPET_SHIFT);
+}
+
+u64 hpet_ns(void)
+{
+    return hpet_ticks_to_ns(hpet_read());
+}
@@ -0,0 +1,94 @@
+#include <types.h>
+#include <arch/cpu.h>
+#include <arch/io.h>
+#include <boot/init.h>
+#include <lib/printk.h>
+#include <lib/util.h>
+#include <time/hpet.h>
+#include <time/pit.h>
+#include <time/tsc.h>
+
+#define TSC_CALIBRATION_MS      10U
+#define TSC_CALIBRATION_ROUNDS  3
+
+static u32 tsc_khz_value;
+static u64 tsc_mult;
+
+/* Counts TSC cycles while PIT channel 2 counts down TSC_CALIBRATION_MS in one-shot mode */
+static u64 __init tsc_pit_measure(void)
+{
+    u32 latch = PIT_FREQUENCY / (1000U / TSC_CALIBRATION_MS);
+    u64 start;
+
+    outb(PIT_PORT_GATE, (inb(PIT_PORT_GATE) & ~PIT_GATE__SPEAKER) | PIT_GATE__ENABLE);
+    outb(PIT_PORT_COMMAND, 0xB0);   /* channel 2, lobyte/hibyte, mode 0, binary */
+    outb(PIT_PORT_CHANNEL2, latch & 0xFF);
+    outb(PIT_PORT_CHANNEL2, latch >> 8);
+
+    start = rdtsc();
+    while (!(inb(PIT_PORT_GATE) & PIT_GATE__OUTPUT))
+        ;
+
+    return rdtsc() - start;
+}
+
+/* Counts TSC cycles over TSC_CALIBRATION_MS of HPET time, scaled by the ticks actually elapsed */
+static u64 __init tsc_hpet_measure(void)
+{
+    u64 target = div_u64((u64)TSC_CALIBRATION_MS * 1000000000000ULL, hpet_period_fs());
+    u64 hpet_start = hpet_read();
+    u64 start = rdtsc();
+    u64 elapsed;
+    u64 cycles;
+
+    while ((elapsed = hpet_delta(hpet_start, hpet_read())) < target)
+        cpu_relax();
+
+    cycles = rdtsc() - start;
+
+    return div_u64(cycles * (TSC_CALIBRATION_MS * 1000000U), (u32)hpet_ticks_to_ns(elapsed));
+}
+
+int __init tsc_init(void)
+{
+    u64 (*measure)(void) = hpet_available() ? tsc_hpet_measure : tsc_pit_measure;
+    u64 best = 0;
+    int round;
+
+    /* Keep the shortest round: longer ones were stretched by SMIs or emulation exits */
+    for (round = 0; round < TSC_CALIBRATION_ROUNDS; round++)
+    {
+        u64 cycles = measure();
+
+        if (best == 0 || cycles < best)
+            best = cycles;
+    }
+
+    tsc_khz_value = (u32)div_u64(best, TSC_CALIBRATION_MS);
+    if (tsc_khz_value == 0)
+        return -1;
+
+    tsc_mult = div_u64((u64)1000000 << TSC_SHIFT, tsc_khz_value);
+
+    printk("tsc: %u.%03u MHz (%s)\n", tsc_khz_value / 1000, tsc_khz_value % 1000,
+           hpet_available() ? "hpet" : "pit");
+
+    return 0;
+}
+
+u32 tsc_khz(void)
+{
+    return tsc_khz_value;
+}
+
+u64 tsc_cycles_to_ns(u64 cycles)
+{
+    return tsc_scale(cycles, tsc_mult);
+}
+
+void tsc_conversion(u64 *mult)
+{
+    *mult = tsc_mult;
+
+    return;
+}
@@ -0,0 +1,52 @@
+#include <types.h>
+#include <arch/arch.h>
+#include <arch/cpu.h>
+#include <boot/init.h>
+#include <lib/printk.h>
+#include <lib/string.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+#include <mm/prezero.h>
+#include <time/tsc.h>
+#include <time/vdso.h>
+
+static struct vdso_time *vdso_time;
+
+int __init vdso_init(void)
+{
+    uintptr_t frame;
+    u64 mult;
+
+    if (tsc_khz() == 0)
+        return -1;
+
+    frame = prezero_alloc();
+    if (frame == 0)
+        return -1;
+
+    vdso_time = (struct vdso_time *)phys_to_virt(frame);
+    tsc_conversion(&mult);
+
+    vdso_time->sequence = 1;
+    wmb();
+    vdso_time->mult = mult;
+    vdso_time->base_tsc = rdtsc();
+    vdso_time->base_ns = 0;
+    vdso_time->tsc_khz = tsc_khz();
+    wmb();
+    vdso_time->sequence = 2;
+
+    printk("vdso: time page at %zx, mult %llu >> %u\n", frame, (unsigned long long)mult, TSC_SHIFT);
+
+    return 0;
+}
+
+uintptr_t vdso_time_page(void)
+{
+    return vdso_time != NULL ? virt_to_phys(vdso_time) : 0;
+}
+
+u64 vdso_clock_ns(void)
+{
+    return vdso_time_ns(vdso_time);
+}
@@ -0,0 +1,139 @@
+#include <types.h>
+#include <arch/arch.h>
+#include <arch/interrupt.h>
+#include <arch/io.h>
+#include <boot/bootloader.h>
+#include <boot/init.h>
+#include <drivers/serial/serial.h>
+#include <irq/irq.h>
+#include <irq/pic.h>
+#include <lib/printk.h>
+#include <lib/string.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+#include <time/pit.h>
+#include <trace/profile.h>
+
+#define PROFILE_PIT_MODE    0x34    /* channel 0, lobyte/hibyte, mode 2 (rate generator), binary */
+#define PROFILE_MAX_PROBES  32
+
+struct profile_slot
+{
+    uintptr_t ip;
+    u32 samples;    /* 0 when free */
+};
+
+/* Bounds of the profiled hot functions in .text, from the linker script */
+extern u8 _text_hot_start[];
+extern u8 _text_hot_end[];
+
+#define PROFILE_FRAMES      (PROFILE_SLOTS * sizeof(struct profile_slot) / PAGE_SIZE)
+
+/* Allocated only when profiling; written only by the timer handler on the boot CPU, so no lock */
+static struct profile_slot *profile_slots;
+static u32 profile_kernel_samples;
+static u32 profile_user_samples;
+static u32 profile_lost_samples;
+static bool profile_running;
+
+static void profile_tick(struct interrupt_frame *frame)
+{
+    u32 index = ((u32)frame->ip * 0x9E3779B1U) >> (32 - PROFILE_SLOTS_SHIFT);
+    u32 probe;
+
+    /* User addresses mean nothing against the kernel's symbols */
+    if (frame->cs & 3)
+    {
+        profile_user_samples++;
+        return;
+    }
+
+    for (probe = 0; probe < PROFILE_MAX_PROBES; probe++)
+    {
+        struct profile_slot *slot = &profile_slots[index];
+
+        if (slot->samples == 0)
+            slot->ip = frame->ip;
+        if (slot->ip == frame->ip)
+        {
+            slot->samples++;
+            profile_kernel_samples++;
+            return;
+        }
+
+        index = (index + 1) & (PROFILE_SLOTS - 1);
+    }
+
+    profile_lost_samples++;
+
+    return;
+}
+
+int __init profile_init(void)
+{
+    u32 divisor = PIT_FREQUENCY / PROFILE_HZ;
+    uintptr_t frames;
+
+    if (!boot_info_has_option("profile"))
+        return 0;
+
+    if (serial_init(SERIAL_COM1))
+    {
+        printk("profile: no COM1 to write the samples to\n");
+        return -1;
+    }
+
+    frames = frame_alloc_contig(PROFILE_FRAMES);
+    if (frames == 0)
+        return -1;
+    profile_slots = phys_to_virt(frames);
+    memset(profile_slots, 0, PROFILE_FRAMES * PAGE_SIZE);
+
+    outb(PIT_PORT_COMMAND, PROFILE_PIT_MODE);
+    outb(PIT_PORT_CHANNEL0, divisor & 0xFF);
+    outb(PIT_PORT_CHANNEL0, divisor >> 8);
+
+    irq_register(IRQ_VECTOR_BASE + PIT_IRQ_LINE, profile_tick);
+    pic_unmask(PIT_IRQ_LINE);
+    profile_running = true;
+
+    printk("profile: sampling at %u Hz\n", PROFILE_HZ);
+
+    return 0;
+}
+
+void profile_dump(void)
+{
+    char line[48];
+    u32 hot = 0;
+    u32 index;
+
+    if (!profile_running)
+        return;
+
+    pic_mask(PIT_IRQ_LINE);
+    irq_register(IRQ_VECTOR_BASE + PIT_IRQ_LINE, NULL);
+    profile_running = false;
+
+    for (index = 0; index < PROFILE_SLOTS; index++)
+    {
+        int length;
+
+        if (profile_slots[index].samples == 0)
+            continue;
+
+        if (profile_slots[index].ip >= (uintptr_t)_text_hot_start &&
+            profile_slots[index].ip < (uintptr_t)_text_hot_end)
+            hot += profile_slots[index].samples;
+
+        length = snprintk(line, sizeof(line), "prof %llx %u\n", (unsigned long long)profile_slots[index].ip,
+                          profile_slots[index].samples);
+        serial_write(SERIAL_COM1, line, (size_t)length);
+    }
+
+    /* How well the current layout matches this run: with a good list most samples land in the hot text */
+    printk("profile: %u kernel samples (%u in hot text), %u in user mode, %u lost\n", profile_kernel_samples, hot,
+           profile_user_samples, profile_lost_samples);
+
+    return;
+}
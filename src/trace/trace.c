@@ -0,0 +1,235 @@
+#include <types.h>
+#include <acpi/topology.h>
+#include <arch/arch.h>
+#include <arch/cpu.h>
+#include <arch/interrupt.h>
+#include <arch/io.h>
+#include <boot/bootloader.h>
+#include <boot/init.h>
+#include <drivers/serial/serial.h>
+#include <lib/printk.h>
+#include <lib/string.h>
+#include <lib/util.h>
+#include <mm/frame.h>
+#include <mm/mmu.h>
+#include <smp/smp.h>
+#include <time/tsc.h>
+#include <trace/trace.h>
+
+/* 8192 records of 24 bytes: 192KiB per CPU */
+#define TRACE_BUFFER_RECORDS    8192
+#define TRACE_BUFFER_FRAMES     (ALIGN_UP(TRACE_BUFFER_RECORDS * sizeof(struct trace_record), PAGE_SIZE) / PAGE_SIZE)
+
+#define TRACE_SITE_SIZE         5
+#define TRACE_JMP_OPCODE        0xE9
+
+#define TRACE_DEBUGCON_PORT     0xE9
+
+/* Written only by its own CPU, with interrupts off so a handler can't claim the same slot */
+struct trace_buffer
+{
+    struct trace_record *records;
+    size_t head;    /* records written since the last dump; the ring keeps the newest */
+} __attribute__ ((aligned(64)));
+
+extern struct trace_site _trace_sites_start[];
+extern struct trace_site _trace_sites_end[];
+
+static const u8 trace_nop[TRACE_SITE_SIZE] = { 0x0F, 0x1F, 0x44, 0x00, 0x00 };
+
+static struct trace_buffer trace_buffers[NR_CPUS];
+static u32 trace_enabled_events;
+static bool trace_debugcon;
+static bool trace_serial;
+
+static void trace_patch(const struct trace_site *site, bool enabled)
+{
+    u8 *code = (u8 *)site->code;
+    s32 offset = (s32)(site->target - (site->code + TRACE_SITE_SIZE));
+
+    if (enabled)
+    {
+        /* Displacement first, so the site is never a JMP with a stale target */
+        memcpy(code + 1, &offset, sizeof(offset));
+        code[0] = TRACE_JMP_OPCODE;
+    }
+    else
+        memcpy(code, trace_nop, TRACE_SITE_SIZE);
+
+    return;
+}
+
+/* Callers park the other CPUs first: they might run a site while it is half written */
+static void trace_patch_events(u32 events)
+{
+    u32 changed = (events ^ trace_enabled_events) & TRACE_EVENTS__ALL;
+    struct trace_site *site;
+    u32 eax, ebx, ecx, edx;
+    uintptr_t flags;
+
+    /* Nor may a handler on this CPU */
+    flags = interrupts_save();
+
+    for (site = _trace_sites_start; site < _trace_sites_end; site++)
+    {
+        if (!(changed & ((u32)1 << site->event)))
+            continue;
+        if (site->code >= (uintptr_t)_init_start && site->code < (uintptr_t)_init_end)
+            continue;
+        trace_patch(site, (events & ((u32)1 << site->event)) != 0);
+    }
+
+    trace_enabled_events = events & TRACE_EVENTS__ALL;
+
+    /* CPUID serialises, so nothing fetched before the patch is executed after it */
+    cpuid(0, 0, &eax, &ebx, &ecx, &edx);
+
+    interrupts_restore(flags);
+
+    return;
+}
+
+void trace_set_events(u32 events)
+{
+    if (smp_pause() != 0)
+    {
+        printk("trace: other CPUs did not stop, events left at %x\n", trace_enabled_events);
+        return;
+    }
+
+    trace_patch_events(events);
+    smp_resume();
+
+    return;
+}
+
+u32 trace_events(void)
+{
+    return trace_enabled_events;
+}
+
+void trace_emit(u32 event, u32 arg0, u64 arg1)
+{
+    u32 cpu = cpu_index();
+    struct trace_buffer *buffer = &trace_buffers[cpu];
+    struct trace_record *record;
+    uintptr_t flags;
+
+    if (buffer->records == NULL)
+        return;
+
+    flags = interrupts_save();
+    record = &buffer->records[buffer->head & (TRACE_BUFFER_RECORDS - 1)];
+    buffer->head++;
+    record->timestamp = rdtsc();
+    record->event = (u16)event;
+    record->cpu = (u16)cpu;
+    record->arg0 = arg0;
+    record->arg1 = arg1;
+    interrupts_restore(flags);
+
+    return;
+}
+
+static void trace_write(const void *data, size_t length)
+{
+    const u8 *bytes = data;
+    size_t index;
+
+    if (trace_debugcon)
+    {
+        for (index = 0; index < length; index++)
+            outb(TRACE_DEBUGCON_PORT, bytes[index]);
+    }
+    else if (trace_serial)
+        serial_write(SERIAL_COM1, data, length);
+
+    return;
+}
+
+void trace_dump(void)
+{
+    struct trace_dump_header header;
+    u32 events = trace_enabled_events;
+    u32 cpu;
+
+    if (!trace_debugcon && !trace_serial)
+        return;
+
+    /* The other CPUs stay parked until the sites are patched back and their rings read */
+    if (smp_pause() != 0)
+    {
+        printk("trace: other CPUs did not stop, rings not dumped\n");
+        return;
+    }
+
+    /* Nothing below may add records while the rings are read */
+    trace_patch_events(0);
+
+    header.magic = TRACE_DUMP_MAGIC;
+    header.version = TRACE_DUMP_VERSION;
+    header.record_size = sizeof(struct trace_record);
+    header.tsc_khz = tsc_khz();
+    header.record_count = 0;
+    header.lost_count = 0;
+    for (cpu = 0; cpu < NR_CPUS; cpu++)
+    {
+        size_t head = trace_buffers[cpu].head;
+
+        header.record_count += (u32)MIN(head, (size_t)TRACE_BUFFER_RECORDS);
+        header.lost_count += (u32)(head - MIN(head, (size_t)TRACE_BUFFER_RECORDS));
+    }
+
+    trace_write(&header, sizeof(header));
+
+    for (cpu = 0; cpu < NR_CPUS; cpu++)
+    {
+        struct trace_buffer *buffer = &trace_buffers[cpu];
+        size_t count = MIN(buffer->head, (size_t)TRACE_BUFFER_RECORDS);
+        size_t start = (buffer->head - count) & (TRACE_BUFFER_RECORDS - 1);
+        size_t first = MIN(count, TRACE_BUFFER_RECORDS - start);
+
+        /* Oldest first: the ring may wrap once */
+        trace_write(&buffer->records[start], first * sizeof(struct trace_record));
+        trace_write(buffer->records, (count - first) * sizeof(struct trace_record));
+        buffer->head = 0;
+    }
+
+    printk("trace: %u records (%u lost) written to %s\n", header.record_count, header.lost_count,
+           trace_debugcon ? "debugcon" : "COM1");
+
+    trace_patch_events(events);
+    smp_resume();
+
+    return;
+}
+
+int __init trace_init(void)
+{
+    size_t sites = (size_t)(_trace_sites_end - _trace_sites_start);
+    size_t index;
+
+    trace_debugcon = boot_info_has_option("trace_debugcon");
+    if (!trace_debugcon)
+        trace_serial = serial_init(SERIAL_COM1) == 0;
+
+    /* The boot CPU records even when no topology was found */
+    for (index = 0; index < MAX(acpi_topology.cpu_count, (size_t)1); index++)
+    {
+        u32 node = index < acpi_topology.cpu_count ? acpi_topology.cpus[index].node : 0;
+        uintptr_t frames = frame_alloc_node(node, TRACE_BUFFER_FRAMES);
+
+        if (frames == 0)
+            return -1;
+        trace_buffers[index].records = phys_to_virt(frames);
+        trace_buffers[index].head = 0;
+    }
+
+    if (boot_info_has_option("trace"))
+        trace_set_events(TRACE_EVENTS__ALL);
+
+    printk("trace: %zu sites, %zu KiB per cpu, events %x\n", sites,
+           TRACE_BUFFER_FRAMES * (PAGE_SIZE / 1024), trace_enabled_events);
+
+    return 0;
+}
@@ -0,0 +1,324 @@
+/*
+ * hotlist: turns the kernel's sampling profile (see include/trace/profile.h)
+ * into the list of hot functions the linker script places together.
+ *
+ *   hotlist kernel.bin profile.log [coverage%] > hot.txt
+ *   make PROFILE=release-lto HOT_FUNCTIONS=hot.txt
+ *
+ * Addresses are resolved against the ELF symbol table of the kernel that
+ * was profiled, so it must be the same build. Compiler clones (foo.part.0,
+ * foo.constprop.0, foo.lto_priv.0) are credited to the function they came
+ * from, whose section the clones follow. The busiest functions are printed
+ * until they cover the given share of the kernel samples (95% by default).
+ * Like trace2json, everything in the log that is not a sample is skipped.
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The few ELF definitions needed, so the tool builds without <elf.h> */
+#define ELF_CLASS32         1
+#define ELF_CLASS64         2
+#define ELF_DATA_LSB        1
+#define ELF_SHT_SYMTAB      2
+#define ELF_STT_FUNC        2
+
+#define HOTLIST_COVERAGE    95.0
+
+struct hot_function
+{
+    char *name;
+    uint64_t start;
+    uint64_t end;
+    uint64_t samples;
+};
+
+static struct hot_function *functions;
+static size_t function_count;
+
+static unsigned char *read_file(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    unsigned char *data = NULL;
+    size_t capacity = 0;
+    size_t length = 0;
+
+    if (file == NULL)
+        return NULL;
+
+    for (;;)
+    {
+        size_t count;
+
+        if (length == capacity)
+        {
+            unsigned char *grown;
+
+            capacity = capacity ? capacity * 2 : 1 << 20;
+            grown = realloc(data, capacity);
+            if (grown == NULL)
+            {
+                free(data);
+                fclose(file);
+                return NULL;
+            }
+            data = grown;
+        }
+
+        count = fread(data + length, 1, capacity - length, file);
+        if (count == 0)
+            break;
+        length += count;
+    }
+
+    fclose(file);
+    *size = length;
+
+    return data;
+}
+
+/* Little-endian field readers: both kernel targets are x86 */
+static uint64_t elf_read(const unsigned char *data, size_t offset, size_t width)
+{
+    uint64_t value = 0;
+
+    while (width-- > 0)
+        value = (value << 8) | data[offset + width];
+
+    return value;
+}
+
+static int function_compare_address(const void *left, const void *right)
+{
+    const struct hot_function *a = left;
+    const struct hot_function *b = right;
+
+    return a->start < b->start ? -1 : a->start > b->start;
+}
+
+static int function_compare_name(const void *left, const void *right)
+{
+    const struct hot_function *a = left;
+    const struct hot_function *b = right;
+
+    return strcmp(a->name, b->name);
+}
+
+static int function_compare_samples(const void *left, const void *right)
+{
+    const struct hot_function *a = left;
+    const struct hot_function *b = right;
+
+    if (a->samples != b->samples)
+        return a->samples < b->samples ? 1 : -1;
+
+    return strcmp(a->name, b->name);
+}
+
+/* Collects the sized STT_FUNC symbols of the kernel image, sorted by address */
+static int load_symbols(const unsigned char *data, size_t size)
+{
+    size_t shoff, shentsize, shnum;
+    size_t sym_size, value_offset, size_offset, size_width;
+    size_t section;
+    int is64;
+
+    if (size < 0x34 || memcmp(data, "\177ELF", 4) != 0 || data[5] != ELF_DATA_LSB)
+        return -1;
+
+    is64 = data[4] == ELF_CLASS64;
+    if (!is64 && data[4] != ELF_CLASS32)
+        return -1;
+    if (is64 && size < 0x40)
+        return -1;
+
+    shoff = (size_t)elf_read(data, is64 ? 0x28 : 0x20, is64 ? 8 : 4);
+    shentsize = (size_t)elf_read(data, is64 ? 0x3A : 0x2E, 2);
+    shnum = (size_t)elf_read(data, is64 ? 0x3C : 0x30, 2);
+    if (shoff == 0 || shoff + shentsize * shnum > size)
+        return -1;
+
+    sym_size = is64 ? 24 : 16;
+    value_offset = is64 ? 8 : 4;
+    size_offset = is64 ? 16 : 8;
+    size_width = is64 ? 8 : 4;
+
+    for (section = 0; section < shnum; section++)
+    {
+        const unsigned char *header = data + shoff + section * shentsize;
+        size_t offset, length, link, strtab, strtab_size, index;
+
+        if (elf_read(header, 4, 4) != ELF_SHT_SYMTAB)
+            continue;
+
+        offset = (size_t)elf_read(header, is64 ? 0x18 : 0x10, is64 ? 8 : 4);
+        length = (size_t)elf_read(header, is64 ? 0x20 : 0x14, is64 ? 8 : 4);
+        link = (size_t)elf_read(header, is64 ? 0x28 : 0x18, 4);
+        if (link >= shnum || offset + length > size)
+            return -1;
+
+        header = data + shoff + link * shentsize;
+        strtab = (size_t)elf_read(header, is64 ? 0x18 : 0x10, is64 ? 8 : 4);
+        strtab_size = (size_t)elf_read(header, is64 ? 0x20 : 0x14, is64 ? 8 : 4);
+        if (strtab + strtab_size > size)
+            return -1;
+
+        functions = calloc(length / sym_size + 1, sizeof(*functions));
+        if (functions == NULL)
+            return -1;
+
+        for (index = 0; index + sym_size <= length; index += sym_size)
+        {
+            const unsigned char *symbol = data + offset + index;
+            size_t name = (size_t)elf_read(symbol, 0, 4);
+            unsigned char info = symbol[is64 ? 4 : 12];
+            uint64_t value = elf_read(symbol, value_offset, is64 ? 8 : 4);
+            uint64_t extent = elf_read(symbol, size_offset, size_width);
+            char *dot;
+
+            if ((info & 0xF) != ELF_STT_FUNC || extent == 0 || name >= strtab_size)
+                continue;
+
+            functions[function_count].name = strdup((const char *)data + strtab + name);
+            if (functions[function_count].name == NULL)
+                return -1;
+            /* The section a clone lands in follows its origin's name */
+            dot = strchr(functions[function_count].name, '.');
+            if (dot != NULL)
+                *dot = '\0';
+            functions[function_count].start = value;
+            functions[function_count].end = value + extent;
+            function_count++;
+        }
+
+        qsort(functions, function_count, sizeof(*functions), function_compare_address);
+
+        return 0;
+    }
+
+    return -1;
+}
+
+static struct hot_function *find_function(uint64_t address)
+{
+    size_t low = 0;
+    size_t high = function_count;
+
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+
+        if (address < functions[middle].start)
+            high = middle;
+        else if (address >= functions[middle].end)
+            low = middle + 1;
+        else
+            return &functions[middle];
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned char *image;
+    char line[256];
+    double coverage = HOTLIST_COVERAGE;
+    uint64_t total = 0;
+    uint64_t unresolved = 0;
+    uint64_t covered = 0;
+    size_t size;
+    size_t index;
+    size_t kept;
+    FILE *log;
+
+    if (argc < 3 || argc > 4)
+    {
+        fprintf(stderr, "usage: %s <kernel.bin> <profile log> [coverage%%]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 4)
+    {
+        coverage = strtod(argv[3], NULL);
+        if (coverage <= 0.0 || coverage > 100.0)
+        {
+            fprintf(stderr, "%s: coverage must be in (0, 100]\n", argv[3]);
+            return 1;
+        }
+    }
+
+    image = read_file(argv[1], &size);
+    if (image == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    if (load_symbols(image, size))
+    {
+        fprintf(stderr, "%s: no usable ELF symbol table\n", argv[1]);
+        return 1;
+    }
+    free(image);
+
+    log = fopen(argv[2], "r");
+    if (log == NULL)
+    {
+        perror(argv[2]);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), log) != NULL)
+    {
+        struct hot_function *function;
+        uint64_t address;
+        uint64_t samples;
+
+        if (sscanf(line, "prof %" SCNx64 " %" SCNu64, &address, &samples) != 2)
+            continue;
+
+        total += samples;
+        function = find_function(address);
+        if (function != NULL)
+            function->samples += samples;
+        else
+            unresolved += samples;
+    }
+    fclose(log);
+
+    if (total == 0)
+    {
+        fprintf(stderr, "%s: no samples found\n", argv[2]);
+        return 1;
+    }
+    if (unresolved)
+        fprintf(stderr, "%s: %" PRIu64 " of %" PRIu64 " samples outside any function\n", argv[2], unresolved,
+                total);
+
+    /* Clones share their origin's name: sorted by name they are neighbours, folded into one entry */
+    qsort(functions, function_count, sizeof(*functions), function_compare_name);
+    for (index = 0, kept = 0; index < function_count; index++)
+    {
+        if (kept != 0 && strcmp(functions[kept - 1].name, functions[index].name) == 0)
+            functions[kept - 1].samples += functions[index].samples;
+        else
+            functions[kept++] = functions[index];
+    }
+    function_count = kept;
+    qsort(functions, function_count, sizeof(*functions), function_compare_samples);
+
+    for (kept = 0; kept < function_count && functions[kept].samples != 0; kept++)
+    {
+        if (covered * 100.0 >= coverage * total)
+            break;
+        covered += functions[kept].samples;
+    }
+
+    printf("# %zu functions, %.1f%% of %" PRIu64 " samples\n", kept, covered * 100.0 / total, total);
+    for (index = 0; index < kept; index++)
+        printf("%s\n", functions[index].name);
+
+    return 0;
+}
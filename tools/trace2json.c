@@ -0,0 +1,290 @@
+/*
+ * trace2json: converts a kernel trace dump (see include/trace/trace.h) into
+ * Chrome trace event JSON, loadable in Perfetto or chrome://tracing.
+ *
+ *   trace2json trace.bin [trace.json]
+ *
+ * The dump may be preceded by other output on the same port (firmware or
+ * boot loader messages on COM1); everything before the magic is skipped.
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Must match include/trace/trace.h */
+#define TRACE_DUMP_MAGIC                0x4352544BU
+#define TRACE_DUMP_VERSION              1
+
+#define TRACE_EVENT__IRQ_ENTRY          0
+#define TRACE_EVENT__IRQ_EXIT           1
+#define TRACE_EVENT__SCHED_SWITCH       2
+#define TRACE_EVENT__PAGE_ALLOC         3
+#define TRACE_EVENT__PAGE_FREE          4
+#define TRACE_EVENT__BLOCK_SUBMIT       5
+#define TRACE_EVENT__BLOCK_COMPLETE     6
+#define TRACE_EVENT__LOCK_CONTENDED     7
+
+#define TRACE_MAX_CPUS                  256
+
+struct trace_record
+{
+    uint64_t timestamp;
+    uint16_t event;
+    uint16_t cpu;
+    uint32_t arg0;
+    uint64_t arg1;
+};
+
+struct trace_dump_header
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t tsc_khz;
+    uint32_t record_count;
+    uint32_t lost_count;
+};
+
+static const char *const exception_names[32] =
+{
+    "#DE", "#DB", "NMI", "#BP", "#OF", "#BR", "#UD", "#NM", "#DF", NULL, "#TS", "#NP", "#SS", "#GP",
+    "#PF", NULL, "#MF", "#AC", "#MC", "#XM", "#VE", "#CP",
+};
+
+static uint64_t base_tsc;
+static uint32_t tsc_khz;
+static int first_event = 1;
+
+static unsigned char *read_file(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    unsigned char *data = NULL;
+    size_t capacity = 0;
+    size_t length = 0;
+
+    if (file == NULL)
+        return NULL;
+
+    for (;;)
+    {
+        size_t count;
+
+        if (length == capacity)
+        {
+            unsigned char *grown;
+
+            capacity = capacity ? capacity * 2 : 1 << 20;
+            grown = realloc(data, capacity);
+            if (grown == NULL)
+            {
+                free(data);
+                fclose(file);
+                return NULL;
+            }
+            data = grown;
+        }
+
+        count = fread(data + length, 1, capacity - length, file);
+        if (count == 0)
+            break;
+        length += count;
+    }
+
+    fclose(file);
+    *size = length;
+
+    return data;
+}
+
+/* Microseconds since the earliest record, the unit Chrome trace timestamps use */
+static double trace_us(uint64_t timestamp)
+{
+    return (double)(timestamp - base_tsc) * 1000.0 / tsc_khz;
+}
+
+static void event_begin(FILE *out, const char *name, const char *phase, const struct trace_record *record,
+                        double ts)
+{
+    fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"%s\",\"pid\":0,\"tid\":%u,\"ts\":%.3f",
+            first_event ? "" : ",", name, phase, record->cpu, ts);
+    first_event = 0;
+
+    return;
+}
+
+static void emit_record(FILE *out, const struct trace_record *record, int64_t *frames_in_use)
+{
+    double ts = trace_us(record->timestamp);
+    char name[32];
+
+    switch (record->event)
+    {
+        case TRACE_EVENT__IRQ_ENTRY:
+        case TRACE_EVENT__IRQ_EXIT:
+            if (record->arg0 < 32 && exception_names[record->arg0] != NULL)
+                snprintf(name, sizeof(name), "%s", exception_names[record->arg0]);
+            else
+                snprintf(name, sizeof(name), "irq %u", record->arg0);
+            event_begin(out, name, record->event == TRACE_EVENT__IRQ_ENTRY ? "B" : "E", record, ts);
+            if (record->event == TRACE_EVENT__IRQ_ENTRY)
+                fprintf(out, ",\"cat\":\"irq\",\"args\":{\"vector\":%u,\"ip\":\"0x%" PRIx64 "\"}}",
+                        record->arg0, record->arg1);
+            else
+                fprintf(out, ",\"cat\":\"irq\"}");
+            break;
+        case TRACE_EVENT__SCHED_SWITCH:
+            event_begin(out, "sched_switch", "i", record, ts);
+            fprintf(out, ",\"cat\":\"sched\",\"s\":\"t\",\"args\":{\"prev\":%u,\"next\":%" PRIu64 "}}",
+                    record->arg0, record->arg1);
+            break;
+        case TRACE_EVENT__PAGE_ALLOC:
+        case TRACE_EVENT__PAGE_FREE:
+            event_begin(out, record->event == TRACE_EVENT__PAGE_ALLOC ? "page_alloc" : "page_free", "i",
+                        record, ts);
+            fprintf(out, ",\"cat\":\"mm\",\"s\":\"t\",\"args\":{\"frames\":%u,\"addr\":\"0x%" PRIx64 "\"}}",
+                    record->arg0, record->arg1);
+            /* Net frames allocated while tracing, as a counter track */
+            *frames_in_use += record->event == TRACE_EVENT__PAGE_ALLOC ? (int64_t)record->arg0
+                                                                      : -(int64_t)record->arg0;
+            event_begin(out, "frames", "C", record, ts);
+            fprintf(out, ",\"args\":{\"traced\":%" PRId64 "}}", *frames_in_use);
+            break;
+        case TRACE_EVENT__BLOCK_SUBMIT:
+            /* Async slice keyed by the request, which may complete on another CPU */
+            event_begin(out, "blk_request", "b", record, ts);
+            fprintf(out, ",\"cat\":\"block\",\"id\":\"0x%" PRIx64 "\",\"args\":{\"sector\":%u}}",
+                    record->arg1, record->arg0);
+            break;
+        case TRACE_EVENT__BLOCK_COMPLETE:
+            event_begin(out, "blk_request", "e", record, ts);
+            fprintf(out, ",\"cat\":\"block\",\"id\":\"0x%" PRIx64 "\",\"args\":{\"status\":%d}}",
+                    record->arg1, (int32_t)record->arg0);
+            break;
+        case TRACE_EVENT__LOCK_CONTENDED:
+        {
+            /* Recorded on acquisition: the wait ended at the timestamp */
+            double wait = (double)record->arg0 * 1000.0 / tsc_khz;
+
+            event_begin(out, "lock_contended", "X", record, ts - wait);
+            fprintf(out, ",\"dur\":%.3f,\"cat\":\"lock\",\"args\":{\"lock\":\"0x%" PRIx64 "\"}}",
+                    wait, record->arg1);
+            break;
+        }
+        default:
+            snprintf(name, sizeof(name), "event %u", record->event);
+            event_begin(out, name, "i", record, ts);
+            fprintf(out, ",\"s\":\"t\",\"args\":{\"arg0\":%u,\"arg1\":%" PRIu64 "}}", record->arg0, record->arg1);
+            break;
+    }
+
+    return;
+}
+
+int main(int argc, char **argv)
+{
+    struct trace_record *records;
+    struct trace_dump_header header;
+    unsigned char *data;
+    unsigned char seen[TRACE_MAX_CPUS] = { 0 };
+    int64_t frames_in_use = 0;
+    size_t offset;
+    size_t size;
+    size_t index;
+    uint32_t cpu;
+    FILE *out = stdout;
+
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "usage: %s <trace dump> [output.json]\n", argv[0]);
+        return 1;
+    }
+
+    data = read_file(argv[1], &size);
+    if (data == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    for (offset = 0; offset + sizeof(header) <= size; offset++)
+    {
+        memcpy(&header, data + offset, sizeof(header));
+        if (header.magic == TRACE_DUMP_MAGIC && header.version == TRACE_DUMP_VERSION &&
+            header.record_size == sizeof(struct trace_record))
+            break;
+    }
+    if (offset + sizeof(header) > size)
+    {
+        fprintf(stderr, "%s: no trace dump found\n", argv[1]);
+        return 1;
+    }
+
+    offset += sizeof(header);
+    if (header.record_count > (size - offset) / sizeof(struct trace_record))
+    {
+        fprintf(stderr, "%s: truncated dump, %u of %u records present\n", argv[1],
+                (unsigned)((size - offset) / sizeof(struct trace_record)), header.record_count);
+        header.record_count = (uint32_t)((size - offset) / sizeof(struct trace_record));
+    }
+    if (header.tsc_khz == 0)
+    {
+        fprintf(stderr, "%s: TSC frequency unknown\n", argv[1]);
+        return 1;
+    }
+    if (header.lost_count)
+        fprintf(stderr, "%s: %u records were overwritten before the dump\n", argv[1], header.lost_count);
+
+    /* Copy out: the records are not necessarily aligned after the skipped prefix */
+    records = calloc((size_t)header.record_count + 1, sizeof(struct trace_record));
+    if (records == NULL)
+    {
+        perror("malloc");
+        return 1;
+    }
+    memcpy(records, data + offset, (size_t)header.record_count * sizeof(struct trace_record));
+
+    tsc_khz = header.tsc_khz;
+    base_tsc = UINT64_MAX;
+    for (index = 0; index < header.record_count; index++)
+    {
+        if (records[index].timestamp < base_tsc)
+            base_tsc = records[index].timestamp;
+        if (records[index].cpu < TRACE_MAX_CPUS)
+            seen[records[index].cpu] = 1;
+    }
+
+    if (argc == 3)
+    {
+        out = fopen(argv[2], "w");
+        if (out == NULL)
+        {
+            perror(argv[2]);
+            return 1;
+        }
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (cpu = 0; cpu < TRACE_MAX_CPUS; cpu++)
+    {
+        if (!seen[cpu])
+            continue;
+        fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"cpu %u\"}}",
+                first_event ? "" : ",", cpu, cpu);
+        first_event = 0;
+    }
+    for (index = 0; index < header.record_count; index++)
+        emit_record(out, &records[index], &frames_in_use);
+    fprintf(out, "\n]}\n");
+
+    if (out != stdout)
+        fclose(out);
+    fprintf(stderr, "%u records, TSC %u kHz\n", header.record_count, tsc_khz);
+
+    free(records);
+    free(data);
+
+    return 0;
+}
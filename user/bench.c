@@ -0,0 +1,131 @@
+#include <types.h>
+#include <arch/cpu.h>
+#include <bench/ipcbench.h>
+#include <bench/syscallbench.h>
+#include <proc/process.h>
+#include <time/vdso.h>
+#include "bench.h"
+#include "lib.h"
+
+#define BENCH_BATCH     (1U << SYSCALLBENCH_BATCH_SHIFT)
+
+typedef void (*bench_op_t)(void);
+
+static const volatile struct vdso_time *const bench_time = (const volatile struct vdso_time *)USER_TIME_PAGE;
+static volatile u64 bench_sink;
+
+static void bench_nop(void)
+{
+    syscall2(SYS_NOP, 0, 0);
+
+    return;
+}
+
+static void bench_clock_vdso(void)
+{
+    bench_sink = vdso_time_ns(bench_time);
+
+    return;
+}
+
+static void bench_clock_syscall(void)
+{
+    u64 ns;
+
+    syscall2(SYS_CLOCK_NS, (uintptr_t)&ns, 0);
+    bench_sink = ns;
+
+    return;
+}
+
+static const bench_op_t bench_ops[SYSCALLBENCH_TESTS] =
+{
+    [SYSCALLBENCH__NOP] = bench_nop,
+    [SYSCALLBENCH__CLOCK_VDSO] = bench_clock_vdso,
+    [SYSCALLBENCH__CLOCK_SYSCALL] = bench_clock_syscall,
+};
+
+static const char *const bench_names[SYSCALLBENCH_TESTS] =
+{
+    [SYSCALLBENCH__NOP] = "syscall round trip",
+    [SYSCALLBENCH__CLOCK_VDSO] = "clock read, time page",
+    [SYSCALLBENCH__CLOCK_SYSCALL] = "clock read, syscall",
+};
+
+static u32 bench_tenths(u32 cycles)
+{
+    return (u32)tsc_scale((u64)cycles * 10, bench_time->mult);
+}
+
+u32 bench_ns(u32 cycles)
+{
+    return bench_tenths(cycles) / 10;
+}
+
+/* The duration is printed to a tenth of a nanosecond */
+void bench_report(const char *label, u32 cycles)
+{
+    u32 tenths = bench_tenths(cycles);
+
+    print(label);
+    print_u32(cycles);
+    print(" cycles (");
+    print_u32(tenths / 10);
+    print(".");
+    print_u32(tenths % 10);
+    print(" ns)");
+
+    return;
+}
+
+static int syscallbench(u32 test, u32 shift)
+{
+    bench_op_t op;
+    u32 best = U32_MAX;
+    u32 batch;
+    u32 index;
+    u64 start;
+    u64 total;
+
+    if (test >= SYSCALLBENCH_TESTS || shift < SYSCALLBENCH_BATCH_SHIFT || shift >= 32)
+        return 1;
+
+    op = bench_ops[test];
+
+    /* One untimed batch brings the entry path into the caches and TLB */
+    for (index = 0; index < BENCH_BATCH; index++)
+        op();
+
+    start = rdtsc();
+    for (batch = 0; batch < (1U << (shift - SYSCALLBENCH_BATCH_SHIFT)); batch++)
+    {
+        u64 batch_start = rdtsc();
+        u32 cycles;
+
+        for (index = 0; index < BENCH_BATCH; index++)
+            op();
+
+        cycles = (u32)((rdtsc() - batch_start) >> SYSCALLBENCH_BATCH_SHIFT);
+        if (cycles < best)
+            best = cycles;
+    }
+    total = rdtsc() - start;
+
+    print("syscallbench: ");
+    print(bench_names[test]);
+    bench_report(": avg ", (u32)(total >> shift));
+    bench_report(", best batch ", best);
+    print("\n");
+
+    return 0;
+}
+
+int main(u32 test, u32 arg)
+{
+    if (test == IPCBENCH__SERVER)
+        return ipcbench_server(arg);
+    if (test == IPCBENCH__CLIENT)
+        return ipcbench_client(arg);
+
+    return syscallbench(test, arg);
+}
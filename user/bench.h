@@ -0,0 +1,15 @@
+#ifndef __USER__BENCH_H__
+#define __USER__BENCH_H__
+
+#include <types.h>
+
+/* Prints 'label', 'cycles' and their duration from the time page's TSC parameters */
+void bench_report(const char *label, u32 cycles);
+
+/* Nanoseconds in 'cycles', the same conversion */
+u32 bench_ns(u32 cycles);
+
+int ipcbench_server(u32 port);
+int ipcbench_client(u32 port);
+
+#endif /* __USER__BENCH_H__ */
@@ -0,0 +1,11 @@
+; The user programs' flat image (user.bin, built from user/), embedded in
+; the kernel for process_create()
+
+section .rodata.user_image progbits alloc noexec nowrite align=16
+global user_image_start
+global user_image_end
+
+align 16
+user_image_start:
+    incbin "user.bin"
+user_image_end:
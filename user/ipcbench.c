@@ -0,0 +1,172 @@
+#include <types.h>
+#include <arch/arch.h>
+#include <arch/cpu.h>
+#include <bench/ipcbench.h>
+#include <bench/syscallbench.h>
+#include "bench.h"
+#include "lib.h"
+
+#define IPCBENCH_BATCH  (1U << SYSCALLBENCH_BATCH_SHIFT)
+
+/* Sum of the first word of every page of a DATA message: reads each page the way a consumer would */
+static uintptr_t ipcbench_touch(uintptr_t addr, size_t length)
+{
+    uintptr_t sum = 0;
+    size_t offset;
+
+    for (offset = 0; offset < length; offset += PAGE_SIZE)
+        sum += *(const volatile uintptr_t *)(addr + offset);
+
+    return sum;
+}
+
+int ipcbench_server(u32 port)
+{
+    struct ipc_message message;
+
+    if (port_window(port, IPCBENCH_WINDOW, IPCBENCH_MAX_SIZE) || port_receive(port, &message))
+        return 1;
+
+    while (IPC_TAG_LABEL(message.tag) != IPCBENCH_LABEL__QUIT)
+    {
+        if (IPC_TAG_LABEL(message.tag) == IPCBENCH_LABEL__DATA)
+            message.w0 = ipcbench_touch(message.w0, message.w1);
+        else
+            message.w0++;
+        message.tag = IPC_TAG_LABEL(message.tag);
+
+        if (port_reply_wait(port, &message))
+            return 1;
+    }
+
+    return port_reply(port, &message) ? 1 : 0;
+}
+
+static int ipcbench_ping(u32 port)
+{
+    struct ipc_message message;
+    uintptr_t token = 0;
+    u32 best = U32_MAX;
+    u32 batch;
+    u32 index;
+    u64 start;
+    u64 total;
+
+    /* One untimed batch brings both address spaces into the caches */
+    for (index = 0; index < IPCBENCH_BATCH; index++)
+    {
+        message.tag = IPCBENCH_LABEL__PING;
+        message.w0 = token;
+        message.w1 = 0;
+        if (port_call(port, &message))
+            return -1;
+        token = message.w0;
+    }
+
+    start = rdtsc();
+    for (batch = 0; batch < (1U << (IPCBENCH_PING_SHIFT - SYSCALLBENCH_BATCH_SHIFT)); batch++)
+    {
+        u64 batch_start = rdtsc();
+        u32 cycles;
+
+        for (index = 0; index < IPCBENCH_BATCH; index++)
+        {
+            message.tag = IPCBENCH_LABEL__PING;
+            message.w0 = token;
+            message.w1 = 0;
+            port_call(port, &message);
+            token = message.w0;
+        }
+
+        cycles = (u32)((rdtsc() - batch_start) >> SYSCALLBENCH_BATCH_SHIFT);
+        if (cycles < best)
+            best = cycles;
+    }
+    total = rdtsc() - start;
+
+    /* Every reply carried the token back incremented */
+    if (token != IPCBENCH_BATCH + (1U << IPCBENCH_PING_SHIFT))
+        return -1;
+
+    print("ipcbench: call/reply round trip");
+    bench_report(": avg ", (u32)(total >> IPCBENCH_PING_SHIFT));
+    bench_report(", best batch ", best);
+    print("\n");
+
+    return 0;
+}
+
+/* Average cycles to hand the first 'size' bytes of the buffer to the server with 'transfer', 0 on error */
+static u32 ipcbench_bulk(u32 port, size_t size, uintptr_t transfer)
+{
+    uintptr_t pages = size / PAGE_SIZE;
+    struct ipc_message message;
+    u32 round;
+    u64 start = 0;
+
+    /* Round 0 is untimed: it maps the window pages the copies land in */
+    for (round = 0; round <= (1U << IPCBENCH_BULK_SHIFT); round++)
+    {
+        if (round == 1)
+            start = rdtsc();
+
+        message.tag = IPCBENCH_LABEL__DATA | transfer;
+        message.w0 = IPCBENCH_BUFFER;
+        message.w1 = size;
+        if (port_call(port, &message) || message.w0 != pages * (pages + 1) / 2)
+            return 0;
+    }
+
+    return (u32)((rdtsc() - start) >> IPCBENCH_BULK_SHIFT);
+}
+
+static void ipcbench_report_bulk(const char *label, size_t size, u32 cycles)
+{
+    u32 ns = bench_ns(cycles);
+
+    print(label);
+    /* Bytes per nanosecond times 1000; a thousand times the largest size still fits 32 bits */
+    print_u32(ns != 0 ? (u32)(size * 1000 / ns) : 0);
+    print(" MB/s (");
+    print_u32(ns);
+    print(" ns)");
+
+    return;
+}
+
+int ipcbench_client(u32 port)
+{
+    struct ipc_message message;
+    size_t size;
+    size_t page;
+
+    if (ipcbench_ping(port))
+        return 1;
+
+    /* Page i holds i + 1 in its first word, so the server's sum checks what it saw */
+    if (map(IPCBENCH_BUFFER, IPCBENCH_MAX_SIZE))
+        return 1;
+    for (page = 0; page < IPCBENCH_MAX_SIZE / PAGE_SIZE; page++)
+        *(uintptr_t *)(IPCBENCH_BUFFER + page * PAGE_SIZE) = page + 1;
+
+    for (size = IPCBENCH_MIN_SIZE; size <= IPCBENCH_MAX_SIZE; size *= 4)
+    {
+        u32 copy = ipcbench_bulk(port, size, IPC_TAG__COPY);
+        u32 mapped = ipcbench_bulk(port, size, IPC_TAG__MAP);
+
+        if (copy == 0 || mapped == 0)
+            return 1;
+
+        print("ipcbench: ");
+        print_u32((u32)size);
+        ipcbench_report_bulk(" bytes: copy ", size, copy);
+        ipcbench_report_bulk(", map ", size, mapped);
+        print("\n");
+    }
+
+    message.tag = IPCBENCH_LABEL__QUIT;
+    message.w0 = 0;
+    message.w1 = 0;
+
+    return port_call(port, &message) ? 1 : 0;
+}
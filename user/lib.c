@@ -0,0 +1,85 @@
+#include <types.h>
+#include "lib.h"
+
+/* process_create() passes two arguments in registers; main()'s return value is the exit status */
+__asm__ (".section .text.entry, \"ax\"\n"
+         ".globl _start\n"
+         "_start:\n"
+#ifdef __x86_64__
+         "    call main\n"
+         "    movl %eax, %edi\n"
+#else
+         "    pushl %edx\n"
+         "    pushl %eax\n"
+         "    call main\n"
+         "    pushl %eax\n"
+#endif
+         "    call exit\n"
+         ".previous");
+
+void exit(int status)
+{
+    syscall2(SYS_EXIT, (uintptr_t)status, 0);
+
+    while (1)
+        ;
+}
+
+void print(const char *string)
+{
+    size_t length = 0;
+
+    while (string[length] != '\0')
+        length++;
+
+    syscall2(SYS_WRITE, (uintptr_t)string, length);
+
+    return;
+}
+
+void print_u32(u32 value)
+{
+    char digits[11];
+    size_t index = sizeof(digits) - 1;
+
+    digits[index] = '\0';
+    do
+    {
+        digits[--index] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    print(&digits[index]);
+
+    return;
+}
+
+int map(uintptr_t addr, size_t length)
+{
+    return syscall2(SYS_MAP, addr, length) == SYSCALL_ERROR ? -1 : 0;
+}
+
+int port_call(u32 port, struct ipc_message *message)
+{
+    return syscall_message(SYS_IPC_CALL, port, message) == SYSCALL_ERROR ? -1 : 0;
+}
+
+int port_receive(u32 port, struct ipc_message *message)
+{
+    return syscall_message(SYS_IPC_RECEIVE, port, message) == SYSCALL_ERROR ? -1 : 0;
+}
+
+int port_reply(u32 port, struct ipc_message *message)
+{
+    return syscall_message(SYS_IPC_REPLY, port, message) == SYSCALL_ERROR ? -1 : 0;
+}
+
+int port_reply_wait(u32 port, struct ipc_message *message)
+{
+    return syscall_message(SYS_IPC_REPLY_WAIT, port, message) == SYSCALL_ERROR ? -1 : 0;
+}
+
+int port_window(u32 port, uintptr_t addr, size_t length)
+{
+    return syscall3(SYS_IPC_WINDOW, port, addr, length) == SYSCALL_ERROR ? -1 : 0;
+}
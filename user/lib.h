@@ -0,0 +1,111 @@
+#ifndef __USER__LIB_H__
+#define __USER__LIB_H__
+
+#include <types.h>
+#include <proc/ipc.h>
+#include <proc/syscall.h>
+
+/*
+ * Minimal runtime for user programs. They are built against the kernel
+ * headers but link only with user/, and reach the kernel exclusively
+ * through these system calls.
+ */
+
+#ifdef __x86_64__
+static inline uintptr_t syscall3(uintptr_t number, uintptr_t arg0, uintptr_t arg1, uintptr_t arg2)
+{
+    uintptr_t result;
+
+    __asm__ volatile ("syscall"
+                      : "=a"(result)
+                      : "a"(number), "D"(arg0), "S"(arg1), "d"(arg2)
+                      : "rcx", "r11", "memory");
+
+    return result;
+}
+
+/* Arguments 1-3 come from 'message' and go back into it, where the IPC calls return theirs */
+static inline uintptr_t syscall_message(uintptr_t number, uintptr_t arg0, struct ipc_message *message)
+{
+    register uintptr_t w1 __asm__ ("r10") = message->w1;
+    uintptr_t result = number;
+    uintptr_t tag = message->tag;
+    uintptr_t w0 = message->w0;
+
+    __asm__ volatile ("syscall"
+                      : "+a"(result), "+S"(tag), "+d"(w0), "+r"(w1)
+                      : "D"(arg0)
+                      : "rcx", "r11", "memory");
+
+    message->tag = tag;
+    message->w0 = w0;
+    message->w1 = w1;
+
+    return result;
+}
+#else
+/* SYSEXIT resumes at EDX with the stack in ECX, which the caller supplies */
+static inline uintptr_t syscall3(uintptr_t number, uintptr_t arg0, uintptr_t arg1, uintptr_t arg2)
+{
+    uintptr_t result;
+
+    __asm__ volatile ("movl %%esp, %%ecx\n\t"
+                      "movl $1f, %%edx\n\t"
+                      "sysenter\n\t"
+                      "1:"
+                      : "=a"(result)
+                      : "a"(number), "b"(arg0), "S"(arg1), "D"(arg2)
+                      : "ecx", "edx", "memory");
+
+    return result;
+}
+
+/* The last argument travels in EBP, which the compiler may not hand out: it passes through ECX */
+static inline uintptr_t syscall_message(uintptr_t number, uintptr_t arg0, struct ipc_message *message)
+{
+    uintptr_t result = number;
+    uintptr_t tag = message->tag;
+    uintptr_t w0 = message->w0;
+    uintptr_t w1 = message->w1;
+
+    __asm__ volatile ("pushl %%ebp\n\t"
+                      "movl %%ecx, %%ebp\n\t"
+                      "movl %%esp, %%ecx\n\t"
+                      "movl $1f, %%edx\n\t"
+                      "sysenter\n\t"
+                      "1:\n\t"
+                      "movl %%ebp, %%ecx\n\t"
+                      "popl %%ebp"
+                      : "+a"(result), "+S"(tag), "+D"(w0), "+c"(w1)
+                      : "b"(arg0)
+                      : "edx", "memory");
+
+    message->tag = tag;
+    message->w0 = w0;
+    message->w1 = w1;
+
+    return result;
+}
+#endif
+
+static inline uintptr_t syscall2(uintptr_t number, uintptr_t arg0, uintptr_t arg1)
+{
+    return syscall3(number, arg0, arg1, 0);
+}
+
+void exit(int status) __attribute__ ((noreturn));
+
+void print(const char *string);
+void print_u32(u32 value);
+
+/* Zeroed writable pages; 0 or -1 */
+int map(uintptr_t addr, size_t length);
+
+/* The IPC system calls, 0 or -1; see include/proc/ipc.h */
+int port_call(u32 port, struct ipc_message *message);
+int port_receive(u32 port, struct ipc_message *message);
+int port_reply(u32 port, struct ipc_message *message);
+int port_reply_wait(u32 port, struct ipc_message *message);
+int port_window(u32 port, uintptr_t addr, size_t length);
+
+#endif /* __USER__LIB_H__ */